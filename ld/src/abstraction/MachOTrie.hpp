@@ -352,6 +352,24 @@ struct EntryWithOffset
 
 
 
+static inline void processTerminalInfo(const uint8_t* p, const uint8_t* const end, Entry& entry)
+{
+	entry.flags = read_uleb128(p, end);
+	if ( entry.flags & EXPORT_SYMBOL_FLAGS_REEXPORT ) {
+		entry.address = 0;
+		entry.other = read_uleb128(p, end); // dylib ordinal
+		entry.importName = (char*)p;
+	}
+	else {
+		entry.address = read_uleb128(p, end); 
+		if ( entry.flags & EXPORT_SYMBOL_FLAGS_STUB_AND_RESOLVER )
+			entry.other = read_uleb128(p, end); 
+		else
+			entry.other = 0;
+		entry.importName = NULL;
+	}
+}
+
 static inline void processExportNode(const uint8_t* const start, const uint8_t* p, const uint8_t* const end, 
 									char* cummulativeString, int curStrOffset, 
 									std::vector<EntryWithOffset>& output) 
@@ -364,20 +382,7 @@ static inline void processExportNode(const uint8_t* const start, const uint8_t*
 		EntryWithOffset e;
 		e.nodeOffset = p-start;
 		e.entry.name = strdup(cummulativeString);
-		e.entry.flags = read_uleb128(p, end);
-		if ( e.entry.flags & EXPORT_SYMBOL_FLAGS_REEXPORT ) {
-			e.entry.address = 0;
-			e.entry.other = read_uleb128(p, end); // dylib ordinal
-			e.entry.importName = (char*)p;
-		}
-		else {
-			e.entry.address = read_uleb128(p, end); 
-			if ( e.entry.flags & EXPORT_SYMBOL_FLAGS_STUB_AND_RESOLVER )
-				e.entry.other = read_uleb128(p, end); 
-			else
-				e.entry.other = 0;
-			e.entry.importName = NULL;
-		}
+		processTerminalInfo(p, end, e.entry);
 		output.push_back(e);
 	}
 	if ( children > end )
@@ -418,6 +423,107 @@ inline void parseTrie(const uint8_t* start, const uint8_t* end, std::vector<Entr
 }
 
 
+// Reads the edges leaving node p and calls handler with each edge string, its length and its child node.
+// Stops early if handler returns true.
+template <typename H>
+static inline void forEachTrieEdge(const uint8_t* const start, const uint8_t* p, const uint8_t* const end, H handler)
+{
+	if ( p >= end )
+		throw "malformed trie, node past end";
+	const uint64_t terminalSize = read_uleb128(p, end);
+	const uint8_t* s = p + terminalSize;
+	if ( s >= end )
+		throw "malformed trie, terminalSize extends beyond trie data";
+	const uint8_t childrenCount = *s++;
+	for (uint8_t i=0; i < childrenCount; ++i) {
+		const char* edge = (char*)s;
+		const size_t edgeStrLen = strnlen(edge, end-s);
+		if ( edgeStrLen == (size_t)(end-s) )
+			throw "malformed trie, edge extends beyond trie data";
+		s += edgeStrLen + 1;
+		const uint64_t childNodeOffset = read_uleb128(s, end);
+		if ( childNodeOffset == 0 )
+			throw "malformed trie, childNodeOffset==0";
+		if ( handler(edge, edgeStrLen, start + childNodeOffset) )
+			return;
+	}
+}
+
+// Looks up one symbol by walking only the edges that spell its name, so a single lookup does not
+// need the whole trie parsed.  Like dyld, this follows the first edge that is a prefix of the rest of
+// the name.  makeTrie() can add an empty edge to a node (for a name that is a prefix of one added
+// before it) and then places names added later under it, so the edges leaving a node do not always
+// start with different characters.
+inline bool findTrieEntry(const uint8_t* start, const uint8_t* end, const char* symbol, Entry& entry)
+{
+	if ( start == end )
+		return false;
+	const char* rest = symbol;
+	const uint8_t* p = start;
+	while ( p != NULL ) {
+		if ( p >= end )
+			throw "malformed trie, node past end";
+		const uint8_t* info = p;
+		if ( (*rest == '\0') && (read_uleb128(info, end) != 0) ) {
+			entry.name = symbol;
+			processTerminalInfo(info, end, entry);
+			return true;
+		}
+		const uint8_t* node = p;
+		p = NULL;
+		forEachTrieEdge(start, node, end, [&](const char* edge, size_t edgeStrLen, const uint8_t* child) {
+			if ( strncmp(edge, rest, edgeStrLen) != 0 )
+				return false;
+			rest += edgeStrLen;
+			p = child;
+			return true;
+		});
+	}
+	return false;
+}
+
+// Collects the exported symbols below node p whose names start with prefix.  cummulativeString holds the
+// curStrOffset characters of the names spelled out by the edges walked to reach p.  An empty edge can
+// lead to names with any suffix, so it is followed as well as the one edge that matches prefix.
+static inline void processExportNodeWithPrefix(const uint8_t* const start, const uint8_t* p, const uint8_t* const end,
+											   const char* prefix, size_t prefixLen, char* cummulativeString,
+											   int curStrOffset, std::vector<EntryWithOffset>& output)
+{
+	if ( prefixLen == 0 ) {
+		cummulativeString[curStrOffset] = '\0';
+		processExportNode(start, p, end, cummulativeString, curStrOffset, output);
+		return;
+	}
+	forEachTrieEdge(start, p, end, [&](const char* edge, size_t edgeStrLen, const uint8_t* child) {
+		const size_t matchLen = std::min(edgeStrLen, prefixLen);
+		if ( strncmp(edge, prefix, matchLen) == 0 ) {
+			memcpy(&cummulativeString[curStrOffset], edge, edgeStrLen);
+			processExportNodeWithPrefix(start, child, end, prefix + matchLen, prefixLen - matchLen,
+										cummulativeString, curStrOffset + (int)edgeStrLen, output);
+		}
+		return false;
+	});
+}
+
+// Like parseTrie() but only returns the exported symbols whose names start with prefix.
+inline void parseTrieWithPrefix(const uint8_t* start, const uint8_t* end, const char* prefix, std::vector<Entry>& output)
+{
+	if ( start == end )
+		return;
+	// worst case largest exported symbol names is length of whole trie
+	const size_t prefixLen = strlen(prefix);
+	char* cummulativeString = new char[end-start+prefixLen+1];
+	std::vector<EntryWithOffset> entries;
+	processExportNodeWithPrefix(start, start, end, prefix, prefixLen, cummulativeString, 0, entries);
+	// to preserve tie layout order, sort by node offset
+	std::sort(entries.begin(), entries.end());
+	output.reserve(output.size() + entries.size());
+	for (std::vector<EntryWithOffset>::iterator it=entries.begin(); it != entries.end(); ++it)
+		output.push_back(it->entry);
+	delete [] cummulativeString;
+}
+
+
 
 
 }; // namespace trie
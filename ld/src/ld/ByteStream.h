@@ -0,0 +1,109 @@
+//
+//  ByteStream.h
+//  ld
+//
+
+#ifndef __BYTE_STREAM_H__
+#define __BYTE_STREAM_H__
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <vector>
+
+namespace ld {
+namespace tool {
+
+// growable buffer that the LINKEDIT encoders append opcodes and LEB128 numbers to
+class ByteStream {
+private:
+	std::vector<uint8_t>		_data;
+public:
+	std::vector<uint8_t>& bytes() { return _data; }
+	unsigned long size() const { return _data.size(); }
+	void reserve(unsigned long l) { _data.reserve(l); }
+	const uint8_t* start() const { return &_data[0]; }
+
+	void append_uleb128(uint64_t value) {
+		uint8_t byte;
+		do {
+			byte = value & 0x7F;
+			value &= ~0x7F;
+			if ( value != 0 )
+				byte |= 0x80;
+			_data.push_back(byte);
+			value = value >> 7;
+		} while( byte >= 0x80 );
+	}
+	
+	void append_sleb128(int64_t value) {
+		bool isNeg = ( value < 0 );
+		uint8_t byte;
+		bool more;
+		do {
+			byte = value & 0x7F;
+			value = value >> 7;
+			if ( isNeg ) 
+				more = ( (value != -1) || ((byte & 0x40) == 0) );
+			else
+				more = ( (value != 0) || ((byte & 0x40) != 0) );
+			if ( more )
+				byte |= 0x80;
+			_data.push_back(byte);
+		} 
+		while( more );
+	}
+	
+	void append_delta_encoded_uleb128_run(uint64_t start, const std::vector<uint64_t>& locations) {
+		uint64_t lastAddr = start;
+		for(std::vector<uint64_t>::const_iterator it = locations.begin(); it != locations.end(); ++it) {
+			uint64_t nextAddr = *it;
+			uint64_t delta = nextAddr - lastAddr;
+			assert(delta != 0);
+			append_uleb128(delta);
+			lastAddr = nextAddr;
+		}
+	}
+
+	void append_string(const char* str) {
+		for (const char* s = str; *s != '\0'; ++s)
+			_data.push_back(*s);
+		_data.push_back('\0');
+	}
+	
+	void append_byte(uint8_t byte) {
+		_data.push_back(byte);
+	}
+	
+	void append_mem(const void* mem, size_t len) {
+		_data.insert(_data.end(), (uint8_t*)mem, (uint8_t*)mem + len);
+	}
+
+	// adds 'len' bytes to buffer and returns pointer to start of block
+	uint8_t* alloc(size_t len) {
+		size_t start = _data.size();
+		for (size_t i=0; i < len; ++i)
+			_data.push_back(0);
+		return &_data[start];
+	}
+
+	static unsigned int	uleb128_size(uint64_t value) {
+		uint32_t result = 0;
+		do {
+			value = value >> 7;
+			++result;
+		} while ( value != 0 );
+		return result;
+	}
+	
+	void pad_to_size(unsigned int alignment) {
+		while ( (_data.size() % alignment) != 0 )
+			_data.push_back(0);
+	}
+};
+
+} // namespace tool
+} // namespace ld
+
+#endif // __BYTE_STREAM_H__
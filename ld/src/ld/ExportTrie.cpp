@@ -0,0 +1,398 @@
+//
+//  ExportTrie.cpp
+//  ld
+//
+
+#include <assert.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "MapDefines.h"
+#include "ExportTrie.h"
+
+namespace ld {
+
+namespace {
+
+class ExportTrieBuilder
+{
+public:
+						ExportTrieBuilder(const std::vector<mach_o::trie::Entry>& entries);
+
+	void				build(std::vector<uint8_t>& output);
+
+private:
+	static const uint32_t kNone = UINT32_MAX;
+
+	struct Node {
+		uint32_t		cumulativeLength;
+		uint32_t		firstEdge;
+		uint32_t		lastEdge;
+		uint32_t		emptyEdge;		// edge whose string is empty, which matches any name
+		uint32_t		edgeCount;
+		uint32_t		entry;			// export at this node, kNone if none
+		uint32_t		firstVisitor;	// first entry whose path goes through this node
+		uint32_t		exportInfoSize;
+		uint32_t		fixedSize;		// size in the trie without the uleb128 child offsets
+		uint32_t		trieOffset;
+		uint32_t		streamOffset;
+	};
+
+	struct Edge {
+		const char*		string;
+		uint32_t		length;
+		uint32_t		child;
+		uint32_t		next;
+		uint32_t		position;		// index among the edges of its node
+		char			firstChar;		// '\0' for the empty edge
+	};
+
+	// nodes with more edges than this find them through _edgeByFirstChar instead of a scan
+	static const uint32_t kMaxScannedEdges = 8;
+
+	uint32_t			addNode(uint32_t cumulativeLength, uint32_t entry, uint32_t firstVisitor);
+	void				addEdge(uint32_t node, const char* string, uint32_t length, uint32_t child);
+	uint32_t			edgeToFollow(uint32_t node, const char* rest) const;
+	void				addSymbol(uint32_t entryIndex);
+	void				orderNodes();
+	const char*			importedName(const mach_o::trie::Entry& entry) const;
+	void				computeExportInfoSize(Node& node) const;
+	bool				updateOffset(Node& node, uint32_t& offset) const;
+	void				appendNode(const Node& node, uint8_t* out) const;
+
+	static uint64_t		edgeKey(uint32_t node, char firstChar) { return ((uint64_t)node << 8) | (uint8_t)firstChar; }
+	static unsigned int	uleb128_size(uint64_t value);
+	static uint8_t*		append_uleb128(uint64_t value, uint8_t* out);
+
+	const std::vector<mach_o::trie::Entry>&	_entries;
+	std::vector<Node>						_nodes;
+	std::vector<Edge>						_edges;
+	LDMap<uint64_t, uint32_t>				_edgeByFirstChar;
+	std::vector<uint32_t>					_orderedNodes;
+};
+
+ExportTrieBuilder::ExportTrieBuilder(const std::vector<mach_o::trie::Entry>& entries)
+	: _entries(entries)
+{
+	_nodes.reserve(entries.size()*2);
+	_edges.reserve(entries.size()*2);
+	_edgeByFirstChar.reserve(entries.size()/8);
+}
+
+uint32_t ExportTrieBuilder::addNode(uint32_t cumulativeLength, uint32_t entry, uint32_t firstVisitor)
+{
+	Node node;
+	node.cumulativeLength = cumulativeLength;
+	node.firstEdge = kNone;
+	node.lastEdge = kNone;
+	node.emptyEdge = kNone;
+	node.edgeCount = 0;
+	node.entry = entry;
+	node.firstVisitor = firstVisitor;
+	node.exportInfoSize = 0;
+	node.fixedSize = 0;
+	node.trieOffset = 0;
+	node.streamOffset = 0;
+	_nodes.push_back(node);
+	return (uint32_t)(_nodes.size() - 1);
+}
+
+void ExportTrieBuilder::addEdge(uint32_t node, const char* string, uint32_t length, uint32_t child)
+{
+	uint32_t edgeIndex = (uint32_t)_edges.size();
+	Node& parent = _nodes[node];
+	_edges.push_back({ string, length, child, kNone, parent.edgeCount++, (length != 0) ? string[0] : '\0' });
+	if ( parent.lastEdge == kNone )
+		parent.firstEdge = edgeIndex;
+	else
+		_edges[parent.lastEdge].next = edgeIndex;
+	parent.lastEdge = edgeIndex;
+	if ( length == 0 )
+		parent.emptyEdge = edgeIndex;
+	if ( parent.edgeCount == kMaxScannedEdges+1 ) {
+		for (uint32_t e = parent.firstEdge; e != kNone; e = _edges[e].next) {
+			if ( _edges[e].length != 0 )
+				_edgeByFirstChar[edgeKey(node, _edges[e].firstChar)] = e;
+		}
+	}
+	else if ( (parent.edgeCount > kMaxScannedEdges+1) && (length != 0) ) {
+		_edgeByFirstChar[edgeKey(node, string[0])] = edgeIndex;
+	}
+}
+
+// makeTrie() adds a symbol below the first edge, in insertion order, that shares the first
+// character of the rest of its name or is empty.  Edges other than an empty one all start with
+// different characters, so only the one starting with rest[0] and the empty edge can be that edge.
+uint32_t ExportTrieBuilder::edgeToFollow(uint32_t node, const char* rest) const
+{
+	const Node& current = _nodes[node];
+	uint32_t charEdge = kNone;
+	if ( current.edgeCount <= kMaxScannedEdges ) {
+		for (uint32_t e = current.firstEdge; e != kNone; e = _edges[e].next) {
+			const Edge& edge = _edges[e];
+			if ( edge.length == 0 )
+				return e;
+			if ( edge.firstChar == rest[0] ) {
+				charEdge = e;
+				break;
+			}
+		}
+	}
+	else if ( rest[0] != '\0' ) {
+		auto pos = _edgeByFirstChar.find(edgeKey(node, rest[0]));
+		if ( pos != _edgeByFirstChar.end() )
+			charEdge = pos->second;
+	}
+	uint32_t emptyEdge = current.emptyEdge;
+	if ( (emptyEdge != kNone) && ((charEdge == kNone) || (_edges[emptyEdge].position < _edges[charEdge].position)) )
+		return emptyEdge;
+	return charEdge;
+}
+
+void ExportTrieBuilder::addSymbol(uint32_t entryIndex)
+{
+	const mach_o::trie::Entry& entry = _entries[entryIndex];
+	uint32_t node = 0;
+	for (;;) {
+		const char* rest = &entry.name[_nodes[node].cumulativeLength];
+		uint32_t edgeIndex = edgeToFollow(node, rest);
+		if ( edgeIndex == kNone )
+			break;
+		Edge& edge = _edges[edgeIndex];
+		uint32_t matching = 0;
+		while ( (matching < edge.length) && (edge.string[matching] == rest[matching]) )
+			++matching;
+		if ( matching == edge.length ) {
+			// already have matching edge, go down that path
+			node = edge.child;
+			continue;
+		}
+		// found a common substring, splice in new node
+		//  was A -> C,  now A -> B -> C
+		uint32_t cNode = edge.child;
+		const char* bcString = &edge.string[matching];
+		uint32_t bcLength = edge.length - matching;
+		uint32_t bNode = addNode(_nodes[node].cumulativeLength + matching, kNone, _nodes[cNode].firstVisitor);
+		_edges[edgeIndex].length = matching;
+		_edges[edgeIndex].child = bNode;
+		addEdge(bNode, bcString, bcLength, cNode);
+		node = bNode;
+	}
+
+	if ( entry.flags & EXPORT_SYMBOL_FLAGS_REEXPORT ) {
+		assert(entry.importName != NULL);
+		assert(entry.other != 0);
+	}
+	if ( entry.flags & EXPORT_SYMBOL_FLAGS_STUB_AND_RESOLVER ) {
+		assert(entry.other != 0);
+	}
+	// no commonality with any existing child, make a new edge that is the rest of the string
+	uint32_t cumulativeLength = _nodes[node].cumulativeLength;
+	const char* rest = &entry.name[cumulativeLength];
+	uint32_t restLength = (uint32_t)strlen(rest);
+	// a name added again hangs off the node for its first copy by an empty edge, and the path of
+	// that first copy continues down it
+	uint32_t firstVisitor = entryIndex;
+	if ( (restLength == 0) && (_nodes[node].entry != kNone) )
+		firstVisitor = _nodes[node].firstVisitor;
+	uint32_t newNode = addNode(cumulativeLength + restLength, entryIndex, firstVisitor);
+	addEdge(node, rest, restLength, newNode);
+}
+
+// makeTrie() lays out nodes in the order the paths of the entries, in entry order, first reach
+// them.  Entries are added in that same order, so that is by the first entry whose path went
+// through a node, and along one path by depth, which is by cumulative length or, for nodes below
+// an empty edge, by creation.
+void ExportTrieBuilder::orderNodes()
+{
+	std::vector<uint32_t> bucketStarts(_entries.size() + 1, 0);
+	for (const Node& node : _nodes)
+		++bucketStarts[node.firstVisitor + 1];
+	for (size_t i = 1; i < bucketStarts.size(); ++i)
+		bucketStarts[i] += bucketStarts[i-1];
+	_orderedNodes.resize(_nodes.size());
+	std::vector<uint32_t> bucketEnds(bucketStarts.begin(), bucketStarts.end() - 1);
+	for (uint32_t i = 0; i < _nodes.size(); ++i)
+		_orderedNodes[bucketEnds[_nodes[i].firstVisitor]++] = i;
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, _entries.size()), [&](const tbb::blocked_range<size_t>& range) {
+		for (size_t entry = range.begin(); entry != range.end(); ++entry) {
+			std::stable_sort(&_orderedNodes[bucketStarts[entry]], &_orderedNodes[bucketStarts[entry+1]], [&](uint32_t a, uint32_t b) {
+				return _nodes[a].cumulativeLength < _nodes[b].cumulativeLength;
+			});
+		}
+	});
+}
+
+const char* ExportTrieBuilder::importedName(const mach_o::trie::Entry& entry) const
+{
+	if ( (entry.flags & EXPORT_SYMBOL_FLAGS_REEXPORT) && (entry.importName != NULL) && (strcmp(entry.name, entry.importName) != 0) )
+		return entry.importName;
+	return NULL;
+}
+
+void ExportTrieBuilder::computeExportInfoSize(Node& node) const
+{
+	uint32_t nodeSize = 1; // length of export info when no export info
+	if ( node.entry != kNone ) {
+		const mach_o::trie::Entry& entry = _entries[node.entry];
+		if ( entry.flags & EXPORT_SYMBOL_FLAGS_REEXPORT ) {
+			node.exportInfoSize = uleb128_size(entry.flags) + uleb128_size(entry.other); // ordinal
+			if ( const char* importName = importedName(entry) )
+				node.exportInfoSize += strlen(importName);
+			++node.exportInfoSize; // trailing zero in imported name
+		}
+		else {
+			node.exportInfoSize = uleb128_size(entry.flags) + uleb128_size(entry.address);
+			if ( entry.flags & EXPORT_SYMBOL_FLAGS_STUB_AND_RESOLVER )
+				node.exportInfoSize += uleb128_size(entry.other);
+		}
+		// do have export info, overall node size so far is uleb128 of export info + export info
+		nodeSize = node.exportInfoSize + uleb128_size(node.exportInfoSize);
+	}
+	++nodeSize; // byte for count of children
+	for (uint32_t edgeIndex = node.firstEdge; edgeIndex != kNone; edgeIndex = _edges[edgeIndex].next)
+		nodeSize += _edges[edgeIndex].length + 1;
+	node.fixedSize = nodeSize;
+}
+
+bool ExportTrieBuilder::updateOffset(Node& node, uint32_t& offset) const
+{
+	uint32_t nodeSize = node.fixedSize;
+	for (uint32_t edgeIndex = node.firstEdge; edgeIndex != kNone; edgeIndex = _edges[edgeIndex].next)
+		nodeSize += uleb128_size(_nodes[_edges[edgeIndex].child].trieOffset);
+	bool result = (node.trieOffset != offset);
+	node.trieOffset = offset;
+	offset += nodeSize;
+	// return true if trieOffset was changed
+	return result;
+}
+
+void ExportTrieBuilder::appendNode(const Node& node, uint8_t* out) const
+{
+	// like makeTrie(), export info size is written as one byte, where offsets allowed for a uleb128
+	if ( node.entry != kNone ) {
+		const mach_o::trie::Entry& entry = _entries[node.entry];
+		*out++ = (uint8_t)node.exportInfoSize;
+		out = append_uleb128(entry.flags, out);
+		if ( entry.flags & EXPORT_SYMBOL_FLAGS_REEXPORT ) {
+			out = append_uleb128(entry.other, out);
+			if ( const char* importName = importedName(entry) ) {
+				size_t length = strlen(importName);
+				memcpy(out, importName, length);
+				out += length;
+			}
+			*out++ = '\0';
+		}
+		else {
+			out = append_uleb128(entry.address, out);
+			if ( entry.flags & EXPORT_SYMBOL_FLAGS_STUB_AND_RESOLVER )
+				out = append_uleb128(entry.other, out);
+		}
+	}
+	else {
+		// no export info uleb128 of zero is one byte of zero
+		*out++ = 0;
+	}
+	// write number of children
+	*out++ = (uint8_t)node.edgeCount;
+	// write each child
+	for (uint32_t edgeIndex = node.firstEdge; edgeIndex != kNone; edgeIndex = _edges[edgeIndex].next) {
+		const Edge& edge = _edges[edgeIndex];
+		memcpy(out, edge.string, edge.length);
+		out += edge.length;
+		*out++ = '\0';
+		out = append_uleb128(_nodes[edge.child].trieOffset, out);
+	}
+}
+
+void ExportTrieBuilder::build(std::vector<uint8_t>& output)
+{
+	if ( _entries.empty() )
+		return;
+
+	// make nodes for all exported symbols
+	addNode(0, kNone, 0);
+	for (uint32_t i = 0; i < _entries.size(); ++i)
+		addSymbol(i);
+
+	// create vector of nodes
+	orderNodes();
+
+	// assign each node in the vector an offset in the trie stream, iterating until all uleb128 sizes have stabilized
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, _nodes.size()), [&](const tbb::blocked_range<size_t>& range) {
+		for (size_t i = range.begin(); i != range.end(); ++i)
+			computeExportInfoSize(_nodes[i]);
+	});
+	bool more;
+	do {
+		uint32_t offset = 0;
+		more = false;
+		for (uint32_t node : _orderedNodes) {
+			if ( updateOffset(_nodes[node], offset) )
+				more = true;
+		}
+	} while ( more );
+
+	// where each node lands in the stream, which differs from its trie offset if it has export info
+	// whose size takes more than one byte as a uleb128
+	uint64_t streamSize = 0;
+	for (uint32_t node : _orderedNodes) {
+		Node& current = _nodes[node];
+		uint32_t nodeSize = current.fixedSize;
+		for (uint32_t edgeIndex = current.firstEdge; edgeIndex != kNone; edgeIndex = _edges[edgeIndex].next)
+			nodeSize += uleb128_size(_nodes[_edges[edgeIndex].child].trieOffset);
+		if ( current.entry != kNone )
+			nodeSize -= uleb128_size(current.exportInfoSize) - 1;
+		current.streamOffset = (uint32_t)streamSize;
+		streamSize += nodeSize;
+	}
+
+	// create trie stream, every node writing its own range
+	size_t start = output.size();
+	output.resize(start + streamSize);
+	uint8_t* stream = &output[start];
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, _orderedNodes.size(), 1024), [&](const tbb::blocked_range<size_t>& range) {
+		for (size_t i = range.begin(); i != range.end(); ++i) {
+			const Node& node = _nodes[_orderedNodes[i]];
+			appendNode(node, &stream[node.streamOffset]);
+		}
+	});
+}
+
+unsigned int ExportTrieBuilder::uleb128_size(uint64_t value)
+{
+	uint32_t result = 0;
+	do {
+		value = value >> 7;
+		++result;
+	} while ( value != 0 );
+	return result;
+}
+
+uint8_t* ExportTrieBuilder::append_uleb128(uint64_t value, uint8_t* out)
+{
+	uint8_t byte;
+	do {
+		byte = value & 0x7F;
+		value &= ~0x7F;
+		if ( value != 0 )
+			byte |= 0x80;
+		*out++ = byte;
+		value = value >> 7;
+	} while( byte >= 0x80 );
+	return out;
+}
+
+} // anonymous namespace
+
+void makeExportTrie(const std::vector<mach_o::trie::Entry>& entries, std::vector<uint8_t>& output)
+{
+	ExportTrieBuilder builder(entries);
+	builder.build(output);
+}
+
+} // namespace ld
@@ -0,0 +1,29 @@
+//
+//  ExportTrie.h
+//  ld
+//
+
+#ifndef __EXPORT_TRIE_H__
+#define __EXPORT_TRIE_H__
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "MachOTrie.hpp"
+
+namespace ld {
+
+//
+// makeExportTrie appends the same bytes as mach_o::trie::makeTrie() to output.  Nodes and edges
+// live in flat arrays, edge strings point into the entry names instead of being copied, an edge
+// is found by its first character (through a hash table for nodes with many edges), nodes are
+// put in stream order by a bucket sort instead of walking every name a second time, and once
+// their offsets are known they are serialized in parallel.  The entries' order still decides the
+// shape of the trie and the order of its nodes and edges, exactly as in makeTrie().
+//
+void makeExportTrie(const std::vector<mach_o::trie::Entry>& entries, std::vector<uint8_t>& output);
+
+} // namespace ld
+
+#endif // __EXPORT_TRIE_H__
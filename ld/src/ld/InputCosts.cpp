@@ -0,0 +1,175 @@
+//
+//  InputCosts.cpp
+//  ld
+//
+
+#include <stdio.h>
+#include <mach/mach_time.h>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "ld.hpp"
+#include "InputCosts.h"
+
+namespace ld {
+
+std::atomic<bool> InputCosts::_s_enabled(false);
+
+struct Cost {
+	uint64_t	parseTime		= 0;
+	uint64_t	bytesMapped		= 0;
+	uint64_t	probes			= 0;
+	uint64_t	atoms			= 0;
+	uint64_t	fixups			= 0;
+	uint64_t	outputBytes		= 0;
+};
+
+static std::mutex								sCostLock;
+static uint32_t									sPrintCount = 0;
+static LDMap<std::string, Cost>					sCosts;
+static LDMap<std::string, Cost>					sDeferredCosts;
+// probes are counted by file rather than path, so the resolver does not build a string each time
+static LDMap<const ld::File*, uint64_t>			sProbes;
+
+
+InputCosts::Parse::Parse(const char* path, bool deferred)
+	: _recording(InputCosts::enabled()), _deferred(deferred), _bytesMapped(0), _startTime(0)
+{
+	if ( !_recording )
+		return;
+	_path = path;
+	_startTime = mach_absolute_time();
+}
+
+InputCosts::Parse::~Parse()
+{
+	if ( !_recording )
+		return;
+	uint64_t parseTime = mach_absolute_time() - _startTime;
+	std::lock_guard<std::mutex> guard(sCostLock);
+	Cost& cost = (_deferred ? sDeferredCosts : sCosts)[_path];
+	cost.parseTime += parseTime;
+	cost.bytesMapped += _bytesMapped;
+}
+
+void InputCosts::loaded(const char* path)
+{
+	if ( !enabled() )
+		return;
+	std::lock_guard<std::mutex> guard(sCostLock);
+	const auto pos = sDeferredCosts.find(path);
+	if ( pos == sDeferredCosts.end() )
+		return;
+	Cost& cost = sCosts[path];
+	cost.parseTime += pos->second.parseTime;
+	cost.bytesMapped += pos->second.bytesMapped;
+	sDeferredCosts.erase(pos);
+}
+
+void InputCosts::start(uint32_t count)
+{
+	sPrintCount = count;
+	_s_enabled.store(true, std::memory_order_relaxed);
+}
+
+void InputCosts::addProbe(const ld::File* library)
+{
+	if ( !enabled() )
+		return;
+	std::lock_guard<std::mutex> guard(sCostLock);
+	++sProbes[library];
+}
+
+// sections whose atoms take up no bytes in the output file
+static bool takesNoFileSpace(const ld::Section& sect)
+{
+	switch ( sect.type() ) {
+		case ld::Section::typeZeroFill:
+		case ld::Section::typeTLVZeroFill:
+		case ld::Section::typeTentativeDefs:
+		case ld::Section::typePageZero:
+		case ld::Section::typeStack:
+		case ld::Section::typeAbsoluteSymbols:
+			return true;
+		default:
+			break;
+	}
+	return sect.isSectionHidden();
+}
+
+void InputCosts::addOutput(const ld::Internal& state)
+{
+	if ( !enabled() )
+		return;
+	std::lock_guard<std::mutex> guard(sCostLock);
+	// consecutive atoms usually come from the same file, so only look the path up when it changes
+	const ld::File* lastFile = NULL;
+	Cost* cost = NULL;
+	for (const ld::Internal::FinalSection* sect : state.sections) {
+		const bool noFileSpace = takesNoFileSpace(*sect);
+		for (const ld::Atom* atom : sect->atoms) {
+			const ld::File* file = atom->file();
+			if ( file == NULL )
+				continue;
+			if ( file != lastFile ) {
+				lastFile = file;
+				cost = &sCosts[file->path()];
+			}
+			++cost->atoms;
+			cost->fixups += (atom->fixupsEnd() - atom->fixupsBegin());
+			if ( !noFileSpace )
+				cost->outputBytes += atom->size();
+		}
+	}
+}
+
+void InputCosts::print()
+{
+	if ( !enabled() )
+		return;
+	std::lock_guard<std::mutex> guard(sCostLock);
+	for (const auto& probe : sProbes)
+		sCosts[probe.first->path()].probes += probe.second;
+
+	std::vector<std::pair<const std::string*, const Cost*>> sorted;
+	sorted.reserve(sCosts.size());
+	Cost total;
+	for (const auto& entry : sCosts) {
+		sorted.emplace_back(&entry.first, &entry.second);
+		total.parseTime   += entry.second.parseTime;
+		total.bytesMapped += entry.second.bytesMapped;
+		total.probes      += entry.second.probes;
+		total.atoms       += entry.second.atoms;
+		total.fixups      += entry.second.fixups;
+		total.outputBytes += entry.second.outputBytes;
+	}
+	// most expensive to parse first, then the ones that added most to the output, then by path so runs compare
+	std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+		if ( a.second->parseTime != b.second->parseTime )
+			return a.second->parseTime > b.second->parseTime;
+		if ( a.second->outputBytes != b.second->outputBytes )
+			return a.second->outputBytes > b.second->outputBytes;
+		return *a.first < *b.first;
+	});
+
+	mach_timebase_info_data_t timebase;
+	mach_timebase_info(&timebase);
+	auto milliseconds = [&](uint64_t time) -> double {
+		return (double)time * timebase.numer / timebase.denom / 1000000.0;
+	};
+	auto printRow = [&](const Cost& cost, const char* path) {
+		fprintf(stderr, "%10.2f %14llu %10llu %10llu %10llu %14llu  %s\n", milliseconds(cost.parseTime), cost.bytesMapped,
+				cost.probes, cost.atoms, cost.fixups, cost.outputBytes, path);
+	};
+
+	const size_t count = std::min<size_t>(sPrintCount, sorted.size());
+	fprintf(stderr, "top %zu of %zu inputs by parse time:\n", count, sorted.size());
+	fprintf(stderr, "%10s %14s %10s %10s %10s %14s  %s\n", "parse ms", "mapped bytes", "probes", "atoms", "fixups", "output bytes", "input");
+	for (size_t i = 0; i < count; ++i)
+		printRow(*sorted[i].second, sorted[i].first->c_str());
+	printRow(total, "(all inputs)");
+}
+
+} // namespace ld
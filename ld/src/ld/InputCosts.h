@@ -0,0 +1,63 @@
+//
+//  InputCosts.h
+//  ld
+//
+
+#ifndef __INPUT_COSTS_H__
+#define __INPUT_COSTS_H__
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+namespace ld {
+
+class File;
+class Internal;
+
+//
+// InputCosts attributes the cost of the link to each input file: how long it took to parse, how
+// many bytes were mapped for it, how often the resolver probed it for undefined symbols, and how
+// many atoms, fixups and bytes it put in the output.  At the end of the link the most expensive
+// inputs are printed (-zld_input_costs <count>).  Until it starts, each hook costs one flag check.
+//
+class InputCosts
+{
+public:
+	// records the time from its construction to its destruction as the parse time of path, a deferred
+	// (speculative) parse only counts once loaded() says the file was used
+	class Parse
+	{
+	public:
+						Parse(const char* path, bool deferred=false);
+						~Parse();
+		void			bytesMapped(uint64_t bytes)	{ _bytesMapped = bytes; }
+
+	private:
+		bool			_recording;
+		bool			_deferred;
+		std::string		_path;
+		uint64_t		_bytesMapped;
+		uint64_t		_startTime;
+	};
+
+	// starts recording, count is how many inputs print() shows
+	static void			start(uint32_t count);
+	static bool			enabled()				{ return _s_enabled.load(std::memory_order_relaxed); }
+	// the file at path, parsed speculatively, was loaded after all
+	static void			loaded(const char* path);
+	// the resolver looked in library for a symbol
+	static void			addProbe(const ld::File* library);
+	// attributes the atoms of the final sections to the files they came from
+	static void			addOutput(const ld::Internal& state);
+	// prints the inputs that took longest to parse, with their other costs, to stderr
+	static void			print();
+
+private:
+	static std::atomic<bool>	_s_enabled;
+};
+
+} // namespace ld
+
+#endif // __INPUT_COSTS_H__
@@ -45,6 +45,7 @@
 #include <Foundation/Foundation.h>
 #include "pstl/algorithm"
 #include "pstl/execution"
+#include <tbb/global_control.h>
 
 #include <fstream>
 #include <string>
@@ -68,6 +69,8 @@
 #include "opaque_section_file.h"
 #include "MachOFileAbstraction.hpp"
 #include "Snapshot.h"
+#include "TraceEvents.h"
+#include "InputCosts.h"
 
 const bool _s_logPThreads = false;
 
@@ -229,6 +232,8 @@ const char* InputFiles::extractFileInfo(const uint8_t* p, unsigned len, const ch
 
 ld::File* InputFiles::makeFile(const Options::FileInfo& info, bool indirectDylib)
 {
+	ld::TraceEvents::Span span(indirectDylib ? "parse indirect dylib" : "parse input file", "input", info.path);
+	ld::InputCosts::Parse cost(info.path);
 	bool fromSDK = _options.fromSDK(info.path);
 	// handle inlined framework first.
 	if (info.isInlined) {
@@ -250,9 +255,11 @@ ld::File* InputFiles::makeFile(const Options::FileInfo& info, bool indirectDylib
 	if ( stat_buf.st_size < 20 )
 		throwf("file too small (length=%llu)", stat_buf.st_size);
 	int64_t len = stat_buf.st_size;
+	span.counter("bytes", len);
 	uint8_t* p = (uint8_t*)::mmap(NULL, stat_buf.st_size, PROT_READ, MAP_FILE | MAP_PRIVATE, fd, 0);
 	if ( p == (uint8_t*)(-1) )
 		throwf("can't map file, errno=%d", errno);
+	_linkStateCache.fileLoaded(info.path, stat_buf);
 
 	// if fat file, skip to architecture we want
 	// Note: fat header is always big-endian
@@ -336,6 +343,8 @@ ld::File* InputFiles::makeFile(const Options::FileInfo& info, bool indirectDylib
 		}
 	}
 	::close(fd);
+	// only the slice for the architecture being linked stays mapped
+	cost.bytesMapped(len);
 
 	// see if it is an object file
 	mach_o::relocatable::ParserOptions objOpts;
@@ -595,8 +604,23 @@ ld::dylib::File* InputFiles::findDylib(const char* installPath, const ld::dylib:
 			}
 		}
 
-		// search for dylib using -F and -L paths and expanding @ paths
-		Options::FileInfo info = _options.findIndirectDylib(installPath, fromDylib);
+		// search for dylib using -F and -L paths and expanding @ paths, unless the previous link already did.
+		// The search records paths it did not find for -dependency_info, so always search in that case.
+		// The paths it did not find are also what decides whether the next link can reuse its answer.
+		Options::FileInfo info;
+		const char* fromPath = (fromDylib != NULL) ? fromDylib->path() : NULL;
+		const char* cachedPath = _options.dumpDependencyInfo() ? NULL : _linkStateCache.indirectDylibPath(installPath, fromPath);
+		if ( (cachedPath != NULL) && info.checkFileExists(_options, cachedPath) ) {
+			_linkStateCache.addIndirectDylib(installPath, fromPath, info.path, NULL);
+		}
+		else {
+			std::vector<std::string> missingPaths;
+			{
+				Options::MissingPathCapture capture(missingPaths);
+				info = _options.findIndirectDylib(installPath, fromDylib);
+			}
+			_linkStateCache.addIndirectDylib(installPath, fromPath, info.path, &missingPaths);
+		}
 		_indirectDylibOrdinal = _indirectDylibOrdinal.nextIndirectDylibOrdinal();
 		info.ordinal = _indirectDylibOrdinal;
 		info.options.fIndirectDylib = true;
@@ -958,12 +982,14 @@ InputFiles::InputFiles(Options& opts)
 	_options(opts), _bundleLoader(NULL), 
 	_exception(NULL), 
 	_indirectDylibOrdinal(ld::File::Ordinal::indirectDylibBase()),
-	_linkerOptionOrdinal(ld::File::Ordinal::linkeOptionBase())
+	_linkerOptionOrdinal(ld::File::Ordinal::linkeOptionBase()),
+	_linkStateCache(opts),
+	_indexedLibraryCount(0)
 {
+	_linkStateCache.load();
 //	fStartCreateReadersTime = mach_absolute_time();
 #if HAVE_PTHREADS
 	pthread_mutex_init(&_parseLock, NULL);
-	pthread_cond_init(&_parseWorkReady, NULL);
 	pthread_cond_init(&_newFileAvailable, NULL);
 	_neededFileSlot = -1;
 #endif
@@ -998,26 +1024,19 @@ InputFiles::InputFiles(Options& opts)
 #if HAVE_PTHREADS
 	_remainingInputFiles = files.size();
 	
-	// initialize info for parsing input files on worker threads
-	unsigned int ncpus;
-	int mib[2];
-	size_t len = sizeof(ncpus);
-	mib[0] = CTL_HW;
-	mib[1] = HW_NCPU;
-	if (sysctl(mib, 2, &ncpus, &len, NULL, 0) != 0) {
-		ncpus = 1;
-	}
-	_availableWorkers = MIN(ncpus, files.size()); // max # workers we permit
-	_idleWorkers = 0;
+	// initialize info for parsing input files on the shared scheduler
+	_maxParseTasks = MIN(tbb::global_control::active_value(tbb::global_control::max_allowed_parallelism), files.size());
+	_parseTaskCount = 0;
 	
 	if (_options.pipelineEnabled()) {
 		// start up a thread to listen for available input files
 		startThread(InputFiles::waitForInputFiles);
 	}
 
-	// Start up one parser thread. More start on demand as parsed input files get consumed.
-	startThread(InputFiles::parseWorkerThread);
-	_availableWorkers--;
+	// Start up one parse task. More start on demand as parsed input files get consumed.
+	pthread_mutex_lock(&_parseLock);
+	startParseTasks();
+	pthread_mutex_unlock(&_parseLock);
 #else
 	if (_options.pipelineEnabled()) {
 		throwf("pipelined linking not supported on this platform");
@@ -1038,74 +1057,79 @@ void InputFiles::startThread(void (*threadFunc)(InputFiles *)) const {
 	pthread_attr_destroy(&attr);
 }
 
-// Work loop for input file parsing threads
-void InputFiles::parseWorkerThread() {
+// Parses the input file in slot, which must be ready to parse, for the main thread to consume.
+// Called with _parseLock held, which is dropped while the file is parsed.
+void InputFiles::parseInputFile(int slot) {
+	Options::FileInfo& entry = (Options::FileInfo&)_options.getInputFiles()[slot];
 	ld::File *file;
 	const char *exception = NULL;
-	pthread_mutex_lock(&_parseLock);
-	const std::vector<Options::FileInfo>& files = _options.getInputFiles();
-	if (_s_logPThreads) printf("worker starting\n");
-	do {
-		if (_availableInputFiles == 0) {
-			_idleWorkers++;
-			pthread_cond_wait(&_parseWorkReady, &_parseLock);
-			_idleWorkers--;
-		} else {
-			int slot = _parseCursor;
-			while (slot < (int)files.size() && (_inputFiles[slot] != NULL || !files[slot].readyToParse))
-				slot++;
-			assert(slot < (int)files.size());
-			Options::FileInfo& entry = (Options::FileInfo&)files[slot];
-			_parseCursor = slot+1;
-			_availableInputFiles--;
-			entry.readyToParse = false; // to avoid multiple threads finding this file
-			pthread_mutex_unlock(&_parseLock);
-			if (_s_logPThreads) printf("parsing index %u\n", slot);
-			try {
-				file = makeFile(entry, false);
-			}
-			catch (const char *msg) {
-				if ( ((strstr(msg, "architecture") != NULL)  || (strstr(msg, "attempting to link") != NULL)) && !_options.errorOnOtherArchFiles() ) {
-					if ( _options.ignoreOtherArchInputFiles() ) {
-						// ignore, because this is about an architecture not in use
-					}
-					else {
-						warning("ignoring file %s, %s", entry.path, msg);
-					}
-				} 
-				else if ( strstr(msg, "ignoring unexpected") != NULL ) {
-					warning("%s, %s", entry.path, msg);
-				}
-				else {
-					asprintf((char**)&exception, "%s file '%s'", msg, entry.path);
-				}
-				file = new IgnoredFile(entry.path, entry.modTime, entry.ordinal, ld::File::Other);
+	entry.readyToParse = false; // to avoid multiple threads finding this file
+	_availableInputFiles--;
+	pthread_mutex_unlock(&_parseLock);
+	if (_s_logPThreads) printf("parsing index %u\n", slot);
+	try {
+		file = makeFile(entry, false);
+	}
+	catch (const char *msg) {
+		if ( ((strstr(msg, "architecture") != NULL)  || (strstr(msg, "attempting to link") != NULL)) && !_options.errorOnOtherArchFiles() ) {
+			if ( _options.ignoreOtherArchInputFiles() ) {
+				// ignore, because this is about an architecture not in use
 			}
-			pthread_mutex_lock(&_parseLock);
-			if (_remainingInputFiles > 0)
-				_remainingInputFiles--;
-			if (_s_logPThreads) printf("done with index %u, %d remaining\n", slot, _remainingInputFiles);
-			if (exception) {
-				// We are about to die, so set to zero to stop other threads from doing unneeded work.
-				_remainingInputFiles = 0;
-				_exception = exception;
-			} 
 			else {
-				_inputFiles[slot] = file;
-				if (_neededFileSlot == slot)
-					pthread_cond_signal(&_newFileAvailable);
+				warning("ignoring file %s, %s", entry.path, msg);
 			}
+		} 
+		else if ( strstr(msg, "ignoring unexpected") != NULL ) {
+			warning("%s, %s", entry.path, msg);
 		}
-	} while (_remainingInputFiles);
-	if (_s_logPThreads) printf("worker exiting\n");
-	pthread_cond_broadcast(&_parseWorkReady);
-	pthread_cond_signal(&_newFileAvailable);
-	pthread_mutex_unlock(&_parseLock);
+		else {
+			asprintf((char**)&exception, "%s file '%s'", msg, entry.path);
+		}
+		file = new IgnoredFile(entry.path, entry.modTime, entry.ordinal, ld::File::Other);
+	}
+	pthread_mutex_lock(&_parseLock);
+	if (_remainingInputFiles > 0)
+		_remainingInputFiles--;
+	if (_s_logPThreads) printf("done with index %u, %d remaining\n", slot, _remainingInputFiles);
+	if (exception) {
+		// We are about to die, so set to zero to stop other tasks from doing unneeded work.
+		_remainingInputFiles = 0;
+		_exception = exception;
+		pthread_cond_signal(&_newFileAvailable);
+	} 
+	else {
+		_inputFiles[slot] = file;
+		if (_neededFileSlot == slot)
+			pthread_cond_signal(&_newFileAvailable);
+	}
 }
 
+// Parse task: parses input files that are ready to parse until none are left
+void InputFiles::parseInputFiles() {
+	const std::vector<Options::FileInfo>& files = _options.getInputFiles();
+	pthread_mutex_lock(&_parseLock);
+	if (_s_logPThreads) printf("parse task starting\n");
+	while (_remainingInputFiles && _availableInputFiles) {
+		int slot = _parseCursor;
+		while (slot < (int)files.size() && (_inputFiles[slot] != NULL || !files[slot].readyToParse))
+			slot++;
+		assert(slot < (int)files.size());
+		_parseCursor = slot+1;
+		parseInputFile(slot);
+	}
+	if (_s_logPThreads) printf("parse task exiting\n");
+	_parseTaskCount--;
+	pthread_mutex_unlock(&_parseLock);
+}
 
-void InputFiles::parseWorkerThread(InputFiles *inputFiles) {
-	inputFiles->parseWorkerThread();
+// Starts another parse task if there are more files ready to parse than tasks to parse them.
+// Called on the main thread with _parseLock held, so that every task is in the arena it waits on.
+void InputFiles::startParseTasks() {
+	if (_availableInputFiles > _parseTaskCount && _parseTaskCount < _maxParseTasks) {
+		if (_s_logPThreads) printf("starting parse task\n");
+		_parseTaskCount++;
+		_parseTasks.run([this] { parseInputFiles(); });
+	}
 }
 #endif
 
@@ -1210,8 +1234,10 @@ void InputFiles::waitForInputFiles()
 			if (!inputInfo->checkFileExists(_options))
 				throwf("pipelined linking error - file does not exist: %s\n", inputInfo->path);
 			pthread_mutex_lock(&_parseLock);
-			if (_idleWorkers)
-				pthread_cond_signal(&_parseWorkReady);
+			// wake the main thread, which parses the file it needs or starts a task for it.  Tasks are
+			// only started from the main thread, as a task run from this thread would go to its own
+			// arena, which the main thread's wait for tasks does not help with or wait for
+			pthread_cond_signal(&_newFileAvailable);
 			inputInfo->readyToParse = true;
 			if (_parseCursor > inputInfo->inputFileSlot)
 				_parseCursor = inputInfo->inputFileSlot;
@@ -1245,14 +1271,16 @@ void InputFiles::forEachInitialAtom(ld::File::AtomHandler& handler, ld::Internal
 #if HAVE_PTHREADS
 		pthread_mutex_lock(&_parseLock);
 		
-		// this loop waits for the needed file to be ready (parsed by worker thread)
+		// this loop waits for the needed file to be ready (parsed by a parse task)
 		while (_inputFiles[fileIndex] == NULL && _exception == NULL) {
 			// We are starved for input. If there are still files to parse and we have
-			// not maxed out the worker thread count start a new worker thread.
-			if (_availableInputFiles > 0 && _availableWorkers > 0) {
-				if (_s_logPThreads) printf("starting worker\n");
-				startThread(InputFiles::parseWorkerThread);
-				_availableWorkers--;
+			// not maxed out the parse task count start a new parse task.
+			startParseTasks();
+			if (files[fileIndex].readyToParse) {
+				// no task has picked up the needed file yet, so parse it here instead of waiting
+				if (_s_logPThreads) printf("consumer parsing %lu: %s\n", fileIndex, files[fileIndex].path);
+				parseInputFile(fileIndex);
+				continue;
 			}
 			_neededFileSlot = fileIndex;
 			if (_s_logPThreads) printf("consumer blocking for %lu: %s\n", fileIndex, files[fileIndex].path);
@@ -1261,7 +1289,8 @@ void InputFiles::forEachInitialAtom(ld::File::AtomHandler& handler, ld::Internal
 
 		if (_exception) {
 			// <rdar://problem/16525216> the tool is erroring out.  wait for other threads to finish so we don't destruct global objects out from under them
-			sleep(1);
+			pthread_mutex_unlock(&_parseLock);
+			_parseTasks.wait();
 			throw _exception;
 		}
 
@@ -1318,9 +1347,11 @@ void InputFiles::forEachInitialAtom(ld::File::AtomHandler& handler, ld::Internal
 			asprintf((char**)&_exception, "%s file '%s'", msg, file->path());
 		}
 	}
+#if HAVE_PTHREADS
+	// every file is parsed, so this only waits for the parse tasks to notice
+	_parseTasks.wait();
+#endif
 	if (_exception) {
-		// <rdar://problem/16525216> the tool is erroring out.  wait for other threads to finish so we don't destruct global objects out from under them
-		sleep(1);
 		throw _exception;
 	}
 
@@ -1390,23 +1421,7 @@ void InputFiles::forEachInitialAtom(ld::File::AtomHandler& handler, ld::Internal
 
 
 void InputFiles::preParseLibraries() const {
-	std::string line;
-	std::ifstream infile(_options.cacheFilePath());
-	LDSet<std::string> currentSet;
-	LDMap<std::string, LDSet<std::string>> map;
-	std::string currentLib;
-	std::getline(infile, currentLib);
-	while (std::getline(infile, line)) {
-		if (line[0] == '\t') {
-			line.erase(0, 1);
-			currentSet.insert(line);
-		} else {
-			map[currentLib] = currentSet;
-			currentLib = line;
-			currentSet = LDSet<std::string>();
-		}
-	}
-	map[currentLib] = currentSet;
+	// parse in parallel the archive members the previous link of this output loaded
 	struct Operation {
 		void *_member;
 		ld::archive::File *_file;
@@ -1417,22 +1432,16 @@ void InputFiles::preParseLibraries() const {
     for (std::vector<LibraryInfo>::const_iterator it=_searchLibraries.begin(); it != _searchLibraries.end(); ++it) {
 		auto lib = *it;
 		if (lib.isDylib()) {
-			auto dylib = lib.dylib();
-			auto it = map.find(dylib->path());
-			if (it == map.end()) {
-				continue;
-			}
-			//dylib->insertFilesToLoad();
-		} else {
-			auto archiveFile = lib.archive();
-			auto it = map.find(archiveFile->path());
-			if (it == map.end()) {
-				continue;
-			}
-			auto members = archiveFile->membersToParse(it->second);
-			for (auto member : members) {
-				ops.emplace_back(member, archiveFile);
-			}
+			continue;
+		}
+		auto archiveFile = lib.archive();
+		LDSet<std::string> memberNames;
+		if (!_linkStateCache.archiveMembers(archiveFile->path(), memberNames)) {
+			continue;
+		}
+		auto members = archiveFile->membersToParse(memberNames);
+		for (auto member : members) {
+			ops.emplace_back(member, archiveFile);
 		}
 	}
 	const tbb::blocked_range<size_t> range(0, ops.size());
@@ -1443,61 +1452,160 @@ void InputFiles::preParseLibraries() const {
 	});
 }
 
-void InputFiles::dumpMembersParsed(std::ofstream &stream) const {
-    for (std::vector<LibraryInfo>::const_iterator it=_searchLibraries.begin(); it != _searchLibraries.end(); ++it) {
-		auto lib = *it;
-		if (lib.isDylib()) {
-		} else {
-			auto archive = lib.archive();
-			archive->dumpMembersParsed(stream);
+void InputFiles::preParseArchiveMembers(const std::vector<const char*>& names) const
+{
+	// Speculatively parse the member that the first library defining each name would load.  Members are
+	// still loaded one name at a time in search order by searchLibraries(), which then just finds them
+	// already parsed, so load order and ordinals are unchanged.  Names that a library searched for every
+	// name might provide first are skipped, and a member's warnings and parse cost are only reported if
+	// it is loaded, so a wrong guess only costs a parse.
+	this->indexSearchLibraries();
+	struct Operation {
+		void *_member;
+		ld::archive::File *_file;
+		Operation(void *member, ld::archive::File *file) : _member(member), _file(file) {}
+	};
+	std::vector<Operation> ops;
+	LDSet<void*> membersSeen;
+	for (const char* name : names) {
+		const auto pos = _libraryIndex.find(name);
+		if ( pos == _libraryIndex.end() )
+			continue;
+		const uint32_t libIndex = pos->second.front();
+		if ( !_unindexedLibraries.empty() && (_unindexedLibraries.front() < libIndex) )
+			continue;
+		const LibraryInfo& lib = _searchLibraries[libIndex];
+		if ( lib.isDylib() )
+			continue;
+		ld::archive::File* archiveFile = lib.archive();
+		void* member = archiveFile->memberForName(name);
+		if ( (member != NULL) && membersSeen.insert(member).second )
+			ops.emplace_back(member, archiveFile);
+	}
+	if ( ops.size() < 2 )
+		return;
+	const tbb::blocked_range<size_t> range(0, ops.size());
+	tbb::parallel_for(range, [&](const tbb::blocked_range<size_t>& subrange) {
+		for (auto i = subrange.begin(); i != subrange.end(); i++) {
+			try {
+				ops[i]._file->parseMember(ops[i]._member);
+			}
+			catch (const char*) {
+				// error is reported when the member is actually loaded
+			}
+		}
+	});
+}
+
+void InputFiles::saveLinkState()
+{
+	for (const LibraryInfo& lib : _searchLibraries) {
+		if ( lib.isDylib() )
+			continue;
+		const char* archivePath = lib.archive()->path();
+		lib.archive()->forEachMemberLoaded(^(const char* memberName) {
+			_linkStateCache.addArchiveMember(archivePath, memberName);
+		});
+	}
+	_linkStateCache.save();
+}
+
+void InputFiles::indexSearchLibraries() const
+{
+	// Libraries are only ever appended to _searchLibraries, so appending each new library's position
+	// keeps every name's candidate list in search order.  The index is only a filter: candidates are
+	// still probed with justInTimeforEachAtom(), so weak-def and data-only semantics are unchanged.
+	for (uint32_t libIndex = _indexedLibraryCount; libIndex < _searchLibraries.size(); ++libIndex) {
+		const LibraryInfo& lib = _searchLibraries[libIndex];
+		void (^addName)(const char*) = ^(const char* symbolName) {
+			LibraryPositions& positions = _libraryIndex[symbolName];
+			if ( positions.empty() || (positions.back() != libIndex) )
+				positions.push_back(libIndex);
+		};
+		if ( lib.isDylib() ) {
+			ld::dylib::File* dylibFile = lib.dylib();
+			if ( dylibFile->exportsAreIndexable() ) {
+				dylibFile->forEachExportedSymbol(^(const char* symbolName, bool weakDef) {
+					addName(symbolName);
+				});
+			}
+			else {
+				// symbols may come from re-exported dylibs or be looked up lazily, so always search it
+				_unindexedLibraries.push_back(libIndex);
+			}
+		}
+		else {
+			lib.archive()->forEachTableOfContentsName(addName);
 		}
 	}
+	_indexedLibraryCount = (uint32_t)_searchLibraries.size();
 }
 
 bool InputFiles::searchLibraries(const char* name, bool searchDylibs, bool searchArchives, bool dataSymbolOnly, ld::File::AtomHandler& handler) const
 {
-	// Check each input library.
-    for (std::vector<LibraryInfo>::const_iterator it=_searchLibraries.begin(); it != _searchLibraries.end(); ++it) {
-        LibraryInfo lib = *it;
-        if (lib.isDylib()) {
-            if (searchDylibs) {
-                ld::dylib::File *dylibFile = lib.dylib();
-                //fprintf(stderr, "searchLibraries(%s), looking in linked %s\n", name, dylibFile->path() );
-                if ( dylibFile->justInTimeforEachAtom(name, handler) ) {
-                    // we found a definition in this dylib
-                    // done, unless it is a weak definition in which case we keep searching
-                    _options.snapshot().recordDylibSymbol(dylibFile, name);
-                    if ( !dylibFile->hasWeakExternals() || !dylibFile->hasWeakDefinition(name)) {
-                        return true;
-                    }
-                    // else continue search for a non-weak definition
-                }
-            }
-        } else {
-            if (searchArchives) {
-                ld::archive::File *archiveFile = lib.archive();
-                if ( dataSymbolOnly ) {
-                    if ( archiveFile->justInTimeDataOnlyforEachAtom(name, handler) ) {
-                        if ( _options.traceArchives() || _options.traceEmitJSON())
-                            logArchive(archiveFile);
-                        _options.snapshot().recordArchive(archiveFile->path());
-						// DALLAS _state.archives.push_back(archiveFile);
-                        // found data definition in static library, done
-                       return true;
-                    }
-                }
-                else {
-                    if ( archiveFile->justInTimeforEachAtom(name, handler) ) {
-                        if ( _options.traceArchives() || _options.traceEmitJSON())
-                            logArchive(archiveFile);
-                        _options.snapshot().recordArchive(archiveFile->path());
-                        // found definition in static library, done
-                        return true;
-                    }
-                }
-            }
-        }
-    }
+	// Check each input library that may define name.  Loading a member can append libraries
+	// (auto-linking), so keep going until every library known at the end has been considered.
+	static const LibraryPositions sNoPositions;
+	uint32_t searchedCount = 0;
+	while ( searchedCount < _searchLibraries.size() ) {
+		const uint32_t searchLimit = (uint32_t)_searchLibraries.size();
+		indexSearchLibraries();
+		const auto pos = _libraryIndex.find(name);
+		const LibraryPositions& indexed = (pos != _libraryIndex.end()) ? pos->second : sNoPositions;
+		// merge indexed candidates with always-searched libraries, both are sorted by position
+		auto iit = std::lower_bound(indexed.begin(), indexed.end(), searchedCount);
+		auto uit = std::lower_bound(_unindexedLibraries.begin(), _unindexedLibraries.end(), searchedCount);
+		const auto iend = std::lower_bound(iit, indexed.end(), searchLimit);
+		const auto uend = std::lower_bound(uit, _unindexedLibraries.end(), searchLimit);
+		searchedCount = searchLimit;
+		while ( (iit != iend) || (uit != uend) ) {
+			uint32_t libIndex;
+			if ( (uit == uend) || ((iit != iend) && (*iit < *uit)) )
+				libIndex = *iit++;
+			else
+				libIndex = *uit++;
+			LibraryInfo lib = _searchLibraries[libIndex];
+			if (lib.isDylib()) {
+				if (searchDylibs) {
+					ld::dylib::File *dylibFile = lib.dylib();
+					ld::InputCosts::addProbe(dylibFile);
+					//fprintf(stderr, "searchLibraries(%s), looking in linked %s\n", name, dylibFile->path() );
+					if ( dylibFile->justInTimeforEachAtom(name, handler) ) {
+						// we found a definition in this dylib
+						// done, unless it is a weak definition in which case we keep searching
+						_options.snapshot().recordDylibSymbol(dylibFile, name);
+						if ( !dylibFile->hasWeakExternals() || !dylibFile->hasWeakDefinition(name)) {
+							return true;
+						}
+						// else continue search for a non-weak definition
+					}
+				}
+			} else {
+				if (searchArchives) {
+					ld::archive::File *archiveFile = lib.archive();
+					ld::InputCosts::addProbe(archiveFile);
+					if ( dataSymbolOnly ) {
+						if ( archiveFile->justInTimeDataOnlyforEachAtom(name, handler) ) {
+							if ( _options.traceArchives() || _options.traceEmitJSON())
+								logArchive(archiveFile);
+							_options.snapshot().recordArchive(archiveFile->path());
+							// found data definition in static library, done
+							return true;
+						}
+					}
+					else {
+						if ( archiveFile->justInTimeforEachAtom(name, handler) ) {
+							if ( _options.traceArchives() || _options.traceEmitJSON())
+								logArchive(archiveFile);
+							_options.snapshot().recordArchive(archiveFile->path());
+							// found definition in static library, done
+							return true;
+						}
+					}
+				}
+			}
+		}
+	}
 
 	// search indirect dylibs
 	if ( searchDylibs ) {
@@ -1514,6 +1622,7 @@ bool InputFiles::searchLibraries(const char* name, bool searchDylibs, bool searc
 			}
 			if ( searchThisDylib ) {
 				//fprintf(stderr, "searchLibraries(%s), looking in implicitly linked %s\n", name, dylibFile->path() );
+				ld::InputCosts::addProbe(dylibFile);
 				if ( dylibFile->justInTimeforEachAtom(name, handler) ) {
 					// we found a definition in this dylib
 					// done, unless it is a weak definition in which case we keep searching
@@ -48,8 +48,11 @@
 
 #include <vector>
 
+#include <tbb/task_group.h>
+
 #include "Options.h"
 #include "ld.hpp"
+#include "LinkStateCache.h"
 
 namespace ld {
 namespace tool {
@@ -65,10 +68,15 @@ public:
 	// iterates all atoms in initial files
 	void						forEachInitialAtom(ld::File::AtomHandler&, ld::Internal& state);
 	void preParseLibraries() const;
+	// parses in parallel the archive members that searching for names is expected to load
+	void						preParseArchiveMembers(const std::vector<const char*>& names) const;
+	// records what this link loaded for the next link of the same output
+	void						saveLinkState();
 	// searches libraries for name
-	void dumpMembersParsed(std::ofstream &stream) const;
 	bool						searchLibraries(const char* name, bool searchDylibs, bool searchArchives,  
 																  bool dataSymbolOnly, ld::File::AtomHandler&) const;
+	// changes whenever a library or dylib is added, so a name searchLibraries() could not find may now be found
+	size_t						searchLibrariesGeneration() const { return _searchLibraries.size() + _allDylibs.size(); }
 	// see if any linked dylibs export a weak def of symbol
 	bool						searchWeakDefInDylib(const char* name) const;
 	// copy dylibs to link with in command line order
@@ -100,6 +108,7 @@ private:
 	void						checkDylibClientRestrictions(ld::dylib::File*);
 	void						createOpaqueFileSections();
 	bool						libraryAlreadyLoaded(const char* path);
+	void						indexSearchLibraries() const;
 	bool						frameworkAlreadyLoaded(const char* path, const char* frameworkName);
 
 	// for pipelined linking
@@ -107,8 +116,9 @@ private:
 	static void					waitForInputFiles(InputFiles *inputFiles);
 
 	// for threaded input file processing
-	void						parseWorkerThread();
-	static void					parseWorkerThread(InputFiles *inputFiles);
+	void						parseInputFile(int slot);
+	void						parseInputFiles();
+	void						startParseTasks();
 	void						startThread(void (*threadFunc)(InputFiles *)) const;
 
 	typedef LDOrderedMap<std::string, ld::dylib::File*>	InstallNameToDylib;
@@ -127,10 +137,10 @@ private:
 	// for threaded input file processing
 #if HAVE_PTHREADS
 	pthread_mutex_t				_parseLock;
-	pthread_cond_t				_parseWorkReady;		// used by parse threads to block for work
-	pthread_cond_t				_newFileAvailable;		// used by main thread to block for parsed input files
-	int							_availableWorkers;		// number of remaining unstarted parse threads
-	int							_idleWorkers;			// number of running parse threads that are idle
+	pthread_cond_t				_newFileAvailable;		// used by main thread to block for parsed or pipelined input files
+	tbb::task_group				_parseTasks;			// parse input files on the shared scheduler
+	int							_parseTaskCount;		// number of parse tasks started and not yet finished
+	int							_maxParseTasks;			// number of threads the scheduler may use
 	int							_neededFileSlot;		// input file the resolver is currently blocked waiting for
 	int							_parseCursor;			// slot to begin searching for a file to parse
 	int							_availableInputFiles;	// number of input fileinfos with readyToParse==true
@@ -140,6 +150,7 @@ private:
 	
 	ld::File::Ordinal			_indirectDylibOrdinal;
 	ld::File::Ordinal			_linkerOptionOrdinal;
+	LinkStateCache				_linkStateCache;
     
     class LibraryInfo {
         ld::File* _lib;
@@ -153,6 +164,13 @@ private:
         ld::archive::File *archive() const { return (ld::archive::File*)_lib; }
     };
     std::vector<LibraryInfo>  _searchLibraries;
+
+	// merged symbol name -> positions in _searchLibraries that may define it, in search order
+	typedef std::vector<uint32_t> LibraryPositions;
+	typedef LDMap<const char*, LibraryPositions, CStringHash, CStringEquals> NameToLibraries;
+	mutable NameToLibraries		_libraryIndex;
+	mutable LibraryPositions	_unindexedLibraries;	// libraries that must be probed for every name
+	mutable uint32_t			_indexedLibraryCount;
 };
 
 } // namespace tool 
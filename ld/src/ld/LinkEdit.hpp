@@ -33,14 +33,20 @@
 #include <CommonCrypto/CommonDigest.h>
 // #include <CommonCrypto/CommonDigestSPI.h>
 
+#include <atomic>
 #include <vector>
 #include <unordered_map>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
 #include "Options.h"
 #include "ld.hpp"
 #include "Architectures.hpp"
 #include "MachOFileAbstraction.hpp"
 #include "libcodedirectory.h"
+#include "ExportTrie.h"
+#include "ByteStream.h"
 
 #ifndef CS_LINKER_SIGNED
 	#define CS_LINKER_SIGNED            0x00020000  /* Automatically signed by the linker */
@@ -49,94 +55,6 @@
 namespace ld {
 namespace tool {
 
-class ByteStream {
-private:
-	std::vector<uint8_t>		_data;
-public:
-	std::vector<uint8_t>& bytes() { return _data; }
-	unsigned long size() const { return _data.size(); }
-	void reserve(unsigned long l) { _data.reserve(l); }
-	const uint8_t* start() const { return &_data[0]; }
-
-	void append_uleb128(uint64_t value) {
-		uint8_t byte;
-		do {
-			byte = value & 0x7F;
-			value &= ~0x7F;
-			if ( value != 0 )
-				byte |= 0x80;
-			_data.push_back(byte);
-			value = value >> 7;
-		} while( byte >= 0x80 );
-	}
-	
-	void append_sleb128(int64_t value) {
-		bool isNeg = ( value < 0 );
-		uint8_t byte;
-		bool more;
-		do {
-			byte = value & 0x7F;
-			value = value >> 7;
-			if ( isNeg ) 
-				more = ( (value != -1) || ((byte & 0x40) == 0) );
-			else
-				more = ( (value != 0) || ((byte & 0x40) != 0) );
-			if ( more )
-				byte |= 0x80;
-			_data.push_back(byte);
-		} 
-		while( more );
-	}
-	
-	void append_delta_encoded_uleb128_run(uint64_t start, const std::vector<uint64_t>& locations) {
-		uint64_t lastAddr = start;
-		for(std::vector<uint64_t>::const_iterator it = locations.begin(); it != locations.end(); ++it) {
-			uint64_t nextAddr = *it;
-			uint64_t delta = nextAddr - lastAddr;
-			assert(delta != 0);
-			append_uleb128(delta);
-			lastAddr = nextAddr;
-		}
-	}
-
-	void append_string(const char* str) {
-		for (const char* s = str; *s != '\0'; ++s)
-			_data.push_back(*s);
-		_data.push_back('\0');
-	}
-	
-	void append_byte(uint8_t byte) {
-		_data.push_back(byte);
-	}
-	
-	void append_mem(const void* mem, size_t len) {
-		_data.insert(_data.end(), (uint8_t*)mem, (uint8_t*)mem + len);
-	}
-
-	// adds 'len' bytes to buffer and returns pointer to start of block
-	uint8_t* alloc(size_t len) {
-		size_t start = _data.size();
-		for (size_t i=0; i < len; ++i)
-			_data.push_back(0);
-		return &_data[start];
-	}
-
-	static unsigned int	uleb128_size(uint64_t value) {
-		uint32_t result = 0;
-		do {
-			value = value >> 7;
-			++result;
-		} while ( value != 0 );
-		return result;
-	}
-	
-	void pad_to_size(unsigned int alignment) {
-		while ( (_data.size() % alignment) != 0 )
-			_data.push_back(0);
-	}
-};
-
-
 class LinkEditAtom : public ld::Atom
 {
 public:
@@ -1546,7 +1464,7 @@ void ExportInfoAtom<A>::encode() const
 	}
 
 	// create trie
-	mach_o::trie::makeTrie(entries, this->_encodedData.bytes());
+	ld::makeExportTrie(entries, this->_encodedData.bytes());
 
 	//Add additional data padding for the unoptimized shared cache
 	for (unsigned int i = 0; i < padding; ++i)
@@ -2228,10 +2146,15 @@ public:
 	virtual void								encode() const;
 
 			void								hash(uint8_t* wholeFileBuffer) const;
+			// page hashes computed while the rest of the file is written, hash() redoes invalidated ones
+			void								beginHashing(const uint8_t* wholeFileBuffer) const;
+			void								hashPages(uint64_t startFileOffset, uint64_t endFileOffset) const;
+			void								invalidatePages(uint64_t fileOffset, uint64_t size) const;
 
 private:
 	const Options& 				_opts;
 	mutable libcd*				_sigRef = nullptr;
+	mutable bool				_prehashing = false;
 
 	static ld::Section			_s_section;
 
@@ -2300,6 +2223,39 @@ void CodeSignatureAtom::encode() const
 	this->_encoded = true;
 }
 
+void CodeSignatureAtom::beginHashing(const uint8_t* wholeFileBuffer) const
+{
+	libcd_set_input_mem(_sigRef, wholeFileBuffer);
+	libcd_enable_prehashing(_sigRef);
+	_prehashing = true;
+}
+
+// hashes the pages lying entirely within [startFileOffset, endFileOffset), the last page of the
+// signed content ends at the code signature, so it is complete once the range reaches there
+void CodeSignatureAtom::hashPages(uint64_t startFileOffset, uint64_t endFileOffset) const
+{
+	const uint64_t pageSize = 4096;
+	const uint64_t imageSize = _state.sections.back()->fileOffset;
+	if ( endFileOffset >= imageSize )
+		endFileOffset = imageSize + pageSize - 1;
+	const uint64_t firstPage = (startFileOffset + pageSize - 1) / pageSize;
+	const uint64_t endPage = endFileOffset / pageSize;
+	if ( endPage > firstPage ) {
+		if ( libcd_prehash_pages(_sigRef, firstPage, endPage - firstPage) != LIBCD_SERIALIZE_SUCCESS )
+			throw "error code signing";
+	}
+}
+
+void CodeSignatureAtom::invalidatePages(uint64_t fileOffset, uint64_t size) const
+{
+	const uint64_t pageSize = 4096;
+	if ( size == 0 )
+		return;
+	const uint64_t firstPage = fileOffset / pageSize;
+	const uint64_t endPage = (fileOffset + size + pageSize - 1) / pageSize;
+	libcd_invalidate_prehashed_pages(_sigRef, firstPage, endPage - firstPage);
+}
+
 void CodeSignatureAtom::hash(uint8_t* wholeFileBuffer) const
 {
 	Internal::FinalSection* codeSignSect = _state.sections.back();
@@ -2308,6 +2264,21 @@ void CodeSignatureAtom::hash(uint8_t* wholeFileBuffer) const
 
 	libcd_set_input_mem(_sigRef, wholeFileBuffer);
 	libcd_set_output_mem(_sigRef, codeSignBuffer, codeSignSect->size);
+
+	if ( _prehashing ) {
+		// hash the pages writing left over on tbb, so -threads caps this like the rest of the link,
+		// then serializing only copies hashes and must not start its own dispatch_apply
+		const uint64_t pageSize = 4096;
+		const size_t pageCount = (codeSignSect->fileOffset + pageSize - 1) / pageSize;
+		std::atomic<bool> failed(false);
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, pageCount, 16), [&](const tbb::blocked_range<size_t>& range) {
+			if ( libcd_prehash_missing_pages(_sigRef, range.begin(), range.size()) != LIBCD_SERIALIZE_SUCCESS )
+				failed = true;
+		});
+		if ( failed )
+			throw "error code signing";
+		libcd_set_disable_parallelization(_sigRef, true);
+	}
 	if ( libcd_serialize(_sigRef) != 0 )
 		throw "error code signing";
 }
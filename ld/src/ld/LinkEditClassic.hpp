@@ -31,13 +31,23 @@
 #include <limits.h>
 #include <unistd.h>
 
+#include <functional>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
+
+#include "pstl/execution"
+#include "pstl/algorithm"
+
 #include "Options.h"
 #include "ld.hpp"
 #include "Architectures.hpp"
 #include "MachOFileAbstraction.hpp"
+#include "StringPool.h"
 
 namespace ld {
 namespace tool {
@@ -71,7 +81,7 @@ protected:
 
 
 
-class StringPoolAtom : public ClassicLinkEditAtom
+class StringPoolAtom : public ClassicLinkEditAtom, public StringPool
 {
 public:
 												StringPoolAtom(const Options& opts, ld::Internal& state, 
@@ -84,22 +94,8 @@ public:
 	// overrides of ClassicLinkEditAtom
 	virtual void								encode() { }
 
-	int32_t										add(const char* name);
-	int32_t										addUnique(const char* name);
-    int32_t getOffset();
-	int32_t										emptyString()			{ return 1; }
-	const char*									stringForIndex(int32_t) const;
-	uint32_t									currentOffset();
-
 private:
-	enum { kBufferSize = 0x01000000 };
-	typedef LDMap<std::string, int32_t> StringToOffset;
-
 	const uint32_t							_pointerSize;
-	std::vector<char*>						_fullBuffers;
-	char*									_currentBuffer;
-	uint32_t								_currentBufferUsed;
-	StringToOffset							_uniqueStrings;
 
 	static ld::Section			_s_section;
 };
@@ -109,94 +105,40 @@ ld::Section StringPoolAtom::_s_section("__LINKEDIT", "__string_pool", ld::Sectio
 
 StringPoolAtom::StringPoolAtom(const Options& opts, ld::Internal& state, OutputFile& writer, int pointerSize)
 	: ClassicLinkEditAtom(opts, state, writer, _s_section, pointerSize), 
-	 _pointerSize(pointerSize), _currentBuffer(NULL), _currentBufferUsed(0)
+	 _pointerSize(pointerSize)
 {
-	_currentBuffer = new char[kBufferSize];
-	// burn first byte of string pool (so zero is never a valid string offset)
-	_currentBuffer[_currentBufferUsed++] = ' ';
-	// make offset 1 always point to an empty string
-	_currentBuffer[_currentBufferUsed++] = '\0';
 }
 
 uint64_t StringPoolAtom::size() const
 {
 	// pointer size align size
-	return (kBufferSize * _fullBuffers.size() + _currentBufferUsed + _pointerSize-1) & (-_pointerSize);
+	return (this->currentOffset() + _pointerSize-1) & (-_pointerSize);
 }
 
 void StringPoolAtom::copyRawContent(uint8_t buffer[]) const
 {
-	uint64_t offset = 0;
-	for (unsigned int i=0; i < _fullBuffers.size(); ++i) {
-		memcpy(&buffer[offset], _fullBuffers[i], kBufferSize);
-		offset += kBufferSize;
-	}
-	memcpy(&buffer[offset], _currentBuffer, _currentBufferUsed);
+	this->copyTo(buffer);
 	// zero fill end to align
-	offset += _currentBufferUsed;
+	uint64_t offset = this->currentOffset();
 	while ( (offset % _pointerSize) != 0 )
 		buffer[offset++] = 0;
 }
 
-int32_t StringPoolAtom::getOffset() {
-	return kBufferSize * _fullBuffers.size() + _currentBufferUsed;
-}
-
-int32_t StringPoolAtom::add(const char* str)
-{
-	int32_t offset = getOffset();
-	int lenNeeded = strlcpy(&_currentBuffer[_currentBufferUsed], str, kBufferSize-_currentBufferUsed)+1;
-	if ( (_currentBufferUsed+lenNeeded) < kBufferSize ) {
-		_currentBufferUsed += lenNeeded;
-	}
-	else {
-		int copied = kBufferSize-_currentBufferUsed-1;
-		// change trailing '\0' that strlcpy added to real char
-		_currentBuffer[kBufferSize-1] = str[copied];
-		// alloc next buffer
-		_fullBuffers.push_back(_currentBuffer);
-		_currentBuffer = new char[kBufferSize];
-		_currentBufferUsed = 0;
-		// append rest of string
-		this->add(&str[copied+1]);
-	}
-	return offset;
-}
-
-uint32_t StringPoolAtom::currentOffset()
-{
-	return kBufferSize * _fullBuffers.size() + _currentBufferUsed;
-}
 
-
-int32_t StringPoolAtom::addUnique(const char* str)
+//
+// StringRecorder stands in for the string pool while symbols are made on several threads.  Each
+// string is numbered in the order it was recorded, and is added to the pool once all are known.
+//
+class StringRecorder
 {
-	StringToOffset::iterator pos = _uniqueStrings.find(str);
-	if ( pos != _uniqueStrings.end() ) {
-		return pos->second;
-	}
-	else {
-		int32_t offset = this->add(str);
-		_uniqueStrings[str] = offset;
-		return offset;
-	}
-}
-
+public:
+	int32_t										add(std::string_view str)		{ _strings.push_back(str); return _strings.size()-1; }
+	int32_t										addUnique(std::string_view str)	{ return this->add(str); }
+	const std::vector<std::string_view>&		strings() const					{ return _strings; }
 
-const char* StringPoolAtom::stringForIndex(int32_t index) const
-{
-	int32_t currentBufferStartIndex = kBufferSize * _fullBuffers.size();
-	int32_t maxIndex = currentBufferStartIndex + _currentBufferUsed;
-	// check for out of bounds
-	if ( index > maxIndex )
-		return "";
-	// check for index in _currentBuffer
-	if ( index > currentBufferStartIndex )
-		return &_currentBuffer[index-currentBufferStartIndex];
-	// otherwise index is in a full buffer
-	uint32_t fullBufferIndex = index/kBufferSize;
-	return &_fullBuffers[fullBufferIndex][index-(kBufferSize*fullBufferIndex)];
-}
+private:
+	std::vector<std::string_view>				_strings;
+};
 
 
 
@@ -222,9 +164,18 @@ private:
 	typedef typename A::P::E					E;
 	typedef typename A::P::uint_t				pint_t;
 
-	bool							addLocal(const ld::Atom* atom, StringPoolAtom* pool);
-	void							addGlobal(const ld::Atom* atom, StringPoolAtom* pool);
-	void							addImport(const ld::Atom* atom, StringPoolAtom* pool);
+	template <typename Pool>
+	bool							addLocal(const ld::Atom* atom, Pool& pool, macho_nlist<P>& entry);
+	template <typename Pool>
+	void							addGlobal(const ld::Atom* atom, Pool& pool, macho_nlist<P>& entry);
+	template <typename Pool>
+	void							addImport(const ld::Atom* atom, Pool& pool, macho_nlist<P>& entry);
+	void							addSymbolsInOrder();
+	void							addSymbolsInParallel();
+	void							makeSymbolsInParallel(const std::vector<const ld::Atom*>& atoms, std::vector<macho_nlist<P> >& entries,
+														  const std::function<void(const ld::Atom*, StringRecorder&, macho_nlist<P>&)>& makeEntry,
+														  std::vector<std::string_view>& strings);
+	void							setStringOffsets(std::vector<macho_nlist<P> >& entries, const int32_t offsets[]);
 	uint8_t							classicOrdinalForProxy(const ld::Atom* atom);
 	uint32_t						stringOffsetForStab(const ld::relocatable::File::Stab& stab, StringPoolAtom* pool);
 	uint64_t						valueForStab(const ld::relocatable::File::Stab& stab);
@@ -284,14 +235,13 @@ bool SymbolTableAtom<A>::isAltEntry(const ld::Atom* atom)
 }
 
 template <typename A>
-bool SymbolTableAtom<A>::addLocal(const ld::Atom* atom, StringPoolAtom* pool) 
+template <typename Pool>
+bool SymbolTableAtom<A>::addLocal(const ld::Atom* atom, Pool& pool, macho_nlist<P>& entry) 
 {
-	macho_nlist<P> entry;
 	assert(atom->symbolTableInclusion() != ld::Atom::symbolTableNotIn);
 	 
 	// set n_strx
-	std::string nameStr = std::string(atom->getUserVisibleName());
-	const char* symbolName = nameStr.c_str();
+	std::string_view symbolName = atom->getUserVisibleName();
 	char anonName[32];
 	if ( this->_options.outputKind() == Options::kObjectFile ) {
 		if ( atom->contentType() == ld::Atom::typeCString ) {
@@ -319,7 +269,7 @@ bool SymbolTableAtom<A>::addLocal(const ld::Atom* atom, StringPoolAtom* pool)
 	}
 
 	// <rdar://problem/43388350> ER: Coalesce the string pools for the symbol table when linking objects together
-	entry.set_n_strx(pool->addUnique(symbolName));
+	entry.set_n_strx(pool.addUnique(symbolName));
 
 	// set n_type
 	uint8_t type = N_SECT;
@@ -361,17 +311,14 @@ bool SymbolTableAtom<A>::addLocal(const ld::Atom* atom, StringPoolAtom* pool)
 	else
 		entry.set_n_value(atom->finalAddress());
 	
-	// add to array
-	_locals.push_back(entry);
 	return true;
 }
 
 
 template <typename A>
-void SymbolTableAtom<A>::addGlobal(const ld::Atom* atom, StringPoolAtom* pool) 
+template <typename Pool>
+void SymbolTableAtom<A>::addGlobal(const ld::Atom* atom, Pool& pool, macho_nlist<P>& entry) 
 {
-	macho_nlist<P> entry;
-
 	// set n_strx
 	const char* symbolName = atom->name();
 	char anonName[32];
@@ -382,7 +329,7 @@ void SymbolTableAtom<A>::addGlobal(const ld::Atom* atom, StringPoolAtom* pool)
 			symbolName = anonName;
 		}
 	}
-	entry.set_n_strx(pool->add(symbolName));
+	entry.set_n_strx(pool.add(symbolName));
 
 	// set n_type
 	if ( atom->definition() == ld::Atom::definitionAbsolute ) {
@@ -449,7 +396,7 @@ void SymbolTableAtom<A>::addGlobal(const ld::Atom* atom, StringPoolAtom* pool)
 			for (ld::Fixup::iterator fit = atom->fixupsBegin(); fit != atom->fixupsEnd(); ++fit) {
 				if ( fit->kind == ld::Fixup::kindNoneFollowOn ) {
 					assert(fit->binding == ld::Fixup::bindingDirectlyBound);
-					entry.set_n_value(pool->add(fit->u.target->name()));
+					entry.set_n_value(pool.add(fit->u.target->name()));
 				}
 			}
 		}
@@ -458,9 +405,6 @@ void SymbolTableAtom<A>::addGlobal(const ld::Atom* atom, StringPoolAtom* pool)
 	}
 	else
 		entry.set_n_value(atom->finalAddress());
-		
-	// add to array
-	_globals.push_back(entry);
 }
 
 template <typename A>
@@ -487,12 +431,11 @@ uint8_t	SymbolTableAtom<A>::classicOrdinalForProxy(const ld::Atom* atom)
 
 
 template <typename A>
-void SymbolTableAtom<A>::addImport(const ld::Atom* atom, StringPoolAtom* pool) 
+template <typename Pool>
+void SymbolTableAtom<A>::addImport(const ld::Atom* atom, Pool& pool, macho_nlist<P>& entry) 
 {
-	macho_nlist<P> entry;
-
 	// set n_strx
-	entry.set_n_strx(pool->add(atom->name()));
+	entry.set_n_strx(pool.add(atom->name()));
 
 	// set n_type
 	if ( this->_options.outputKind() == Options::kObjectFile ) {
@@ -556,19 +499,16 @@ void SymbolTableAtom<A>::addImport(const ld::Atom* atom, StringPoolAtom* pool)
 			assert(fit->kind == ld::Fixup::kindNoneFollowOn);
 			switch ( fit->binding ) {
 				case ld::Fixup::bindingByNameUnbound:
-					entry.set_n_value(pool->add(fit->u.name));
+					entry.set_n_value(pool.add(fit->u.name));
 					break;
 				case ld::Fixup::bindingsIndirectlyBound:
-					entry.set_n_value(pool->add((_state.indirectBindingTable[fit->u.bindingIndex])->name()));
+					entry.set_n_value(pool.add((_state.indirectBindingTable[fit->u.bindingIndex])->name()));
 					break;
 				default:
 					assert(0 && "internal error: unexpected alias binding");
 			}
 		}
 	}
-	
-	// add to array
-	_imports.push_back(entry);
 }
 
 template <typename A>
@@ -682,11 +622,9 @@ bool SymbolTableAtom<A>::hasStabs(uint32_t& ssos, uint32_t& ssoe, uint32_t& sos,
 
 
 template <typename A>
-void SymbolTableAtom<A>::encode()
+void SymbolTableAtom<A>::addSymbolsInOrder()
 {
-	// Note: We lay out the symbol table so that the strings for the stabs (local) symbols are at the
-	// end of the string pool.  The stabs strings are not used when calculated the UUID for the image.
-	// If the stabs strings were not last, the string offsets for all other symbols may very which would alter the UUID.
+	StringPoolAtom& pool = *this->_writer._stringPoolAtom;
 
 	// reserve space for local symbols
 	uint32_t localsCount = _state.stabs.size() + this->_writer._localAtoms.size();
@@ -698,7 +636,9 @@ void SymbolTableAtom<A>::encode()
 	this->_writer._globalSymbolsStartIndex = localsCount;
 	for (std::vector<const ld::Atom*>::const_iterator it=globalAtoms.begin(); it != globalAtoms.end(); ++it) {
 		const ld::Atom* atom = *it;
-		this->addGlobal(atom, this->_writer._stringPoolAtom);
+		macho_nlist<P> entry;
+		this->addGlobal(atom, pool, entry);
+		_globals.push_back(entry);
 		this->_writer._atomToSymbolIndex[atom] = symbolIndex++;
 	}
 	this->_writer._globalSymbolsCount = symbolIndex - this->_writer._globalSymbolsStartIndex;
@@ -708,7 +648,9 @@ void SymbolTableAtom<A>::encode()
 	_imports.reserve(importAtoms.size());
 	this->_writer._importSymbolsStartIndex = symbolIndex;
 	for (std::vector<const ld::Atom*>::const_iterator it=importAtoms.begin(); it != importAtoms.end(); ++it) {
-		this->addImport(*it, this->_writer._stringPoolAtom);
+		macho_nlist<P> entry;
+		this->addImport(*it, pool, entry);
+		_imports.push_back(entry);
 		this->_writer._atomToSymbolIndex[*it] = symbolIndex++;
 	}
 	this->_writer._importSymbolsCount = symbolIndex - this->_writer._importSymbolsStartIndex;
@@ -716,12 +658,144 @@ void SymbolTableAtom<A>::encode()
 	// go back to start and make nlist entries for all local symbols
 	std::vector<const ld::Atom*>& localAtoms = this->_writer._localAtoms;
 	this->_writer._localSymbolsStartIndex = 0;
-	symbolIndex = 0;
 	_locals.reserve(localsCount);
 	for (const ld::Atom* atom : localAtoms) {
-		if ( this->addLocal(atom, this->_writer._stringPoolAtom) )
-			this->_writer._atomToSymbolIndex[atom] = symbolIndex++;
+		macho_nlist<P> entry;
+		if ( this->addLocal(atom, pool, entry) ) {
+			_locals.push_back(entry);
+			this->_writer._atomToSymbolIndex[atom] = _locals.size() - 1;
+		}
 	}
+}
+
+// makes the entries in chunks, each recording the strings it needs in order, and appends all those
+// strings to strings, leaving each entry's n_strx (and an indirect symbol's n_value) as the index
+// of its string there
+template <typename A>
+void SymbolTableAtom<A>::makeSymbolsInParallel(const std::vector<const ld::Atom*>& atoms, std::vector<macho_nlist<P> >& entries,
+											   const std::function<void(const ld::Atom*, StringRecorder&, macho_nlist<P>&)>& makeEntry,
+											   std::vector<std::string_view>& strings)
+{
+	const size_t atomsPerChunk = 4096;
+	const size_t chunkCount = (atoms.size() + atomsPerChunk - 1) / atomsPerChunk;
+	std::vector<StringRecorder> recorders(chunkCount);
+	entries.resize(atoms.size());
+	tbb::parallel_for((size_t)0, chunkCount, [&](size_t chunk) {
+		for (size_t i = chunk*atomsPerChunk, end = std::min(atoms.size(), (chunk+1)*atomsPerChunk); i != end; ++i)
+			makeEntry(atoms[i], recorders[chunk], entries[i]);
+	});
+
+	std::vector<size_t> chunkFirstStrings(chunkCount);
+	for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+		chunkFirstStrings[chunk] = strings.size();
+		strings.insert(strings.end(), recorders[chunk].strings().begin(), recorders[chunk].strings().end());
+	}
+	tbb::parallel_for((size_t)0, chunkCount, [&](size_t chunk) {
+		const size_t firstString = chunkFirstStrings[chunk];
+		for (size_t i = chunk*atomsPerChunk, end = std::min(atoms.size(), (chunk+1)*atomsPerChunk); i != end; ++i) {
+			macho_nlist<P>& entry = entries[i];
+			entry.set_n_strx(firstString + entry.n_strx());
+			// indirect symbols have the name of the symbol they stand for as their value
+			if ( (entry.n_type() & N_TYPE) == N_INDR )
+				entry.set_n_value(firstString + entry.n_value());
+		}
+	});
+}
+
+// swaps the string indexes left by makeSymbolsInParallel() for the strings' offsets in the pool
+template <typename A>
+void SymbolTableAtom<A>::setStringOffsets(std::vector<macho_nlist<P> >& entries, const int32_t offsets[])
+{
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, entries.size(), 4096), [&](const tbb::blocked_range<size_t>& range) {
+		for (size_t i = range.begin(); i != range.end(); ++i) {
+			macho_nlist<P>& entry = entries[i];
+			entry.set_n_strx(offsets[entry.n_strx()]);
+			if ( (entry.n_type() & N_TYPE) == N_INDR )
+				entry.set_n_value(offsets[entry.n_value()]);
+		}
+	});
+}
+
+template <typename A>
+void SymbolTableAtom<A>::addSymbolsInParallel()
+{
+	// only object files skip or number local symbols as they go, so every atom gets an nlist and
+	// the symbol indexes are known up front
+	std::vector<const ld::Atom*>& globalAtoms = this->_writer._exportedAtoms;
+	std::vector<const ld::Atom*>& importAtoms = this->_writer._importedAtoms;
+	std::vector<const ld::Atom*>& localAtoms = this->_writer._localAtoms;
+	uint32_t localsCount = _state.stabs.size() + localAtoms.size();
+	this->_writer._localSymbolsStartIndex = 0;
+	this->_writer._globalSymbolsStartIndex = localsCount;
+	this->_writer._globalSymbolsCount = globalAtoms.size();
+	this->_writer._importSymbolsStartIndex = localsCount + globalAtoms.size();
+	this->_writer._importSymbolsCount = importAtoms.size();
+
+	tbb::parallel_invoke([&] {
+		LDOrderedMap<const ld::Atom*, uint32_t>& atomToSymbolIndex = this->_writer._atomToSymbolIndex;
+		uint32_t symbolIndex = localsCount;
+		for (const ld::Atom* atom : globalAtoms)
+			atomToSymbolIndex[atom] = symbolIndex++;
+		for (const ld::Atom* atom : importAtoms)
+			atomToSymbolIndex[atom] = symbolIndex++;
+		symbolIndex = 0;
+		for (const ld::Atom* atom : localAtoms)
+			atomToSymbolIndex[atom] = symbolIndex++;
+	}, [&] {
+		StringPoolAtom& pool = *this->_writer._stringPoolAtom;
+		std::vector<std::string_view> globalStrings;
+		std::vector<std::string_view> importStrings;
+		std::vector<std::string_view> localStrings;
+		this->makeSymbolsInParallel(globalAtoms, _globals, [&](const ld::Atom* atom, StringRecorder& strings, macho_nlist<P>& entry) {
+			this->addGlobal(atom, strings, entry);
+		}, globalStrings);
+		this->makeSymbolsInParallel(importAtoms, _imports, [&](const ld::Atom* atom, StringRecorder& strings, macho_nlist<P>& entry) {
+			this->addImport(atom, strings, entry);
+		}, importStrings);
+		this->makeSymbolsInParallel(localAtoms, _locals, [&](const ld::Atom* atom, StringRecorder& strings, macho_nlist<P>& entry) {
+			this->addLocal(atom, strings, entry);
+		}, localStrings);
+		std::vector<int32_t> offsets;
+		if ( this->_options.tailMergeStrings() ) {
+			// merge the names of all symbols at once, then split the offsets back up
+			const size_t importBase = globalStrings.size();
+			const size_t localBase = importBase + importStrings.size();
+			std::vector<std::string_view> strings(std::move(globalStrings));
+			strings.insert(strings.end(), importStrings.begin(), importStrings.end());
+			strings.insert(strings.end(), localStrings.begin(), localStrings.end());
+			pool.addTailMerged(strings, offsets);
+			this->setStringOffsets(_globals, offsets.data());
+			this->setStringOffsets(_imports, offsets.data() + importBase);
+			this->setStringOffsets(_locals, offsets.data() + localBase);
+		}
+		else {
+			// the pool gets global, then import, then local symbol names, as when made one at a time
+			pool.addInParallel(globalStrings, false, offsets);
+			this->setStringOffsets(_globals, offsets.data());
+			pool.addInParallel(importStrings, false, offsets);
+			this->setStringOffsets(_imports, offsets.data());
+			pool.addInParallel(localStrings, true, offsets);
+			this->setStringOffsets(_locals, offsets.data());
+		}
+		_locals.reserve(localsCount);
+	});
+}
+
+template <typename A>
+void SymbolTableAtom<A>::encode()
+{
+	// Note: We lay out the symbol table so that the strings for the stabs (local) symbols are at the
+	// end of the string pool.  The stabs strings are not used when calculated the UUID for the image.
+	// If the stabs strings were not last, the string offsets for all other symbols may very which would alter the UUID.
+
+	// object files name some symbols with a running counter and may drop local symbols, so their
+	// symbols are made one at a time
+	if ( this->_options.outputKind() == Options::kObjectFile )
+		this->addSymbolsInOrder();
+	else
+		this->addSymbolsInParallel();
+
+	uint32_t symbolIndex = _locals.size();
 	_stabsIndexStart = symbolIndex;
 	_stabsStringsOffsetStart = this->_writer._stringPoolAtom->currentOffset();
 	for (const ld::relocatable::File::Stab& stab : _state.stabs) {
@@ -0,0 +1,413 @@
+//
+//  LinkStateCache.cpp
+//  ld
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "LinkStateCache.h"
+
+namespace ld {
+namespace tool {
+
+// bump whenever the layout of any cache structure changes
+static const uint32_t	kCacheVersion = 2;
+static const char		kCacheMagic[8] = { 'z', 'l', 'd', 'c', 'a', 'c', 'h', 'e' };
+static const uint32_t	kNoFile = 0xFFFFFFFF;
+
+
+LinkStateCache::LinkStateCache(const Options& opts)
+	: _options(opts), _mappedContent(NULL), _mappedSize(0), _header(NULL), _files(NULL),
+	  _memberOffsets(NULL), _resolutions(NULL), _probes(NULL), _strings(NULL), _resolutionsUsable(false)
+{
+}
+
+LinkStateCache::~LinkStateCache()
+{
+	if ( _mappedContent != NULL )
+		::munmap((void*)_mappedContent, _mappedSize);
+}
+
+std::string LinkStateCache::resolutionKey(const char* installName, const char* fromDylibPath)
+{
+	// only @executable_path, @loader_path and @rpath install names depend on the dylib referencing them
+	std::string key = installName;
+	if ( (installName[0] == '@') && (fromDylibPath != NULL) ) {
+		key.push_back('\0');
+		key.append(fromDylibPath);
+	}
+	return key;
+}
+
+uint64_t LinkStateCache::searchPathsHash() const
+{
+	// indirect dylib resolutions depend on which directories are searched.  What is in them is
+	// checked per resolution, against the directories its search actually probed.
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	auto addBytes = [&](const void* bytes, size_t length) {
+		for (size_t i=0; i < length; ++i) {
+			hash ^= ((const uint8_t*)bytes)[i];
+			hash *= 0x100000001b3ULL;
+		}
+	};
+	auto addDirectories = [&](const std::vector<const char*>& dirs) {
+		for (const char* dir : dirs)
+			addBytes(dir, strlen(dir)+1);
+		addBytes("", 1);
+	};
+	addDirectories(_options.sdkPaths());
+	addDirectories(_options.frameworkSearchPaths());
+	addDirectories(_options.librarySearchPaths());
+	return hash;
+}
+
+void LinkStateCache::load()
+{
+	std::string path = _options.cacheInputPath();
+	if ( path.empty() )
+		return;
+	int fd = ::open(path.c_str(), O_RDONLY, 0);
+	if ( fd == -1 )
+		return;
+	struct stat statBuffer;
+	if ( (::fstat(fd, &statBuffer) != 0) || (statBuffer.st_size < (off_t)sizeof(Header)) ) {
+		::close(fd);
+		return;
+	}
+	void* p = ::mmap(NULL, statBuffer.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if ( p == MAP_FAILED )
+		return;
+	_mappedContent = (const uint8_t*)p;
+	_mappedSize = statBuffer.st_size;
+
+	// a cache that does not check out completely is ignored, never partially used
+	const Header* header = (const Header*)_mappedContent;
+	const uint64_t expectedSize = sizeof(Header) + (uint64_t)header->fileCount * sizeof(FileEntry)
+								+ (uint64_t)header->memberCount * sizeof(uint32_t)
+								+ (uint64_t)header->resolutionCount * sizeof(ResolutionEntry)
+								+ (uint64_t)header->probeCount * sizeof(ProbeEntry) + header->stringPoolSize;
+	bool valid = (memcmp(header->magic, kCacheMagic, sizeof(kCacheMagic)) == 0)
+				&& (header->version == kCacheVersion)
+				&& (header->architecture == (uint32_t)_options.architecture())
+				&& (expectedSize == _mappedSize)
+				&& (header->stringPoolSize != 0);
+	if ( valid ) {
+		_files = (const FileEntry*)&_mappedContent[sizeof(Header)];
+		_memberOffsets = (const uint32_t*)&_files[header->fileCount];
+		_resolutions = (const ResolutionEntry*)&_memberOffsets[header->memberCount];
+		_probes = (const ProbeEntry*)&_resolutions[header->resolutionCount];
+		_strings = (const char*)&_probes[header->probeCount];
+		valid = (_strings[header->stringPoolSize-1] == '\0');
+	}
+	for (uint32_t i=0; valid && (i < header->fileCount); ++i) {
+		const FileEntry& file = _files[i];
+		valid = (file.pathOffset < header->stringPoolSize)
+				&& (file.firstMember <= header->memberCount)
+				&& (file.memberCount <= header->memberCount - file.firstMember);
+	}
+	for (uint32_t i=0; valid && (i < header->memberCount); ++i)
+		valid = (_memberOffsets[i] < header->stringPoolSize);
+	for (uint32_t i=0; valid && (i < header->resolutionCount); ++i) {
+		const ResolutionEntry& resolution = _resolutions[i];
+		valid = (resolution.installNameOffset < header->stringPoolSize)
+				&& (resolution.fromPathOffset < header->stringPoolSize)
+				&& (resolution.fileIndex < header->fileCount)
+				&& ((resolution.fromFileIndex == kNoFile) || (resolution.fromFileIndex < header->fileCount))
+				&& (resolution.firstProbe <= header->probeCount)
+				&& (resolution.probeCount <= header->probeCount - resolution.firstProbe);
+	}
+	for (uint32_t i=0; valid && (i < header->probeCount); ++i)
+		valid = (_probes[i].directoryOffset < header->stringPoolSize);
+	if ( !valid ) {
+		::munmap((void*)_mappedContent, _mappedSize);
+		_mappedContent = NULL;
+		_mappedSize = 0;
+		return;
+	}
+
+	_header = header;
+	_fileStates.resize(header->fileCount, 0);
+	for (uint32_t i=0; i < header->fileCount; ++i) {
+		if ( _files[i].kind == kFileArchive )
+			_archiveIndexes[&_strings[_files[i].pathOffset]] = i;
+	}
+	_resolutionsUsable = (header->searchPathsHash == this->searchPathsHash());
+	if ( _resolutionsUsable ) {
+		for (uint32_t i=0; i < header->resolutionCount; ++i) {
+			const ResolutionEntry& resolution = _resolutions[i];
+			const char* fromPath = (resolution.fromPathOffset != 0) ? &_strings[resolution.fromPathOffset] : NULL;
+			_resolutionIndexes[resolutionKey(&_strings[resolution.installNameOffset], fromPath)] = i;
+		}
+	}
+}
+
+bool LinkStateCache::fileUnchanged(uint32_t fileIndex) const
+{
+	int8_t& state = _fileStates[fileIndex];
+	if ( state == 0 ) {
+		const FileEntry& file = _files[fileIndex];
+		struct stat statBuffer;
+		bool same = (::stat(&_strings[file.pathOffset], &statBuffer) == 0)
+					&& ((int64_t)statBuffer.st_mtime == file.modTime)
+					&& ((uint64_t)statBuffer.st_size == file.size)
+					&& ((uint64_t)statBuffer.st_ino == file.inode);
+		state = same ? 1 : -1;
+	}
+	return (state == 1);
+}
+
+bool LinkStateCache::probesUnchanged(const ResolutionEntry& resolution) const
+{
+	// a file added where the search looked before finding the recorded one would be found instead
+	for (uint32_t i=resolution.firstProbe; i < resolution.firstProbe+resolution.probeCount; ++i) {
+		struct stat statBuffer;
+		if ( ::stat(&_strings[_probes[i].directoryOffset], &statBuffer) != 0 )
+			return false;
+		if ( (int64_t)statBuffer.st_mtime != _probes[i].modTime )
+			return false;
+	}
+	return true;
+}
+
+bool LinkStateCache::nearestDirectory(const std::string& missingPath, std::string& directory, int64_t& modTime)
+{
+	// a dangling symlink can start resolving without any directory along the path changing
+	struct stat statBuffer;
+	if ( ::lstat(missingPath.c_str(), &statBuffer) == 0 )
+		return false;
+	directory = missingPath;
+	while ( (directory != "/") && (directory != ".") ) {
+		const std::string::size_type lastSlash = directory.find_last_of('/');
+		if ( lastSlash == std::string::npos )
+			directory = ".";
+		else if ( lastSlash == 0 )
+			directory = "/";
+		else
+			directory.resize(lastSlash);
+		if ( (::stat(directory.c_str(), &statBuffer) == 0) && S_ISDIR(statBuffer.st_mode) ) {
+			modTime = statBuffer.st_mtime;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool LinkStateCache::archiveMembers(const char* archivePath, LDSet<std::string>& members) const
+{
+	if ( _header == NULL )
+		return false;
+	const auto pos = _archiveIndexes.find(archivePath);
+	if ( pos == _archiveIndexes.end() )
+		return false;
+	if ( !this->fileUnchanged(pos->second) )
+		return false;
+	const FileEntry& file = _files[pos->second];
+	for (uint32_t i=file.firstMember; i < file.firstMember+file.memberCount; ++i)
+		members.insert(std::string(&_strings[_memberOffsets[i]]));
+	return true;
+}
+
+const char* LinkStateCache::indirectDylibPath(const char* installName, const char* fromDylibPath) const
+{
+	if ( !_resolutionsUsable )
+		return NULL;
+	const auto pos = _resolutionIndexes.find(resolutionKey(installName, fromDylibPath));
+	if ( pos == _resolutionIndexes.end() )
+		return NULL;
+	const ResolutionEntry& resolution = _resolutions[pos->second];
+	// @rpath and @loader_path lookups also depend on the load commands of the referencing dylib
+	if ( (resolution.fromFileIndex != kNoFile) && !this->fileUnchanged(resolution.fromFileIndex) )
+		return NULL;
+	if ( !this->fileUnchanged(resolution.fileIndex) )
+		return NULL;
+	if ( !this->probesUnchanged(resolution) )
+		return NULL;
+	return &_strings[_files[resolution.fileIndex].pathOffset];
+}
+
+uint32_t LinkStateCache::pendingFileIndex(const char* path, uint32_t kind)
+{
+	const auto pos = _pendingFileIndexes.find(path);
+	if ( pos != _pendingFileIndexes.end() )
+		return pos->second;
+	uint32_t index = (uint32_t)_pendingFiles.size();
+	_pendingFiles.push_back({ path, kind, {} });
+	_pendingFileIndexes[path] = index;
+	return index;
+}
+
+void LinkStateCache::addArchiveMember(const char* archivePath, const char* memberName)
+{
+	_pendingFiles[this->pendingFileIndex(archivePath, kFileArchive)].members.push_back(memberName);
+}
+
+void LinkStateCache::addIndirectDylib(const char* installName, const char* fromDylibPath, const char* path,
+									  const std::vector<std::string>* missingPaths)
+{
+	std::string key = resolutionKey(installName, fromDylibPath);
+	if ( !_pendingResolutionKeys.insert(key).second )
+		return;
+	PendingResolution resolution;
+	if ( missingPaths != NULL ) {
+		// record the directories as the search saw them, not as they are when the link ends
+		LDSet<std::string> directories;
+		for (const std::string& missingPath : *missingPaths) {
+			std::string directory;
+			int64_t modTime;
+			if ( !nearestDirectory(missingPath, directory, modTime) )
+				return;
+			if ( directories.insert(directory).second )
+				resolution.probes.emplace_back(directory, modTime);
+		}
+	}
+	else {
+		// indirectDylibPath() answered, so carry over what the previous link probed
+		const auto pos = _resolutionIndexes.find(key);
+		if ( pos == _resolutionIndexes.end() )
+			return;
+		const ResolutionEntry& previous = _resolutions[pos->second];
+		for (uint32_t i=previous.firstProbe; i < previous.firstProbe+previous.probeCount; ++i)
+			resolution.probes.emplace_back(&_strings[_probes[i].directoryOffset], _probes[i].modTime);
+	}
+	resolution.installName = installName;
+	const bool dependsOnReferencer = (installName[0] == '@') && (fromDylibPath != NULL);
+	resolution.fromPath = dependsOnReferencer ? fromDylibPath : "";
+	resolution.fileIndex = this->pendingFileIndex(path, kFileDylib);
+	resolution.fromFileIndex = dependsOnReferencer ? this->pendingFileIndex(fromDylibPath, kFileDylib) : kNoFile;
+	_pendingResolutions.push_back(resolution);
+}
+
+void LinkStateCache::fileLoaded(const char* path, const struct stat& statBuffer)
+{
+	std::lock_guard<std::mutex> guard(_loadedFilesLock);
+	_loadedFiles[path] = { (int64_t)statBuffer.st_mtime, (uint64_t)statBuffer.st_size, (uint64_t)statBuffer.st_ino };
+}
+
+void LinkStateCache::save() const
+{
+	std::string path = _options.cacheOutputPath();
+	if ( path.empty() )
+		return;
+
+	// offset 0 of the string pool is the empty string
+	std::string strings(1, '\0');
+	LDMap<std::string, uint32_t> stringOffsets;
+	auto addString = [&](const std::string& str) -> uint32_t {
+		if ( str.empty() )
+			return 0;
+		const auto pos = stringOffsets.find(str);
+		if ( pos != stringOffsets.end() )
+			return pos->second;
+		uint32_t offset = (uint32_t)strings.size();
+		strings.append(str);
+		strings.push_back('\0');
+		stringOffsets[str] = offset;
+		return offset;
+	};
+
+	// entries describe the inputs as this link read them, a file that changes during the link then looks
+	// stale to the next one.  Files this link never opened itself are dropped.
+	std::lock_guard<std::mutex> guard(_loadedFilesLock);
+	std::vector<FileEntry> files;
+	std::vector<uint32_t> memberOffsets;
+	std::vector<uint32_t> fileIndexes(_pendingFiles.size(), kNoFile);
+	for (size_t i=0; i < _pendingFiles.size(); ++i) {
+		const PendingFile& pending = _pendingFiles[i];
+		const auto loaded = _loadedFiles.find(pending.path);
+		if ( loaded == _loadedFiles.end() )
+			continue;
+		std::vector<std::string> members = pending.members;
+		std::sort(members.begin(), members.end());
+		members.erase(std::unique(members.begin(), members.end()), members.end());
+		FileEntry entry;
+		entry.pathOffset	= addString(pending.path);
+		entry.kind			= pending.kind;
+		entry.firstMember	= (uint32_t)memberOffsets.size();
+		entry.memberCount	= (uint32_t)members.size();
+		entry.modTime		= loaded->second.modTime;
+		entry.size			= loaded->second.size;
+		entry.inode			= loaded->second.inode;
+		for (const std::string& member : members)
+			memberOffsets.push_back(addString(member));
+		fileIndexes[i] = (uint32_t)files.size();
+		files.push_back(entry);
+	}
+	std::vector<ResolutionEntry> resolutions;
+	std::vector<ProbeEntry> probes;
+	for (const PendingResolution& pending : _pendingResolutions) {
+		if ( fileIndexes[pending.fileIndex] == kNoFile )
+			continue;
+		if ( (pending.fromFileIndex != kNoFile) && (fileIndexes[pending.fromFileIndex] == kNoFile) )
+			continue;
+		ResolutionEntry entry;
+		entry.installNameOffset	= addString(pending.installName);
+		entry.fromPathOffset	= addString(pending.fromPath);
+		entry.fileIndex			= fileIndexes[pending.fileIndex];
+		entry.fromFileIndex		= (pending.fromFileIndex != kNoFile) ? fileIndexes[pending.fromFileIndex] : kNoFile;
+		entry.firstProbe		= (uint32_t)probes.size();
+		entry.probeCount		= (uint32_t)pending.probes.size();
+		for (const auto& probe : pending.probes)
+			probes.push_back({ addString(probe.first), 0, probe.second });
+		resolutions.push_back(entry);
+	}
+	if ( strings.size() > UINT32_MAX )
+		return;
+
+	// zeroed so the padding after the last field is written as zeros, not whatever was on the stack
+	Header header;
+	bzero(&header, sizeof(header));
+	memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+	header.version			= kCacheVersion;
+	header.architecture		= (uint32_t)_options.architecture();
+	header.searchPathsHash	= this->searchPathsHash();
+	header.fileCount		= (uint32_t)files.size();
+	header.memberCount		= (uint32_t)memberOffsets.size();
+	header.resolutionCount	= (uint32_t)resolutions.size();
+	header.probeCount		= (uint32_t)probes.size();
+	header.stringPoolSize	= (uint32_t)strings.size();
+	std::vector<uint8_t> content;
+	auto append = [&](const void* bytes, size_t length) {
+		content.insert(content.end(), (const uint8_t*)bytes, (const uint8_t*)bytes + length);
+	};
+	append(&header, sizeof(header));
+	append(files.data(), files.size() * sizeof(FileEntry));
+	append(memberOffsets.data(), memberOffsets.size() * sizeof(uint32_t));
+	append(resolutions.data(), resolutions.size() * sizeof(ResolutionEntry));
+	append(probes.data(), probes.size() * sizeof(ProbeEntry));
+	append(strings.data(), strings.size());
+
+	// write next to the cache and rename over it, so readers only ever see a complete cache.
+	// A cache that cannot be written just means the next link is a cold one.
+	std::string tempTemplate = path + ".XXXXXX";
+	std::vector<char> tempPath(tempTemplate.begin(), tempTemplate.end());
+	tempPath.push_back('\0');
+	int fd = ::mkstemp(tempPath.data());
+	if ( fd == -1 )
+		return;
+	bool written = true;
+	for (size_t offset=0; written && (offset < content.size()); ) {
+		ssize_t amount = ::write(fd, &content[offset], content.size() - offset);
+		if ( amount <= 0 )
+			written = false;
+		else
+			offset += amount;
+	}
+	if ( ::close(fd) != 0 )
+		written = false;
+	if ( !written || (::rename(tempPath.data(), path.c_str()) != 0) )
+		::unlink(tempPath.data());
+}
+
+} // namespace tool
+} // namespace ld
@@ -0,0 +1,152 @@
+//
+//  LinkStateCache.h
+//  ld
+//
+
+#ifndef __LINK_STATE_CACHE_H__
+#define __LINK_STATE_CACHE_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Options.h"
+#include "ld.hpp"
+
+namespace ld {
+namespace tool {
+
+//
+// LinkStateCache remembers what the previous link of the same output derived from its inputs:
+// which archive members were loaded, and which file each indirect dylib install name resolved to.
+// Every file is recorded with the mtime, size and inode it had when this link loaded it, and
+// anything derived from a file that has since changed is ignored.  A resolution also records the
+// nearest existing directory of each path its search probed and did not find, so one that a file
+// added since then would change is ignored as well.  The cache is a versioned binary file that is
+// memory mapped when read, and written to a temporary file that is renamed into place, so a reader
+// never sees a partial cache and concurrent writers cannot interleave.
+//
+class LinkStateCache
+{
+public:
+							LinkStateCache(const Options& opts);
+							~LinkStateCache();
+
+	// map the cache from the previous link, ignoring it if missing, malformed, or from another version
+	void					load();
+	// members loaded from the archive at archivePath by the previous link, false if unknown or stale
+	bool					archiveMembers(const char* archivePath, LDSet<std::string>& members) const;
+	// file the install name resolved to in the previous link, NULL if unknown or stale
+	const char*				indirectDylibPath(const char* installName, const char* fromDylibPath) const;
+
+	void					addArchiveMember(const char* archivePath, const char* memberName);
+	// missingPaths are the paths the search for installName probed before finding path, NULL if it
+	// was not searched because indirectDylibPath() answered
+	void					addIndirectDylib(const char* installName, const char* fromDylibPath, const char* path,
+											 const std::vector<std::string>* missingPaths);
+	// a file was opened for this link, call before anything is derived from it
+	void					fileLoaded(const char* path, const struct stat& statBuffer);
+	// atomically replace the cache with everything added during this link
+	void					save() const;
+
+private:
+	enum { kFileArchive=1, kFileDylib=2 };
+
+	struct Header {
+		char		magic[8];
+		uint32_t	version;
+		uint32_t	architecture;
+		uint64_t	searchPathsHash;
+		uint32_t	fileCount;
+		uint32_t	memberCount;
+		uint32_t	resolutionCount;
+		uint32_t	probeCount;
+		uint32_t	stringPoolSize;
+	};
+
+	struct FileEntry {
+		uint32_t	pathOffset;
+		uint32_t	kind;
+		uint32_t	firstMember;
+		uint32_t	memberCount;
+		int64_t		modTime;
+		uint64_t	size;
+		uint64_t	inode;
+	};
+
+	struct ResolutionEntry {
+		uint32_t	installNameOffset;
+		uint32_t	fromPathOffset;
+		uint32_t	fileIndex;
+		uint32_t	fromFileIndex;
+		uint32_t	firstProbe;
+		uint32_t	probeCount;
+	};
+
+	// a directory that did not contain a path the search probed, and its mtime at the time
+	struct ProbeEntry {
+		uint32_t	directoryOffset;
+		uint32_t	reserved;
+		int64_t		modTime;
+	};
+
+	struct LoadedFile {
+		int64_t		modTime;
+		uint64_t	size;
+		uint64_t	inode;
+	};
+
+	struct PendingFile {
+		std::string					path;
+		uint32_t					kind;
+		std::vector<std::string>	members;
+	};
+
+	struct PendingResolution {
+		std::string		installName;
+		std::string		fromPath;
+		uint32_t		fileIndex;
+		uint32_t		fromFileIndex;
+		std::vector<std::pair<std::string, int64_t>>	probes;
+	};
+
+	typedef LDMap<const char*, uint32_t, CStringHash, CStringEquals> NameToIndex;
+
+	static std::string		resolutionKey(const char* installName, const char* fromDylibPath);
+	uint64_t				searchPathsHash() const;
+	bool					fileUnchanged(uint32_t fileIndex) const;
+	bool					probesUnchanged(const ResolutionEntry& resolution) const;
+	static bool				nearestDirectory(const std::string& missingPath, std::string& directory, int64_t& modTime);
+	uint32_t				pendingFileIndex(const char* path, uint32_t kind);
+
+	const Options&							_options;
+	const uint8_t*							_mappedContent;
+	size_t									_mappedSize;
+	const Header*							_header;
+	const FileEntry*						_files;
+	const uint32_t*							_memberOffsets;
+	const ResolutionEntry*					_resolutions;
+	const ProbeEntry*						_probes;
+	const char*								_strings;
+	bool									_resolutionsUsable;
+	NameToIndex								_archiveIndexes;
+	LDMap<std::string, uint32_t>			_resolutionIndexes;
+	mutable std::vector<int8_t>				_fileStates;		// 0 = not yet checked, 1 = unchanged, -1 = changed
+
+	std::vector<PendingFile>				_pendingFiles;
+	LDMap<std::string, uint32_t>			_pendingFileIndexes;
+	std::vector<PendingResolution>			_pendingResolutions;
+	LDSet<std::string>						_pendingResolutionKeys;
+	mutable std::mutex						_loadedFilesLock;	// inputs are opened on several threads
+	LDMap<std::string, LoadedFile>			_loadedFiles;
+};
+
+} // namespace tool
+} // namespace ld
+
+#endif // __LINK_STATE_CACHE_H__
@@ -0,0 +1,131 @@
+//
+//  NameInterner.cpp
+//  ld
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <mutex>
+
+#include "MapDefines.h"
+#include "NameInterner.h"
+
+namespace ld {
+
+// interned names live in one lazily committed range so isInterned() is a range check
+static const uintptr_t	kRegionSize = 1ULL << 32;
+static const size_t		kChunkSize = 256 * 1024;
+static const unsigned	kShardCount = 64;
+
+struct NameInterner::Shard {
+	std::mutex						lock;
+	LDMap<uint64_t, const char*>	names;		// hash -> most recent name with that hash
+	char*							chunk = nullptr;
+	size_t							chunkRemaining = 0;
+};
+
+std::atomic<uintptr_t>	NameInterner::sRegionStart(0);
+std::atomic<uintptr_t>	NameInterner::sRegionSize(0);
+std::atomic<uintptr_t>	NameInterner::sRegionUsed(0);
+NameInterner::Shard*	NameInterner::sShards = nullptr;
+
+
+uint64_t NameInterner::hash(const char* name, size_t length)
+{
+	// multiply and xor-shift over 8-byte words, then a final avalanche so every bit of the result,
+	// including the top bits used to pick shards, depends on the whole name
+	const uint64_t kMultiplier = 0x9E3779B97F4A7C15ULL;
+	uint64_t h = 5183 ^ (length * kMultiplier);
+	const char* p = name;
+	const char* end = name + length;
+	for ( ; (end - p) >= 8; p += 8) {
+		uint64_t word;
+		memcpy(&word, p, 8);
+		h = (h ^ word) * kMultiplier;
+		h ^= (h >> 32);
+	}
+	uint64_t tail = 0;
+	memcpy(&tail, p, end - p);
+	h = (h ^ tail) * kMultiplier;
+	h ^= (h >> 29);
+	h *= 0xBF58476D1CE4E5B9ULL;
+	h ^= (h >> 32);
+	return h;
+}
+
+void NameInterner::reserveRegion()
+{
+	// shards are intentionally leaked so interning stays valid during static destruction
+	sShards = new Shard[kShardCount];
+	void* region = ::mmap(nullptr, kRegionSize, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+	if ( region == MAP_FAILED )
+		return;
+	sRegionStart.store((uintptr_t)region, std::memory_order_relaxed);
+	sRegionSize.store(kRegionSize, std::memory_order_release);
+}
+
+char* NameInterner::allocate(Shard& shard, size_t size)
+{
+	// keep headers 8-byte aligned
+	size = (size + 7) & ~(size_t)7;
+	if ( size > shard.chunkRemaining ) {
+		const size_t spanSize = std::max(size, kChunkSize);
+		const uintptr_t offset = sRegionUsed.fetch_add(spanSize, std::memory_order_relaxed);
+		if ( (offset + spanSize) > sRegionSize.load(std::memory_order_relaxed) )
+			return nullptr;
+		char* span = (char*)(sRegionStart.load(std::memory_order_relaxed) + offset);
+		// oversized names get a span of their own and leave the current chunk alone
+		if ( size > kChunkSize )
+			return span;
+		shard.chunk = span;
+		shard.chunkRemaining = spanSize;
+	}
+	char* result = shard.chunk;
+	shard.chunk += size;
+	shard.chunkRemaining -= size;
+	return result;
+}
+
+const char* NameInterner::intern(const char* name, size_t length)
+{
+	if ( isInterned(name) && (header(name)->length == length) )
+		return name;
+
+	static std::once_flag reserved;
+	std::call_once(reserved, reserveRegion);
+
+	const uint64_t h = hash(name, length);
+	Shard& shard = sShards[h >> 58];
+	std::lock_guard<std::mutex> guard(shard.lock);
+	auto pos = shard.names.find(h);
+	const char* sameHash = nullptr;
+	if ( pos != shard.names.end() ) {
+		sameHash = pos->second;
+		for (const char* s = sameHash; s != nullptr; s = header(s)->nextWithSameHash) {
+			if ( (header(s)->length == length) && (memcmp(s, name, length) == 0) )
+				return s;
+		}
+	}
+
+	char* entry = allocate(shard, sizeof(Header) + length + 1);
+	if ( entry == nullptr ) {
+		// address range exhausted, hand out a plain copy that CStringEquals compares by content
+		return strndup(name, length);
+	}
+	char* copy = entry + sizeof(Header);
+	memcpy(copy, name, length);
+	copy[length] = '\0';
+	Header* hdr = (Header*)entry;
+	hdr->hash = h;
+	hdr->nextWithSameHash = sameHash;
+	hdr->length = (uint32_t)length;
+	hdr->reserved = 0;
+	hdr->self = copy;
+	shard.names[h] = copy;
+	return copy;
+}
+
+} // namespace ld
@@ -0,0 +1,64 @@
+//
+//  NameInterner.h
+//  ld
+//
+
+#ifndef __NAME_INTERNER_H__
+#define __NAME_INTERNER_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+namespace ld {
+
+//
+// NameInterner keeps one immortal copy of each symbol name handed to it.  Every copy is preceded
+// by a header holding its length and a 64-bit hash computed once when the name is interned, and
+// all copies live in a single reserved address range.  That lets CStringHash return the stored
+// hash and CStringEquals compare two interned names by pointer, so tables keyed by names that
+// parsers interned never rehash or strcmp them.  Interning is thread safe.
+//
+class NameInterner
+{
+public:
+	// the unique copy of name; equal names always intern to the same pointer
+	static const char*		intern(const char* name)			{ return intern(name, strlen(name)); }
+	static const char*		intern(const char* name, size_t length);
+
+	static bool				isInterned(const char* name) {
+								// size is published after start, so read it first
+								uintptr_t size = sRegionSize.load(std::memory_order_acquire);
+								uintptr_t offset = (uintptr_t)name - sRegionStart.load(std::memory_order_relaxed);
+								// a pointer into the middle of an interned name can never match the
+								// self pointer, as the bytes before it are non-zero characters
+								return (offset >= sizeof(Header)) && (offset < size) && (header(name)->self == name);
+							}
+	static uint64_t			hash(const char* name)				{ return isInterned(name) ? header(name)->hash : hash(name, strlen(name)); }
+	static size_t			length(const char* name)			{ return isInterned(name) ? header(name)->length : strlen(name); }
+	static uint64_t			hash(const char* name, size_t length);
+
+private:
+	struct Header {
+		uint64_t			hash;
+		const char*			nextWithSameHash;
+		uint32_t			length;
+		uint32_t			reserved;
+		const char*			self;
+	};
+	struct Shard;
+
+	static const Header*	header(const char* name)			{ return (const Header*)(name - sizeof(Header)); }
+	static void				reserveRegion();
+	static char*			allocate(Shard& shard, size_t size);
+
+	static std::atomic<uintptr_t>	sRegionStart;
+	static std::atomic<uintptr_t>	sRegionSize;
+	static std::atomic<uintptr_t>	sRegionUsed;
+	static Shard*					sShards;
+};
+
+} // namespace ld
+
+#endif // __NAME_INTERNER_H__
@@ -38,6 +38,7 @@
 
 #include <vector>
 #include <map>
+#include <mutex>
 #include <sstream>
 
 #include "ld.hpp"
@@ -82,9 +83,35 @@ static bool			sFatalWarnings = false;
 static const char*	sWarningsSideFilePath = NULL;
 static FILE*		sWarningsSideFile = NULL;
 static int			sWarningsCount = 0;
+static std::mutex	sWarningsLock;		// symbol table shards and archive members may warn from worker threads
+static thread_local std::vector<std::string>* sCapturedWarnings = NULL;
+
+WarningCapture::WarningCapture(std::vector<std::string>* messages)
+	: _previous(sCapturedWarnings)
+{
+	if ( messages != NULL )
+		sCapturedWarnings = messages;
+}
+
+WarningCapture::~WarningCapture()
+{
+	sCapturedWarnings = _previous;
+}
 
 void warning(const char* format, ...)
 {
+	if ( sCapturedWarnings != NULL ) {
+		va_list	list;
+		va_start(list, format);
+		char* message;
+		if ( vasprintf(&message, format, list) != -1 ) {
+			sCapturedWarnings->push_back(message);
+			free(message);
+		}
+		va_end(list);
+		return;
+	}
+	std::lock_guard<std::mutex> lock(sWarningsLock);
 	++sWarningsCount;
 	if ( sEmitWarnings ) {
 		va_list	list;
@@ -211,7 +238,8 @@ Options::Options(int argc, const char* argv[])
 	  fForceObjCRelativeMethodListsOn(false), fForceObjCRelativeMethodListsOff(false), fUseObjCRelativeMethodLists(false),
 	  fSaveTempFiles(false), fLinkSnapshot(this), fSnapshotRequested(false), fPipelineFifo(NULL),
 	  fDependencyInfoPath(NULL), fBuildContextName(NULL), fTraceFileDescriptor(-1), fMaxDefaultCommonAlign(0),
-	  fUnalignedPointerTreatment(kUnalignedPointerIgnore), fPreferTAPIFile(false), fOSOPrefixPath(NULL)
+	  fUnalignedPointerTreatment(kUnalignedPointerIgnore), fPreferTAPIFile(false), fOSOPrefixPath(NULL),
+	  fCacheInputPath(NULL), fCacheOutputPath(NULL), fTBDCachePath(NULL), fTreeHashUUID(false), fWriteThreadCount(0), fPrefaultOutput(false), fTailMergeStrings(false), fThreadCount(0), fTraceEventsPath(NULL), fInputCostCount(0)
 {
 	this->expandResponseFiles(argc, argv);
 	this->checkForClassic(argc, argv);
@@ -793,12 +821,23 @@ bool Options::checkForFile(const char* format, const char* dir, const char* root
 {
 	char possiblePath[strlen(dir)+strlen(rootName)+strlen(format)+8];
 	sprintf(possiblePath, format,  dir, rootName);
-	bool found = result.checkFileExists(*this, possiblePath);
+	bool found = checkSearchPathFileExists(result, possiblePath);
 	if ( fTraceDylibSearching )
 		printf("[Logging for XBS]%sfound library: '%s'\n", (found ? " " : " not "), possiblePath);
 	return found;
 }
 
+// library, framework and indirect dylib searches mostly miss, so rule candidates out from the
+// directory listings before paying for a stat()
+bool Options::checkSearchPathFileExists(FileInfo& info, const char* path) const
+{
+	if ( !fSearchPathCache.mayExist(path) ) {
+		addDependency(Options::depNotFound, path);
+		return false;
+	}
+	return info.checkFileExists(*this, path);
+}
+
 
 Options::FileInfo Options::findLibrary(const char* rootName, bool dylibsOnly) const
 {
@@ -905,7 +944,7 @@ Options::FileInfo Options::findFramework(const char* rootName, const char* suffi
 		if ( suffix != nullptr ) {
 			char realPath[PATH_MAX];
 			// no symlink in framework to suffix variants, so follow main symlink
-			if ( realpath(possiblePath.c_str(), realPath) != nullptr )
+			if ( fSearchPathCache.mayExist(possiblePath.c_str()) && (realpath(possiblePath.c_str(), realPath) != nullptr) )
 				possiblePath = std::string(realPath).append(suffix);
 		}
         FileInfo result;
@@ -948,7 +987,7 @@ bool Options::findFile(const std::string &path, const std::vector<std::string> &
 	FileInfo tbdInfo;
 	for ( const auto &ext : tbdExtensions ) {
 		auto newPath = replace_extension(path, ext);
-		bool found = tbdInfo.checkFileExists(*this, newPath.c_str());
+		bool found = checkSearchPathFileExists(tbdInfo, newPath.c_str());
 		if ( fTraceDylibSearching )
 			printf("[Logging for XBS]%sfound library: '%s'\n", (found ? " " : " not "), newPath.c_str());
 		if ( found )
@@ -957,7 +996,7 @@ bool Options::findFile(const std::string &path, const std::vector<std::string> &
 
 	FileInfo dylibInfo;
 	{
-		bool found = dylibInfo.checkFileExists(*this, path.c_str());
+		bool found = checkSearchPathFileExists(dylibInfo, path.c_str());
 		if ( fTraceDylibSearching )
 			printf("[Logging for XBS]%sfound library: '%s'\n", (found ? " " : " not "), path.c_str());
 	}
@@ -4064,6 +4103,70 @@ void Options::parse(int argc, const char* argv[])
 			}
 			else if (strcmp(arg, "-zld_force") == 0) {
 			}
+			else if (strcmp(arg, "-zld_cache_input") == 0) {
+				fCacheInputPath = argv[++i];
+				if ( fCacheInputPath == NULL )
+					throw "-zld_cache_input missing path";
+			}
+			else if (strcmp(arg, "-zld_cache_output") == 0) {
+				fCacheOutputPath = argv[++i];
+				if ( fCacheOutputPath == NULL )
+					throw "-zld_cache_output missing path";
+			}
+			else if (strcmp(arg, "-zld_tbd_cache") == 0) {
+				fTBDCachePath = argv[++i];
+				if ( fTBDCachePath == NULL )
+					throw "-zld_tbd_cache missing path";
+			}
+			else if (strcmp(arg, "-zld_uuid_hash") == 0) {
+				const char* hashName = argv[++i];
+				if ( hashName == NULL )
+					throw "-zld_uuid_hash missing md5 or tree";
+				if ( strcmp(hashName, "tree") == 0 )
+					fTreeHashUUID = true;
+				else if ( strcmp(hashName, "md5") == 0 )
+					fTreeHashUUID = false;
+				else
+					throwf("unknown -zld_uuid_hash '%s', expected md5 or tree", hashName);
+			}
+			else if (strcmp(arg, "-zld_write_threads") == 0) {
+				const char* value = argv[++i];
+				if ( value == NULL )
+					throw "missing argument to -zld_write_threads";
+				char* endptr;
+				fWriteThreadCount = (uint32_t)strtoul(value, &endptr, 10);
+				if ( (*endptr != '\0') || (fWriteThreadCount == 0) )
+					throw "invalid argument for -zld_write_threads";
+			}
+			else if (strcmp(arg, "-zld_prefault_output") == 0) {
+				fPrefaultOutput = true;
+			}
+			else if (strcmp(arg, "-zld_tail_merge_strings") == 0) {
+				fTailMergeStrings = true;
+			}
+			else if (strcmp(arg, "-threads") == 0) {
+				const char* value = argv[++i];
+				if ( value == NULL )
+					throw "missing argument to -threads";
+				char* endptr;
+				fThreadCount = (uint32_t)strtoul(value, &endptr, 10);
+				if ( (*endptr != '\0') || (fThreadCount == 0) )
+					throw "invalid argument for -threads";
+			}
+			else if (strcmp(arg, "-zld_trace_events") == 0) {
+				fTraceEventsPath = argv[++i];
+				if ( fTraceEventsPath == NULL )
+					throw "-zld_trace_events missing path";
+			}
+			else if (strcmp(arg, "-zld_input_costs") == 0) {
+				const char* value = argv[++i];
+				if ( value == NULL )
+					throw "missing argument to -zld_input_costs";
+				char* endptr;
+				fInputCostCount = (uint32_t)strtoul(value, &endptr, 10);
+				if ( (*endptr != '\0') || (fInputCostCount == 0) )
+					throw "invalid argument for -zld_input_costs";
+			}
 			else if (strcmp(arg, "-no_adhoc_codesign") == 0) {
 			}
 			else if (strcmp(arg, "-no_new_main") == 0) {
@@ -4575,6 +4678,16 @@ void Options::parsePostCommandLineEnvironmentSettings()
 	if ( getenv("LD_WARN_COMMONS") != NULL )
 		fWarnCommons = true;
 	
+	// allow build system to cap the threads of each of the links it runs at once
+	if ( const char* threads = getenv("ZLD_THREADS") ) {
+		char* endptr;
+		uint32_t count = (uint32_t)strtoul(threads, &endptr, 10);
+		if ( (*endptr != '\0') || (count == 0) )
+			warning("ignoring ZLD_THREADS=%s, expected a number of threads", threads);
+		else
+			fThreadCount = count;
+	}
+
 	// allow B&I to set default -source_version
 	if ( fSourceVersion == 0 ) {
 		const char* vers = getenv("RC_ProjectSourceVersion");
@@ -6539,8 +6652,9 @@ const char* Options::demangleSymbol(const char* sym) const
 	if ( !fDemangle )
 		return sym;
 
-	static size_t size = 1024;
-	static char* buff = (char*)malloc(size);
+	// one buffer per thread, warnings are also issued from passes that run in parallel
+	static thread_local size_t size = 1024;
+	static thread_local char* buff = (char*)malloc(size);
 
 #if DEMANGLE_SWIFT
 	// only try to demangle symbols that look like Swift symbols
@@ -6610,8 +6724,23 @@ void Options::writeDependencyInfo() const
 }
 
 
+static thread_local std::vector<std::string>* sCapturedMissingPaths = NULL;
+
+Options::MissingPathCapture::MissingPathCapture(std::vector<std::string>& paths)
+	: _previous(sCapturedMissingPaths)
+{
+	sCapturedMissingPaths = &paths;
+}
+
+Options::MissingPathCapture::~MissingPathCapture()
+{
+	sCapturedMissingPaths = _previous;
+}
+
 void Options::addDependency(uint8_t opcode, const char* path) const
 {
+	if ( (opcode == depNotFound) && (sCapturedMissingPaths != NULL) )
+		sCapturedMissingPaths->push_back(path);
 	if ( !this->dumpDependencyInfo() ) 
 		return;
 
@@ -30,11 +30,13 @@
 #include <mach/machine.h>
 #include <tapi/tapi.h>
 
+#include <string>
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
 
 #include "ld.hpp"
+#include "SearchPathCache.h"
 #include "Snapshot.h"
 #include "MachOFileAbstraction.hpp"
 
@@ -42,6 +44,17 @@
 extern void throwf (const char* format, ...) __attribute__ ((noreturn,format(printf, 1, 2)));
 extern void warning(const char* format, ...) __attribute__((format(printf, 1, 2)));
 
+// While alive, warning() on the thread that made it appends to messages instead of printing, so work
+// done speculatively can report its warnings later, once it turns out to be needed.  NULL captures nothing.
+class WarningCapture
+{
+public:
+						WarningCapture(std::vector<std::string>* messages);
+						~WarningCapture();
+private:
+	std::vector<std::string>*	_previous;
+};
+
 class Snapshot;
 
 class LibraryOptions
@@ -266,6 +279,17 @@ public:
 		  depOutputFile = 0x40 };
 	
 	void						addDependency(uint8_t, const char* path) const;
+
+	// While alive, the paths that searches on the thread that made it probed and did not find (depNotFound)
+	// are also appended to paths, whether or not -dependency_info was given.
+	class MissingPathCapture
+	{
+	public:
+							MissingPathCapture(std::vector<std::string>& paths);
+							~MissingPathCapture();
+	private:
+		std::vector<std::string>*	_previous;
+	};
 	
 	typedef const char* const*	UndefinesIterator;
 
@@ -278,6 +302,20 @@ public:
 		}
 		return "/tmp/zld-" + std::to_string(hash);
 	}
+	// -zld_cache_input/-zld_cache_output, otherwise cacheFilePath() unless only the other one was given.
+	// An empty path means no cache is read (or written).
+	std::string cacheInputPath() const {
+		if ( fCacheInputPath != NULL )
+			return fCacheInputPath;
+		return (fCacheOutputPath != NULL) ? std::string() : cacheFilePath();
+	}
+	std::string cacheOutputPath() const {
+		if ( fCacheOutputPath != NULL )
+			return fCacheOutputPath;
+		return (fCacheInputPath != NULL) ? std::string() : cacheFilePath();
+	}
+	// directory of parsed .tbd files (-zld_tbd_cache), NULL unless one was given
+	const char* tbdCachePath() const { return ((fTBDCachePath != NULL) && (fTBDCachePath[0] != '\0')) ? fTBDCachePath : NULL; }
 
 //	const ObjectFile::ReaderOptions&	readerOptions();
 	const char*							outputFilePath() const { return fOutputFile; }
@@ -346,6 +384,7 @@ public:
 	UndefinesIterator			initialUndefinesEnd() const { return &fInitialUndefines[fInitialUndefines.size()]; }
 	const std::vector<const char*>&	initialUndefines() const { return fInitialUndefines; }
 	bool						printWhyLive(const char* name) const;
+	bool						hasWhyLive() const { return !fWhyLive.empty(); }
 	uint32_t					minimumHeaderPad() const { return fMinimumHeaderPad; }
 	bool						maxMminimumHeaderPad() const { return fMaxMinimumHeaderPad; }
 	ExtraSection::const_iterator	extraSectionsBegin() const { return &fExtraSections[0]; }
@@ -358,6 +397,20 @@ public:
 	bool						hasInlinedTAPIFile(const std::string &path) const;
 	tapi::LinkerInterfaceFile*	findTAPIFile(const std::string &path) const;
 	UUIDMode					UUIDMode() const { return fUUIDMode; }
+	// content UUID hashes fixed size chunks in parallel, then their digests (-zld_uuid_hash tree)
+	bool						treeHashUUID() const { return fTreeHashUUID; }
+	// Chrome trace event file recording the phases of the link (-zld_trace_events), or NULL
+	const char*					traceEventsPath() const { return fTraceEventsPath; }
+	// number of most expensive input files to print parse, probe and output costs for (-zld_input_costs), 0 for none
+	uint32_t					inputCostCount() const { return fInputCostCount; }
+	// number of threads all parallel work shares (-threads, or ZLD_THREADS), 0 means one per core
+	uint32_t					threadCount() const { return fThreadCount; }
+	// number of threads writing atoms into the output buffer (-zld_write_threads), 0 means -threads
+	uint32_t					writeThreadCount() const { return fWriteThreadCount; }
+	// touch every page of the mapped output file up front, in parallel (-zld_prefault_output)
+	bool						prefaultOutput() const { return fPrefaultOutput; }
+	// symbol names that end other symbol names share their bytes in the string pool (-zld_tail_merge_strings)
+	bool						tailMergeStrings() const { return fTailMergeStrings; }
 	bool						warnStabs();
 	bool						pauseAtEnd() { return fPause; }
 	bool						printStatistics() const { return fStatistics; }
@@ -530,6 +583,8 @@ public:
 	bool						moveAXMethodList(const char* className) const;
 	const ld::VersionSet& 		platforms() const { return fPlatforms; }
 	const std::vector<const char*>&	sdkPaths() const { return fSDKPaths; }
+	const std::vector<const char*>&	librarySearchPaths() const { return fLibrarySearchPaths; }
+	const std::vector<const char*>&	frameworkSearchPaths() const { return fFrameworkSearchPaths; }
 	bool						internalSDK() const { return fInternalSDK; }
 	bool						adHocSign() const { return fAdHocSign; }
 	bool						platformMismatchesAreWarning() const { return fPlatformMismatchesAreWarning; }
@@ -602,6 +657,7 @@ private:
 	FileInfo					findFramework(const char* rootName, const char* suffix) const;
 	bool						checkForFile(const char* format, const char* dir, const char* rootName,
 											 FileInfo& result) const;
+	bool						checkSearchPathFileExists(FileInfo& info, const char* path) const;
 	uint64_t					parseVersionNumber64(const char*);
 	std::string					getVersionString32(uint32_t ver) const;
 	std::string					getVersionString64(uint64_t ver) const;
@@ -905,6 +961,17 @@ private:
 	mutable std::vector<Options::TAPIInterface> fTAPIFiles;
 	bool								fPreferTAPIFile;
 	const char*							fOSOPrefixPath;
+	const char*							fCacheInputPath;
+	const char*							fCacheOutputPath;
+	const char*							fTBDCachePath;
+	mutable ld::SearchPathCache			fSearchPathCache;
+	bool								fTreeHashUUID;
+	uint32_t							fWriteThreadCount;
+	bool								fPrefaultOutput;
+	bool								fTailMergeStrings;
+	uint32_t							fThreadCount;
+	const char*							fTraceEventsPath;
+	uint32_t							fInputCostCount;
 };
 
 
@@ -45,9 +45,7 @@
 #include <dlfcn.h>
 #include <mach-o/dyld.h>
 #include <mach-o/fat.h>
-#include <dispatch/dispatch.h>
 #include <algorithm>
-#include <Foundation/Foundation.h>
 
 #include <string>
 #include <map>
@@ -60,8 +58,15 @@
 #include <utility>
 #include <iostream>
 #include <fstream>
+#include <functional>
 
 #include <CommonCrypto/CommonDigest.h>
+#include <tbb/blocked_range.h>
+#include <tbb/global_control.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_for_each.h>
+#include <tbb/parallel_invoke.h>
+#include <tbb/task_arena.h>
 #include <AvailabilityMacros.h>
 
 #include "MachOTrie.hpp"
@@ -75,6 +80,7 @@
 #include "LinkEdit.hpp"
 #include "LinkEditClassic.hpp"
 #include "generic_dylib_file.hpp"
+#include "TraceEvents.h"
 
 namespace ld {
 namespace tool {
@@ -167,23 +173,25 @@ void OutputFile::write(ld::Internal& state)
 	this->setLoadCommandsPadding(state);
 	_fileSize = state.assignFileOffsets();
 	this->assignAtomAddresses(state);
-	dispatch_group_t group = dispatch_group_create();
-	auto queue = dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
-	//dispatch_queue_attr_t attr = DISPATCH_QUEUE_SERIAL;
-	//auto queue = dispatch_queue_create("asdf", attr);
-	dispatch_group_async(group, queue, ^{
-    	this->synthesizeDebugNotes(state);
-	});
-	dispatch_group_async(group, queue, ^{
-		this->buildSymbolTable(state);
-    	this->generateLinkEditInfo(state);
+	tbb::parallel_invoke([&] {
+		ld::TraceEvents::Span span("debug notes", "output");
+		this->synthesizeDebugNotes(state);
+	}, [&] {
+		{
+			ld::TraceEvents::Span span("symbol table", "output");
+			this->buildSymbolTable(state);
+		}
+		ld::TraceEvents::Span span("dyld info", "output");
+		this->generateLinkEditInfo(state);
 	});
-	dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
 	if ( _options.sharedRegionEncodingV2() )
 		this->makeSplitSegInfoV2(state);
 	else
 		this->makeSplitSegInfo(state);
-	this->buildChainedFixupInfo(state);
+	{
+		ld::TraceEvents::Span span("chained fixups", "output");
+		this->buildChainedFixupInfo(state);
+	}
 	this->updateLINKEDITAddresses(state);
 	//this->dumpAtomsBySection(state, false);
 	this->writeOutputFile(state);
@@ -249,102 +257,113 @@ void OutputFile::assignAtomAddresses(ld::Internal& state)
 
 void OutputFile::updateLINKEDITAddresses(ld::Internal& state)
 {
-	auto queue = [[NSOperationQueue alloc] init];
-	queue.qualityOfService = NSQualityOfServiceUserInteractive;
-	// initialize info for parsing input files on worker threads
-	unsigned int ncpus;
-	int mib[2];
-	size_t len = sizeof(ncpus);
-	mib[0] = CTL_HW;
-	mib[1] = HW_NCPU;
-	auto res = sysctl(mib, 2, &ncpus, &len, NULL, 0);
-	if (res != 0) {
-		ncpus = 1;
-	}
-	queue.maxConcurrentOperationCount = ncpus;
-	if ( _options.makeChainedFixups() && !state.cantUseChainedFixups && _options.dyldOrKernelLoadsOutput() ) {
-		if ( _hasExportsTrie ) {
-		assert(_exportInfoAtom != NULL);
-		_exportInfoAtom->encode();
-		}
-
+	// Each encoder builds its own atom, so they run concurrently, except that binding info follows
+	// rebase info (which sorts _rebaseInfo, and linked list binding encodes the rebases too) and
+	// everything that refers to symbol indexes follows the symbol table that assigns them.
+	struct EncodeTask {
+		const char*				name;
+		int						after;		// index of the task that must finish first, -1 if none
+		std::function<void()>	encode;
+		uint64_t				time;
+	};
+	std::vector<EncodeTask> tasks;
+	auto addTask = [&](const char* name, int after, std::function<void()> encode) -> int {
+		tasks.push_back({ name, after, encode, 0 });
+		return (int)tasks.size() - 1;
+	};
+
+	const bool chainedFixups = _options.makeChainedFixups() && !state.cantUseChainedFixups && _options.dyldOrKernelLoadsOutput();
+	if ( chainedFixups ) {
 		assert(_chainedInfoAtom != NULL);
-		_chainedInfoAtom->encode();
+		addTask("chained fixups", -1, [&] { _chainedInfoAtom->encode(); });
 	}
-	else if ( _options.makeCompressedDyldInfo() || state.cantUseChainedFixups) {
+	else if ( _options.makeCompressedDyldInfo() || state.cantUseChainedFixups ) {
 		// build dylb rebasing info
 		assert(_rebasingInfoAtom != NULL);
-		_rebasingInfoAtom->encode();
+		int rebaseTask = addTask("rebase info", -1, [&] { _rebasingInfoAtom->encode(); });
 
 		// build dyld binding info  
 		assert(_bindingInfoAtom != NULL);
-		_bindingInfoAtom->encode();
+		addTask("binding info", rebaseTask, [&] { _bindingInfoAtom->encode(); });
 
 		// build dyld lazy binding info  
 		assert(_lazyBindingInfoAtom != NULL);
-		_lazyBindingInfoAtom->encode();
+		addTask("lazy binding info", -1, [&] { _lazyBindingInfoAtom->encode(); });
 
 		// build dyld weak binding info  
 		assert(_weakBindingInfoAtom != NULL);
-		_weakBindingInfoAtom->encode();
+		addTask("weak binding info", -1, [&] { _weakBindingInfoAtom->encode(); });
+	}
+
+	// build dyld export info
+	if ( (chainedFixups && _hasExportsTrie) || _options.makeCompressedDyldInfo() ) {
+		assert(_exportInfoAtom != NULL);
+		addTask("export trie", -1, [&] { _exportInfoAtom->encode(); });
 	}
 
 	if ( _options.sharedRegionEligible() ) {
 		// build split seg info  
 		assert(_splitSegInfoAtom != NULL);
-		_splitSegInfoAtom->encode();
+		addTask("split seg info", -1, [&] { _splitSegInfoAtom->encode(); });
 	}
 
 	if ( _options.addFunctionStarts() ) {
 		// build function starts info  
 		assert(_functionStartsAtom != NULL);
-		_functionStartsAtom->encode();
+		addTask("function starts", -1, [&] { _functionStartsAtom->encode(); });
 	}
 
 	if ( _options.addDataInCodeInfo() ) {
 		// build data-in-code info  
 		assert(_dataInCodeAtom != NULL);
-		_dataInCodeAtom->encode();
+		addTask("data in code", -1, [&] { _dataInCodeAtom->encode(); });
 	}
 	
 	if ( _hasOptimizationHints ) {
 		// build linker-optimization-hint info  
 		assert(_optimizationHintsAtom != NULL);
-		_optimizationHintsAtom->encode();
+		addTask("optimization hints", -1, [&] { _optimizationHintsAtom->encode(); });
 	}
-	
 
-	if (_options.makeCompressedDyldInfo()) {
-    	// build dyld export info
-    	assert(_exportInfoAtom != NULL);
-    	[queue addOperationWithBlock:^{
-    		_exportInfoAtom->encode();
-    	}];
-	}
-	
 	// build classic symbol table
 	assert(_symbolTableAtom != NULL);
-	[queue addOperationWithBlock:^{
-		_symbolTableAtom->encode();
-	}];
-	[queue waitUntilAllOperationsAreFinished];
+	int symbolTableTask = addTask("symbol table", -1, [&] { _symbolTableAtom->encode(); });
 	assert(_indirectSymbolTableAtom != NULL);
-	_indirectSymbolTableAtom->encode();
+	addTask("indirect symbol table", symbolTableTask, [&] { _indirectSymbolTableAtom->encode(); });
 
 	// add relocations to .o files
 	if ( _options.outputKind() == Options::kObjectFile ) {
 		assert(_sectionsRelocationsAtom != NULL);
-		_sectionsRelocationsAtom->encode();
+		addTask("section relocations", symbolTableTask, [&] { _sectionsRelocationsAtom->encode(); });
 	}
 
 	if ( !_options.makeCompressedDyldInfo() && !_options.makeThreadedStartsSection() && !_options.makeChainedFixups() ) {
 		// build external relocations 
 		assert(_externalRelocsAtom != NULL);
-		_externalRelocsAtom->encode();
+		addTask("external relocations", symbolTableTask, [&] { _externalRelocsAtom->encode(); });
 		// build local relocations 
 		assert(_localRelocsAtom != NULL);
-		_localRelocsAtom->encode();
-	}
+		addTask("local relocations", symbolTableTask, [&] { _localRelocsAtom->encode(); });
+	}
+
+	std::vector<int> readyTasks;
+	for (int i=0; i < (int)tasks.size(); ++i) {
+		if ( tasks[i].after == -1 )
+			readyTasks.push_back(i);
+	}
+	tbb::parallel_for_each(readyTasks.begin(), readyTasks.end(), [&](int index, tbb::feeder<int>& feeder) {
+		EncodeTask& task = tasks[index];
+		ld::TraceEvents::Span span(task.name, "linkedit");
+		uint64_t startTime = mach_absolute_time();
+		task.encode();
+		task.time = mach_absolute_time() - startTime;
+		for (int i=0; i < (int)tasks.size(); ++i) {
+			if ( tasks[i].after == index )
+				feeder.add(i);
+		}
+	});
+	for (const EncodeTask& task : tasks)
+		_linkEditEncodeTimes.emplace_back(task.name, task.time);
 
 	// update address and file offsets now that linkedit content has been generated
 	uint64_t curLinkEditAddress = 0;
@@ -3168,15 +3187,44 @@ void OutputFile::writeAtoms(ld::Internal& state, uint8_t* wholeBuffer)
 			}
 		}
 	}
-	NSOperationQueue *queue = [[NSOperationQueue alloc] init];
-	queue.qualityOfService = NSQualityOfServiceUserInteractive;
-	queue.maxConcurrentOperationCount = 8;
-	int stepSize = buffer.size() / queue.maxConcurrentOperationCount + 1;
-	for (size_t i = 0; i < (size_t)queue.maxConcurrentOperationCount; i++) {
-		std::vector<AtomOperation> &bufferCopy = buffer;
-		[queue addOperationWithBlock:^{
-			for (auto bufIter = bufferCopy.begin() + i * stepSize; bufIter < bufferCopy.begin() + std::min(bufferCopy.size(), (i + 1) * stepSize); bufIter++) {
-				auto op = *bufIter;
+	// split the atoms into contiguous chunks of about equal cost, an atom costing its size plus a
+	// fixed amount per fixup, with several chunks per thread so idle threads can steal the rest
+	const uint64_t costPerFixup = 32;
+	auto atomCost = [&](const AtomOperation& op) -> uint64_t {
+		return (op.fileOffset + op.atom->size() - std::min(op.fileOffset, op.fileOffsetOfEndOfLastAtom))
+				+ costPerFixup * (op.atom->fixupsEnd() - op.atom->fixupsBegin());
+	};
+	const unsigned threadCount = (_options.writeThreadCount() != 0) ? _options.writeThreadCount()
+															: tbb::global_control::active_value(tbb::global_control::max_allowed_parallelism);
+	uint64_t totalCost = 0;
+	for (const AtomOperation& op : buffer)
+		totalCost += atomCost(op);
+	const uint64_t chunkCost = std::max(totalCost / (threadCount * 16), (uint64_t)256*1024);
+	std::vector<size_t> chunkStarts;
+	uint64_t costOfChunk = chunkCost;
+	for (size_t i = 0; i < buffer.size(); ++i) {
+		if ( costOfChunk >= chunkCost ) {
+			chunkStarts.push_back(i);
+			costOfChunk = 0;
+		}
+		costOfChunk += atomCost(buffer[i]);
+	}
+	chunkStarts.push_back(buffer.size());
+
+	// if code signing, each chunk hashes the pages it has finished as it goes, so that only pages
+	// shared with another chunk or patched below are left for the final signing pass
+	const CodeSignatureAtom* codeSignatureAtom = _hasCodeSignature ? _codeSignatureAtom : NULL;
+	if ( codeSignatureAtom != NULL )
+		codeSignatureAtom->beginHashing(wholeBuffer);
+	const uint64_t hashBatchSize = 16 * 4096;
+	auto writeChunk = [&](size_t startIndex, size_t endIndex) {
+		// [hashStart, hashEnd) is written by this chunk and not yet hashed
+		uint64_t hashStart = 0;
+		uint64_t hashEnd = 0;
+		bool hashing = (codeSignatureAtom != NULL);
+		for (size_t i = startIndex; i < endIndex; ++i) {
+			const AtomOperation& op = buffer[i];
+			try {
 				// check for alignment padding between atoms
 				if ( (op.fileOffset != op.fileOffsetOfEndOfLastAtom) && op.lastAtomUsesNoOps ) {
 					this->copyNoOps(&wholeBuffer[op.fileOffsetOfEndOfLastAtom], &wholeBuffer[op.fileOffset], op.lastAtomWasThumb);
@@ -3186,9 +3234,64 @@ void OutputFile::writeAtoms(ld::Internal& state, uint8_t* wholeBuffer)
 				// apply fix ups
 				this->applyFixUps(state, op.mhAddress, op.atom, &wholeBuffer[op.fileOffset]);
 			}
-		}];
-	}
-	[queue waitUntilAllOperationsAreFinished];
+			catch (const char* msg) {
+				if ( op.atom->file() != NULL )
+					throwf("%s in '%s' from %s", msg, op.atom->name(), op.atom->safeFilePath());
+				else
+					throwf("%s in '%s'", msg, op.atom->name());
+			}
+			if ( !hashing )
+				continue;
+			if ( op.fileOffset < op.fileOffsetOfEndOfLastAtom ) {
+				// atoms out of file order, leave the rest to the signing pass
+				codeSignatureAtom->hashPages(hashStart, hashEnd);
+				hashing = false;
+				continue;
+			}
+			if ( op.fileOffsetOfEndOfLastAtom != hashEnd ) {
+				codeSignatureAtom->hashPages(hashStart, hashEnd);
+				hashStart = op.fileOffsetOfEndOfLastAtom;
+			}
+			hashEnd = op.fileOffset + op.atom->size();
+			if ( hashEnd - hashStart >= hashBatchSize ) {
+				codeSignatureAtom->hashPages(hashStart, hashEnd);
+				// the page hashEnd is in may still get more atoms
+				hashStart = (hashEnd / 4096) * 4096;
+			}
+		}
+		if ( hashing )
+			codeSignatureAtom->hashPages(hashStart, hashEnd);
+	};
+
+	// time each thread spends writing, to show how evenly the chunks were spread
+	tbb::task_arena arena(threadCount);
+	std::vector<uint64_t> busyTimes(arena.max_concurrency(), 0);
+	arena.execute([&] {
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, chunkStarts.size() - 1, 1), [&](const tbb::blocked_range<size_t>& range) {
+			uint64_t startTime = mach_absolute_time();
+			for (size_t chunk = range.begin(); chunk != range.end(); ++chunk) {
+				// counted before the span starts, so that its time is only the writing
+				uint64_t fixupCount = 0;
+				uint64_t byteCount = 0;
+				if ( ld::TraceEvents::enabled() ) {
+					const AtomOperation& first = buffer[chunkStarts[chunk]];
+					const AtomOperation& last = buffer[chunkStarts[chunk+1]-1];
+					for (size_t i = chunkStarts[chunk]; i != chunkStarts[chunk+1]; ++i)
+						fixupCount += buffer[i].atom->fixupsEnd() - buffer[i].atom->fixupsBegin();
+					byteCount = last.fileOffset + last.atom->size() - std::min(first.fileOffset, first.fileOffsetOfEndOfLastAtom);
+				}
+				ld::TraceEvents::Span span("write atoms", "output");
+				if ( span.recording() ) {
+					span.counter("atoms", chunkStarts[chunk+1] - chunkStarts[chunk]);
+					span.counter("fixups", fixupCount);
+					span.counter("bytes", byteCount);
+				}
+				writeChunk(chunkStarts[chunk], chunkStarts[chunk+1]);
+			}
+			busyTimes[tbb::this_task_arena::current_thread_index()] += mach_absolute_time() - startTime;
+		}, tbb::simple_partitioner());
+	});
+	_writeAtomsBusyTimes = busyTimes;
 
 	if ( _options.verboseOptimizationHints() ) {
 		//fprintf(stderr, "ADRP optimized away:   %d\n", sAdrpNA);
@@ -3404,6 +3507,7 @@ void OutputFile::writeAtoms(ld::Internal& state, uint8_t* wholeBuffer)
 					// The delta is bits [51..61]
 					value |= ( delta << 51 );
 					set64LE(lastBindLocation, value);
+					invalidateCodeSignaturePages(lastBindLocation - wholeBuffer, sizeof(uint64_t));
 					break;
 			}
 		};
@@ -3443,6 +3547,7 @@ void OutputFile::writeAtoms(ld::Internal& state, uint8_t* wholeBuffer)
 				threadStartsAtom = atom;
 			}
 			uint64_t threadStartsFileOffset = threadStartsAtom->finalAddress() - threadStartsSection->address + threadStartsSection->fileOffset;
+			invalidateCodeSignaturePages(threadStartsSection->fileOffset, threadStartsSection->size);
 			// Skip the header
 			if (logThreadedFixups) fprintf(stderr, "thread start[0x%llX]: header=0x%X\n", threadStartsFileOffset, get32LE(&wholeBuffer[threadStartsFileOffset]));
 			threadStartsFileOffset += sizeof(uint32_t);
@@ -3457,6 +3562,20 @@ void OutputFile::writeAtoms(ld::Internal& state, uint8_t* wholeBuffer)
 	}
 
 	if ( _options.makeChainedFixups() && !state.cantUseChainedFixups  ) {
+		// chaining rewrites every page with fixups, the chain starts and any page start overflows
+		for (const ChainedFixupSegInfo& segInfo : _chainedFixupSegments) {
+			uint64_t pageFileOffset = segInfo.fileOffset;
+			for (const ChainedFixupPageInfo& pageInfo : segInfo.pages) {
+				if ( !pageInfo.fixupOffsets.empty() )
+					invalidateCodeSignaturePages(pageFileOffset, segInfo.pageSize);
+				pageFileOffset += segInfo.pageSize;
+			}
+		}
+		for (ld::Internal::FinalSection* sect : state.sections) {
+			if ( (sect->type() == ld::Section::typeChainStarts)
+				|| ((sect->type() == ld::Section::typeLinkEdit) && (strcmp(sect->sectionName(), "__chainfixups") == 0)) )
+				invalidateCodeSignaturePages(sect->fileOffset, sect->size);
+		}
 
 		// for firmware, chains are not page based.  We just make the chains as long as possible
 		if ( !_options.dyldOrKernelLoadsOutput()) {
@@ -3538,49 +3657,30 @@ void OutputFile::writeAtoms(ld::Internal& state, uint8_t* wholeBuffer)
 			}
 		}
 		else {
-			// chain together fixups
+			// chain together fixups, each page's chain only touches that page so pages are linked in parallel
+			std::vector<std::pair<uint32_t, uint32_t>> fixupPages; // segment index, page index
+			for (uint32_t segIndex = 0; segIndex < _chainedFixupSegments.size(); ++segIndex) {
+				const ChainedFixupSegInfo& segInfo = _chainedFixupSegments[segIndex];
+				for (uint32_t pageIndex = 0; pageIndex < segInfo.pages.size(); ++pageIndex) {
+					if ( segInfo.pages[pageIndex].fixupOffsets.size() > 1 )
+						fixupPages.push_back(std::make_pair(segIndex, pageIndex));
+				}
+			}
+			tbb::parallel_for(tbb::blocked_range<size_t>(0, fixupPages.size(), 16), [&](const tbb::blocked_range<size_t>& range) {
+				for (size_t i = range.begin(); i != range.end(); ++i) {
+					ChainedFixupSegInfo& segInfo = _chainedFixupSegments[fixupPages[i].first];
+					uint32_t pageIndex = fixupPages[i].second;
+					uint8_t* pageBufferStart = &wholeBuffer[segInfo.fileOffset + (uint64_t)pageIndex * segInfo.pageSize];
+					this->chainFixupsOnPage(segInfo, pageBufferStart, pageIndex);
+				}
+			});
+
+			// pages whose 32-bit chain had to be broken get extra starts, allocated in page order
 			uint32_t segIndex = 0;
 			for (ChainedFixupSegInfo& segInfo : _chainedFixupSegments) {
-				//fprintf(stderr, "0x%08llX 0x%08llX %s\n", segInfo.startAddr, segInfo.endAddr-segInfo.startAddr, segInfo.name);
-				uint8_t* segBufferStart = &wholeBuffer[segInfo.fileOffset];
-				uint8_t* pageBufferStart = segBufferStart;
 				uint32_t pageIndex = 0;
 				uint32_t nextOverflowSlot = segInfo.pages.size();
 				for (ChainedFixupPageInfo& pageInfo : segInfo.pages) {
-					//fprintf(stderr, "   fixup count: %lu\n", pageInfo.fixupOffsets.size());
-					uint8_t* prevLoc = nullptr;
-					for (uint16_t pageOffset : pageInfo.fixupOffsets) {
-						uint8_t* loc = (uint8_t*)pageBufferStart + pageOffset;
-						//fprintf(stderr, "%p, pageOffset=0x%04X, bind=%d\n", loc, pageOffset, ((dyld_chained_ptr_64_rebase*)loc)->bind);
-						if ( prevLoc != nullptr ) {
-							uint64_t delta = (uint8_t*)loc - (uint8_t*)prevLoc;
-							switch ( segInfo.pointerFormat ) {
-								case DYLD_CHAINED_PTR_ARM64E:
-								case DYLD_CHAINED_PTR_ARM64E_USERLAND:
-								case DYLD_CHAINED_PTR_ARM64E_USERLAND24:
-									((dyld_chained_ptr_arm64e_rebase*)prevLoc)->next = delta/8;
-									assert((((dyld_chained_ptr_arm64e_rebase*)prevLoc)->next * 8) == delta && "next out of range");
-									break;
-								case DYLD_CHAINED_PTR_ARM64E_KERNEL:
-								case DYLD_CHAINED_PTR_ARM64E_FIRMWARE:
-									((dyld_chained_ptr_arm64e_rebase*)prevLoc)->next = delta/4;
-									assert((((dyld_chained_ptr_arm64e_rebase*)prevLoc)->next * 4) == delta && "next out of range");
-									break;
-								case DYLD_CHAINED_PTR_64:
-								case DYLD_CHAINED_PTR_64_OFFSET:
-									((dyld_chained_ptr_64_rebase*)prevLoc)->next = delta/4;
-									assert((((dyld_chained_ptr_64_rebase*)prevLoc)->next * 4) == delta && "next out of range");
-									break;
-								case DYLD_CHAINED_PTR_32:
-									chain32bitPointers((dyld_chained_ptr_32_rebase*)prevLoc, (dyld_chained_ptr_32_rebase*)loc,
-														segInfo, pageBufferStart, pageIndex);
-									break;
-								default:
-									assert(0 && "unknown pointer format");
-							}
-						}
-						prevLoc = loc;
-					}
 					if ( !pageInfo.chainOverflows.empty() ) {
 						uint8_t* chainHeader = NULL;
 						for (ld::Internal::FinalSection* sect : state.sections) {
@@ -3605,7 +3705,6 @@ void OutputFile::writeAtoms(ld::Internal& state, uint8_t* wholeBuffer)
 						}
 						assert(nextOverflowSlot <= maxOverFlowCount);
 					}
-					pageBufferStart += segInfo.pageSize;
 					++pageIndex;
 				}
 				++segIndex;
@@ -3614,6 +3713,45 @@ void OutputFile::writeAtoms(ld::Internal& state, uint8_t* wholeBuffer)
 	}
 }
 
+void OutputFile::chainFixupsOnPage(ChainedFixupSegInfo& segInfo, uint8_t* pageBufferStart, uint32_t pageIndex)
+{
+	ChainedFixupPageInfo& pageInfo = segInfo.pages[pageIndex];
+	//fprintf(stderr, "   fixup count: %lu\n", pageInfo.fixupOffsets.size());
+	uint8_t* prevLoc = nullptr;
+	for (uint16_t pageOffset : pageInfo.fixupOffsets) {
+		uint8_t* loc = (uint8_t*)pageBufferStart + pageOffset;
+		//fprintf(stderr, "%p, pageOffset=0x%04X, bind=%d\n", loc, pageOffset, ((dyld_chained_ptr_64_rebase*)loc)->bind);
+		if ( prevLoc != nullptr ) {
+			uint64_t delta = (uint8_t*)loc - (uint8_t*)prevLoc;
+			switch ( segInfo.pointerFormat ) {
+				case DYLD_CHAINED_PTR_ARM64E:
+				case DYLD_CHAINED_PTR_ARM64E_USERLAND:
+				case DYLD_CHAINED_PTR_ARM64E_USERLAND24:
+					((dyld_chained_ptr_arm64e_rebase*)prevLoc)->next = delta/8;
+					assert((((dyld_chained_ptr_arm64e_rebase*)prevLoc)->next * 8) == delta && "next out of range");
+					break;
+				case DYLD_CHAINED_PTR_ARM64E_KERNEL:
+				case DYLD_CHAINED_PTR_ARM64E_FIRMWARE:
+					((dyld_chained_ptr_arm64e_rebase*)prevLoc)->next = delta/4;
+					assert((((dyld_chained_ptr_arm64e_rebase*)prevLoc)->next * 4) == delta && "next out of range");
+					break;
+				case DYLD_CHAINED_PTR_64:
+				case DYLD_CHAINED_PTR_64_OFFSET:
+					((dyld_chained_ptr_64_rebase*)prevLoc)->next = delta/4;
+					assert((((dyld_chained_ptr_64_rebase*)prevLoc)->next * 4) == delta && "next out of range");
+					break;
+				case DYLD_CHAINED_PTR_32:
+					chain32bitPointers((dyld_chained_ptr_32_rebase*)prevLoc, (dyld_chained_ptr_32_rebase*)loc,
+										segInfo, pageBufferStart, pageIndex);
+					break;
+				default:
+					assert(0 && "unknown pointer format");
+			}
+		}
+		prevLoc = loc;
+	}
+}
+
 
 
 
@@ -3698,6 +3836,46 @@ void OutputFile::chain32bitPointers(dyld_chained_ptr_32_rebase* prevLoc, dyld_ch
 }
 
 
+// Hashes the content, the given regions of buffer laid end to end, as fixed size chunks on all
+// cores, then hashes prefix, the content size and the chunk digests in order.  Chunks are cut
+// from the content rather than the file, so the result only depends on the bytes hashed.
+static void treeHashContent(const uint8_t* buffer, const std::string& prefix,
+							const std::vector<std::pair<uint64_t, uint64_t>>& regions, uint8_t digest[CC_MD5_DIGEST_LENGTH])
+{
+	const uint64_t kChunkSize = 1024 * 1024;
+	std::vector<uint64_t> contentOffsets;
+	uint64_t contentSize = 0;
+	for (const auto& region : regions) {
+		contentOffsets.push_back(contentSize);
+		contentSize += region.second - region.first;
+	}
+	const size_t chunkCount = (size_t)((contentSize + kChunkSize - 1) / kChunkSize);
+	std::vector<uint8_t> chunkDigests(chunkCount * CC_MD5_DIGEST_LENGTH);
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, chunkCount, 1), [&](const tbb::blocked_range<size_t>& range) {
+		for (size_t chunk = range.begin(); chunk != range.end(); ++chunk) {
+			const uint64_t chunkStart = chunk * kChunkSize;
+			const uint64_t chunkEnd = std::min(chunkStart + kChunkSize, contentSize);
+			CC_MD5_CTX md5state;
+			CC_MD5_Init(&md5state);
+			size_t r = (std::upper_bound(contentOffsets.begin(), contentOffsets.end(), chunkStart) - contentOffsets.begin()) - 1;
+			for ( ; (r < regions.size()) && (contentOffsets[r] < chunkEnd); ++r) {
+				const uint64_t regionEnd = contentOffsets[r] + (regions[r].second - regions[r].first);
+				const uint64_t start = std::max(chunkStart, contentOffsets[r]);
+				const uint64_t end = std::min(chunkEnd, regionEnd);
+				if ( start < end )
+					CC_MD5_Update(&md5state, &buffer[regions[r].first + (start - contentOffsets[r])], (CC_LONG)(end - start));
+			}
+			CC_MD5_Final(&chunkDigests[chunk * CC_MD5_DIGEST_LENGTH], &md5state);
+		}
+	});
+	CC_MD5_CTX md5state;
+	CC_MD5_Init(&md5state);
+	CC_MD5_Update(&md5state, prefix.data(), (CC_LONG)prefix.size());
+	CC_MD5_Update(&md5state, &contentSize, sizeof(contentSize));
+	CC_MD5_Update(&md5state, chunkDigests.data(), (CC_LONG)chunkDigests.size());
+	CC_MD5_Final(digest, &md5state);
+}
+
 void OutputFile::computeContentUUID(ld::Internal& state, uint8_t* wholeBuffer)
 {
 	const bool log = false;
@@ -3770,18 +3948,19 @@ void OutputFile::computeContentUUID(ld::Internal& state, uint8_t* wholeBuffer)
 			excludeRegions.emplace_back(std::pair<uint64_t, uint64_t>(symbolTableCmdOffset, symbolTableCmdOffset+symbolTableCmdSize));
 			if ( log ) fprintf(stderr, "linkedit SegCmdOffset=0x%08llX, size=0x%08llX\n", symbolTableCmdOffset, symbolTableCmdSize);
 		}
+		// the parts of the file that contribute to the UUID, and what is hashed ahead of them
+		std::string prefix;
+		std::vector<std::pair<uint64_t, uint64_t>> hashRegions;
 		if ( !excludeRegions.empty() ) {
-			CC_MD5_CTX md5state;
-			CC_MD5_Init(&md5state);
 			// rdar://problem/19487042 include the output leaf file name in the hash
 			const char* lastSlash = strrchr(_options.outputFilePath(), '/');
 			if ( lastSlash !=  NULL ) {
-				CC_MD5_Update(&md5state, lastSlash, strlen(lastSlash));
+				prefix.append(lastSlash);
 			}
 			// <rdar://problem/38679559> use train name when calculating a binary's UUID
 			const char* buildName = _options.buildContextName();
 			if ( buildName != NULL ) {
-				CC_MD5_Update(&md5state, buildName, strlen(buildName));
+				prefix.append(buildName);
 			}
 			std::sort(excludeRegions.begin(), excludeRegions.end());
 			uint64_t checksumStart = 0;
@@ -3790,29 +3969,49 @@ void OutputFile::computeContentUUID(ld::Internal& state, uint8_t* wholeBuffer)
 				uint64_t regionEnd = region.second;
 				assert(checksumStart <= regionStart && regionStart <= regionEnd && "Region overlapped");
 				if ( log ) fprintf(stderr, "checksum 0x%08llX -> 0x%08llX\n", checksumStart, regionStart);
-				CC_MD5_Update(&md5state, &wholeBuffer[checksumStart], regionStart - checksumStart);
+				hashRegions.emplace_back(checksumStart, regionStart);
 				checksumStart = regionEnd;
 			}
 			if ( checksumStart < _fileSize ) {
 			if ( log ) fprintf(stderr, "checksum 0x%08llX -> 0x%08llX\n", checksumStart, _fileSize);
-			CC_MD5_Update(&md5state, &wholeBuffer[checksumStart], _fileSize-checksumStart);
+			hashRegions.emplace_back(checksumStart, _fileSize);
 			}
-			CC_MD5_Final(digest, &md5state);
-			if ( log ) fprintf(stderr, "uuid=%02X, %02X, %02X, %02X, %02X, %02X, %02X, %02X\n", digest[0], digest[1], digest[2],
-							   digest[3], digest[4], digest[5], digest[6],  digest[7]);
 		}
 		else {
-			CC_MD5(wholeBuffer, _fileSize, digest);
+			hashRegions.emplace_back(0, _fileSize);
+		}
+		if ( _options.treeHashUUID() ) {
+			treeHashContent(wholeBuffer, prefix, hashRegions, digest);
 		}
+		else {
+			CC_MD5_CTX md5state;
+			CC_MD5_Init(&md5state);
+			CC_MD5_Update(&md5state, prefix.data(), prefix.size());
+			for ( auto& region : hashRegions )
+				CC_MD5_Update(&md5state, &wholeBuffer[region.first], region.second - region.first);
+			CC_MD5_Final(digest, &md5state);
+		}
+		if ( log ) fprintf(stderr, "uuid=%02X, %02X, %02X, %02X, %02X, %02X, %02X, %02X\n", digest[0], digest[1], digest[2],
+						   digest[3], digest[4], digest[5], digest[6],  digest[7]);
 		// <rdar://problem/6723729> LC_UUID uuids should conform to RFC 4122 UUID version 4 & UUID version 5 formats
 		digest[6] = ( digest[6] & 0x0F ) | ( 3 << 4 );
 		digest[8] = ( digest[8] & 0x3F ) | 0x80;
 		// update buffer with new UUID
 		_headersAndLoadCommandAtom->setUUID(digest);
 		_headersAndLoadCommandAtom->recopyUUIDCommand();
+		for (ld::Internal::FinalSection* sect : state.sections) {
+			if ( sect->type() == ld::Section::typeMachHeader )
+				invalidateCodeSignaturePages(sect->fileOffset, sect->size);
+		}
 	}
 }
 
+void OutputFile::invalidateCodeSignaturePages(uint64_t fileOffset, uint64_t size)
+{
+	if ( _hasCodeSignature )
+		_codeSignatureAtom->invalidatePages(fileOffset, size);
+}
+
 static int sDescriptorOfPathToRemove = -1;
 static void removePathAndExit(int sig)
 {
@@ -3826,6 +4025,42 @@ static void removePathAndExit(int sig)
 	_exit(1);
 }
 	
+// writes to every page of a freshly mapped file, so the page faults are taken in parallel
+// instead of one at a time as atoms are copied in
+void OutputFile::prefaultBuffer(uint8_t* buffer, uint64_t size)
+{
+	const uint64_t pageSize = 4096;
+	const uint64_t blockSize = 1024*1024;
+	tbb::parallel_for(tbb::blocked_range<uint64_t>(0, (size + blockSize - 1) / blockSize, 1), [&](const tbb::blocked_range<uint64_t>& range) {
+		for (uint64_t block = range.begin(); block != range.end(); ++block) {
+			const uint64_t end = std::min(size, (block + 1) * blockSize);
+			for (uint64_t offset = block * blockSize; offset < end; offset += pageSize)
+				((volatile uint8_t*)buffer)[offset] = 0;
+		}
+	});
+}
+
+// writes the whole output buffer to fd with concurrent pwrite()s of fixed size blocks
+void OutputFile::writeBufferInParallel(int fd, const uint8_t* buffer, uint64_t size)
+{
+	const uint64_t blockSize = 8*1024*1024;
+	tbb::parallel_for(tbb::blocked_range<uint64_t>(0, (size + blockSize - 1) / blockSize, 1), [&](const tbb::blocked_range<uint64_t>& range) {
+		for (uint64_t block = range.begin(); block != range.end(); ++block) {
+			uint64_t offset = block * blockSize;
+			const uint64_t end = std::min(size, offset + blockSize);
+			while ( offset < end ) {
+				ssize_t bytesWritten = ::pwrite(fd, &buffer[offset], end - offset, offset);
+				if ( bytesWritten == -1 ) {
+					if ( errno == EINTR )
+						continue;
+					throwf("can't write to output file: %s, errno=%d", _options.outputFilePath(), errno);
+				}
+				offset += bytesWritten;
+			}
+		}
+	});
+}
+
 void OutputFile::writeOutputFile(ld::Internal& state)
 {
 	// for UNIX conformance, error if file exists and is not writable
@@ -3842,24 +4077,22 @@ void OutputFile::writeOutputFile(ld::Internal& state)
 	// It also handles the case where __options.outputFilePath() file is not writable but its directory is
 	// And it means we don't have to truncate the file when done writing (in case new is smaller than old)
 	// Lastly, only delete existing file if it is a normal file (e.g. not /dev/null).
+	// Regular files are built in a temporary file next to the output and moved into place when
+	// complete.  On hfs and apfs the move is a clonefile(), which avoids an odd signing bug with
+	// mmap'ed output, elsewhere it is a rename().
 	struct stat stat_buf;
 	bool outputIsRegularFile = false;
-	bool outputIsMappableFile = false;
+	bool outputIsClonableFile = false;
 	if ( stat(_options.outputFilePath(), &stat_buf) != -1 ) {
 		if (stat_buf.st_mode & S_IFREG) {
 			outputIsRegularFile = true;
-			// <rdar://problem/12264302> Don't use mmap on non-hfs volumes
 			struct statfs fsInfo;
 			if ( statfs(_options.outputFilePath(), &fsInfo) != -1 ) {
-                                // Avoid mmap due to odd signing bug
 				if ( (strcmp(fsInfo.f_fstypename, "hfs") == 0) || (strcmp(fsInfo.f_fstypename, "apfs") == 0) ) {
 					(void)unlink(_options.outputFilePath());
-					outputIsMappableFile = true;
+					outputIsClonableFile = true;
 				}
 			}
-			else {
-				outputIsMappableFile = false;
-			}
 		} 
 		else {
 			outputIsRegularFile = false;
@@ -3876,22 +4109,22 @@ void OutputFile::writeOutputFile(ld::Internal& state)
 			end[1] = '\0';
 			struct statfs fsInfo;
 			if ( statfs(dirPath, &fsInfo) != -1 ) {
-                                // Avoid mmap due to odd signing bug
 				if ( (strcmp(fsInfo.f_fstypename, "hfs") == 0) || (strcmp(fsInfo.f_fstypename, "apfs") == 0) ) {
-					outputIsMappableFile = true;
+					outputIsClonableFile = true;
 				}
 			}
 		}
 	}
 	
-	//fprintf(stderr, "outputIsMappableFile=%d, outputIsRegularFile=%d, path=%s\n", outputIsMappableFile, outputIsRegularFile, _options.outputFilePath());
+	//fprintf(stderr, "outputIsClonableFile=%d, outputIsRegularFile=%d, path=%s\n", outputIsClonableFile, outputIsRegularFile, _options.outputFilePath());
 	
 	int fd;
 	// Construct a temporary path of the form {outputFilePath}.ld_XXXXXX
 	const char filenameTemplate[] = ".ld_XXXXXX";
 	char tmpOutput[PATH_MAX];
 	uint8_t *wholeBuffer;
-	if ( outputIsRegularFile && outputIsMappableFile ) {
+	bool outputIsMapped = false;
+	if ( outputIsRegularFile ) {
 		// <rdar://problem/20959031> ld64 should clean up temporary files on SIGINT
 		::signal(SIGINT, removePathAndExit);
 
@@ -3918,14 +4151,22 @@ void OutputFile::writeOutputFile(ld::Internal& state)
 		}
 		
 		wholeBuffer = (uint8_t *)mmap(NULL, _fileSize, PROT_WRITE|PROT_READ, MAP_SHARED, fd, 0);
-		if ( wholeBuffer == MAP_FAILED )
-			throwf("can't create buffer of %llu bytes for output", _fileSize);
+		if ( wholeBuffer != MAP_FAILED ) {
+			outputIsMapped = true;
+			if ( _options.prefaultOutput() )
+				prefaultBuffer(wholeBuffer, _fileSize);
+		}
+		else {
+			// some file systems cannot map files, so build the output in memory and pwrite() it
+			wholeBuffer = (uint8_t*)calloc(_fileSize, 1);
+			if ( wholeBuffer == NULL ) {
+				unlink(tmpOutput);
+				throwf("can't create buffer of %llu bytes for output", _fileSize);
+			}
+		}
 	} 
 	else {
-		if ( outputIsRegularFile )
-			fd = open(_options.outputFilePath(),  O_RDWR|O_CREAT, permissions);
-		else
-			fd = open(_options.outputFilePath(),  O_WRONLY);
+		fd = open(_options.outputFilePath(),  O_WRONLY);
 		if ( fd == -1 ) 
 			throwf("can't open output file for writing: %s, errno=%d", _options.outputFilePath(), errno);
 		// try to allocate buffer for entire output file content
@@ -3943,25 +4184,58 @@ void OutputFile::writeOutputFile(ld::Internal& state)
 	writeAtoms(state, wholeBuffer);
 	
 	// compute UUID 
-	if ( _options.UUIDMode() == Options::kUUIDContent )
+	if ( _options.UUIDMode() == Options::kUUIDContent ) {
+		ld::TraceEvents::Span span("content UUID", "output");
+		span.counter("bytes", _fileSize);
 		computeContentUUID(state, wholeBuffer);
+	}
 
-	// now that file output buffer is complete, if codesigned, compute each page's hash
-	if ( _hasCodeSignature )
+	// now that file output buffer is complete, if codesigned, compute the hash of each page not
+	// already hashed while it was written
+	if ( _hasCodeSignature ) {
+		ld::TraceEvents::Span span("code signature", "output");
+		span.counter("bytes", _fileSize);
 		_codeSignatureAtom->hash(wholeBuffer);
+	}
 
-	if ( outputIsRegularFile && outputIsMappableFile ) {
+	if ( outputIsRegularFile ) {
+		if ( !outputIsMapped ) {
+			try {
+				writeBufferInParallel(fd, wholeBuffer, _fileSize);
+			}
+			catch (...) {
+				unlink(tmpOutput);
+				throw;
+			}
+			::free(wholeBuffer);
+		}
+		sDescriptorOfPathToRemove = -1;
 		::close(fd);
 		if ( ::chmod(tmpOutput, permissions) == -1 ) {
 			unlink(tmpOutput);
 			throwf("can't set permissions on output file: %s, errno=%d", tmpOutput, errno);
 		}
-		// For whatever reason, clonefile seems to fix the signing issue
-		if ( ::clonefile(tmpOutput, _options.outputFilePath(), 0) == -1 && strcmp(tmpOutput, _options.outputFilePath()) != 0) {
+		if ( strcmp(tmpOutput, _options.outputFilePath()) == 0 ) {
+			// path was too long for a temporary name, output was written in place
+		}
+		else if ( outputIsClonableFile ) {
+			// For whatever reason, clonefile seems to fix the signing issue
+			if ( ::clonefile(tmpOutput, _options.outputFilePath(), 0) == -1 ) {
+				unlink(tmpOutput);
+				throwf("can't move output file in place, errno=%d", errno);
+			}
 			unlink(tmpOutput);
-			throwf("can't move output file in place, errno=%d", errno);
 		}
-		unlink(tmpOutput);
+		else {
+			// <rdar://problem/13118223> NFS: iOS incremental builds in Xcode 4.6 fail with codesign error
+			// NFS seems to pad the end of the file sometimes.  Calling trunc seems to correct it...
+			::truncate(tmpOutput, _fileSize);
+			if ( ::rename(tmpOutput, _options.outputFilePath()) == -1 ) {
+				int err = errno;
+				unlink(tmpOutput);
+				throwf("can't move output file in place, errno=%d", err);
+			}
+		}
 	} 
 	else {
 		int64_t bytesLeft = (int64_t)_fileSize;
@@ -3976,11 +4250,7 @@ void OutputFile::writeOutputFile(ld::Internal& state)
 			bytesLeft -= bytesWritten;
 			currentPosition += bytesWritten;
 		}
-		sDescriptorOfPathToRemove = -1;
 		::close(fd);
-		// <rdar://problem/13118223> NFS: iOS incremental builds in Xcode 4.6 fail with codesign error
-		// NFS seems to pad the end of the file sometimes.  Calling trunc seems to correct it...
-		::truncate(_options.outputFilePath(), _fileSize);
 	}
 
 	// Rename symbol map file if needed
@@ -5117,162 +5387,242 @@ uint64_t OutputFile::lookBackAddend(ld::Fixup::iterator fit)
 
 void OutputFile::generateLinkEditInfo(ld::Internal& state)
 {
+	// split the atoms of each section into chunks of about the same number of fixups
+	const size_t fixupsPerChunk = 4096;
+	std::vector<LinkEditInfoChunk> chunks;
 	for (std::vector<ld::Internal::FinalSection*>::iterator sit = state.sections.begin(); sit != state.sections.end(); ++sit) {
 		ld::Internal::FinalSection* sect = *sit;
 		// record end of last __TEXT section encrypted iPhoneOS apps.
 		if ( _options.makeEncryptable() && (strcmp(sect->segmentName(), "__TEXT") == 0) && (strcmp(sect->sectionName(), "__oslogstring") != 0) ) {
 			_encryptedTEXTendOffset = pageAlign(sect->fileOffset + sect->size);
 		}
-		for (std::vector<const ld::Atom*>::iterator ait = sect->atoms.begin(); ait != sect->atoms.end(); ++ait) {
-			const ld::Atom*		atom = *ait;
-			
-			// Record regular atoms that override a dylib's weak definitions 
-			if ( (atom->scope() == ld::Atom::scopeGlobal) && atom->overridesDylibsWeakDef() ) {
-				if ( _options.makeCompressedDyldInfo() && !state.cantUseChainedFixups ) {
-					uint8_t wtype = BIND_TYPE_OVERRIDE_OF_WEAKDEF_IN_DYLIB;
-					bool nonWeakDef = (atom->combine() == ld::Atom::combineNever);
-					// Don't push weak binding info for threaded bind.
-					// Instead we use a special ordinal in the regular bind info
-					if ( !_options.useLinkedListBinding() )
-						_weakBindingInfo.push_back(BindingInfo(wtype, atom->name(), nonWeakDef, atom->finalAddress(), 0));
+		size_t fixupCount = fixupsPerChunk;
+		for (size_t atomIndex = 0; atomIndex < sect->atoms.size(); ++atomIndex) {
+			if ( fixupCount >= fixupsPerChunk ) {
+				if ( !chunks.empty() && (chunks.back().sect == sect) )
+					chunks.back().atomEnd = atomIndex;
+				chunks.emplace_back();
+				chunks.back().sect      = sect;
+				chunks.back().atomStart = atomIndex;
+				chunks.back().atomEnd   = sect->atoms.size();
+				fixupCount = 0;
+			}
+			const ld::Atom* atom = sect->atoms[atomIndex];
+			fixupCount += 1 + (atom->fixupsEnd() - atom->fixupsBegin());
+		}
+	}
+
+	// section and classic relocations are appended to the relocation atoms as they are found, so
+	// only chained fixups, threaded rebases and compressed dyld info are collected in parallel
+	const bool inOrder = (_options.outputKind() == Options::kObjectFile)
+						|| !((_options.makeChainedFixups() && !state.cantUseChainedFixups) || _options.makeCompressedDyldInfo()
+							 || state.cantUseChainedFixups || _options.makeThreadedStartsSection());
+	if ( inOrder ) {
+		for (LinkEditInfoChunk& chunk : chunks)
+			this->generateLinkEditInfo(state, chunk);
+	}
+	else {
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, chunks.size(), 1), [&](const tbb::blocked_range<size_t>& range) {
+			for (size_t i = range.begin(); i != range.end(); ++i) {
+				LinkEditInfoChunk& chunk = chunks[i];
+				WarningCapture capture(&chunk.warnings);
+				try {
+					this->generateLinkEditInfo(state, chunk);
+				}
+				catch (const char* msg) {
+					chunk.error = msg;
 				}
-				this->overridesWeakExternalSymbols = true;
-				if ( _options.warnWeakExports()	)
-					warning("overrides weak external symbol: %s", atom->name());
 			}
-			
-			ld::Fixup*			fixupWithTarget = NULL;
-			ld::Fixup*			fixupWithMinusTarget = NULL;
-			ld::Fixup*			fixupWithStore = NULL;
-			ld::Fixup*			fixupWithAddend = NULL;
-			const ld::Atom*		target = NULL;
-			const ld::Atom*		minusTarget = NULL;
-			uint64_t			targetAddend = 0;
-			uint64_t			minusTargetAddend = 0;
+		});
+	}
+
+	// merge the chunks in atom order, so the info, warnings and error are the same as if the atoms were walked on one thread
+	for (const LinkEditInfoChunk& chunk : chunks) {
+		for (const std::string& message : chunk.warnings)
+			warning("%s", message.c_str());
+		if ( chunk.error != NULL )
+			throw chunk.error;
+	}
+	size_t rebaseCount = _rebaseInfo.size();
+	size_t bindingCount = _bindingInfo.size();
+	for (const LinkEditInfoChunk& chunk : chunks) {
+		rebaseCount += chunk.rebaseInfo.size();
+		bindingCount += chunk.bindingInfo.size();
+	}
+	_rebaseInfo.reserve(rebaseCount);
+	_bindingInfo.reserve(bindingCount);
+	for (LinkEditInfoChunk& chunk : chunks) {
+		for (const std::pair<const ld::Atom*, const ld::Atom*>& textReloc : chunk.textRelocs)
+			this->noteTextReloc(textReloc.first, textReloc.second);
+		if ( chunk.hasLocalRelocs )
+			chunk.sect->hasLocalRelocs = true;  // so dyld knows to change permissions on __TEXT segment
+		if ( chunk.hasExternalRelocs )
+			chunk.sect->hasExternalRelocs = true;
+		if ( chunk.hasUnalignedFixup )
+			_hasUnalignedFixup = true;
+		if ( chunk.hasDataInCode )
+			this->hasDataInCode = true;
+		if ( chunk.overridesWeakExternalSymbols )
+			this->overridesWeakExternalSymbols = true;
+		_rebaseInfo.insert(_rebaseInfo.end(), chunk.rebaseInfo.begin(), chunk.rebaseInfo.end());
+		_bindingInfo.insert(_bindingInfo.end(), chunk.bindingInfo.begin(), chunk.bindingInfo.end());
+		_lazyBindingInfo.insert(_lazyBindingInfo.end(), chunk.lazyBindingInfo.begin(), chunk.lazyBindingInfo.end());
+		_weakBindingInfo.insert(_weakBindingInfo.end(), chunk.weakBindingInfo.begin(), chunk.weakBindingInfo.end());
+	}
+	if ( _hasUnalignedFixup && (_options.unalignedPointerTreatment() == Options::kUnalignedPointerError) ) {
+		throw "unaligned pointer(s)";
+	}
+}
+
+void OutputFile::generateLinkEditInfo(ld::Internal& state, LinkEditInfoChunk& chunk)
+{
+	ld::Internal::FinalSection* sect = chunk.sect;
+	for (size_t atomIndex = chunk.atomStart; atomIndex < chunk.atomEnd; ++atomIndex) {
+		const ld::Atom*		atom = sect->atoms[atomIndex];
+		
+		// Record regular atoms that override a dylib's weak definitions 
+		if ( (atom->scope() == ld::Atom::scopeGlobal) && atom->overridesDylibsWeakDef() ) {
+			if ( _options.makeCompressedDyldInfo() && !state.cantUseChainedFixups ) {
+				uint8_t wtype = BIND_TYPE_OVERRIDE_OF_WEAKDEF_IN_DYLIB;
+				bool nonWeakDef = (atom->combine() == ld::Atom::combineNever);
+				// Don't push weak binding info for threaded bind.
+				// Instead we use a special ordinal in the regular bind info
+				if ( !_options.useLinkedListBinding() )
+					chunk.weakBindingInfo.push_back(BindingInfo(wtype, atom->name(), nonWeakDef, atom->finalAddress(), 0));
+			}
+			chunk.overridesWeakExternalSymbols = true;
+			if ( _options.warnWeakExports()	)
+				warning("overrides weak external symbol: %s", atom->name());
+		}
+		
+		ld::Fixup*			fixupWithTarget = NULL;
+		ld::Fixup*			fixupWithMinusTarget = NULL;
+		ld::Fixup*			fixupWithStore = NULL;
+		ld::Fixup*			fixupWithAddend = NULL;
+		const ld::Atom*		target = NULL;
+		const ld::Atom*		minusTarget = NULL;
+		uint64_t			targetAddend = 0;
+		uint64_t			minusTargetAddend = 0;
 #if SUPPORT_ARCH_arm64e
-			ld::Fixup*			fixupWithAuthData = NULL;
+		ld::Fixup*			fixupWithAuthData = NULL;
 #endif
-			for (ld::Fixup::iterator fit = atom->fixupsBegin(); fit != atom->fixupsEnd(); ++fit) {
-				if ( fit->firstInCluster() ) {
-					fixupWithTarget = NULL;
-					fixupWithMinusTarget = NULL;
-					fixupWithStore = NULL;
-					target = NULL;
-					minusTarget = NULL;
-					targetAddend = 0;
-					minusTargetAddend = 0;
+		for (ld::Fixup::iterator fit = atom->fixupsBegin(); fit != atom->fixupsEnd(); ++fit) {
+			if ( fit->firstInCluster() ) {
+				fixupWithTarget = NULL;
+				fixupWithMinusTarget = NULL;
+				fixupWithStore = NULL;
+				target = NULL;
+				minusTarget = NULL;
+				targetAddend = 0;
+				minusTargetAddend = 0;
 #if SUPPORT_ARCH_arm64e
-					fixupWithAuthData = NULL;
+				fixupWithAuthData = NULL;
 #endif
+			}
+			if ( this->setsTarget(*fit) ) {
+				switch ( fit->binding ) {
+					case ld::Fixup::bindingNone:
+					case ld::Fixup::bindingByNameUnbound:
+						break;
+					case ld::Fixup::bindingByContentBound:
+					case ld::Fixup::bindingDirectlyBound:
+						fixupWithTarget = fit;
+						target = fit->u.target;
+						break;
+					case ld::Fixup::bindingsIndirectlyBound:
+						fixupWithTarget = fit;
+						target = state.indirectBindingTable[fit->u.bindingIndex];
+						break;
 				}
-				if ( this->setsTarget(*fit) ) {
+				assert(target != NULL);
+			}
+			switch ( fit->kind ) {
+				case ld::Fixup::kindAddAddend:
+					targetAddend = fit->u.addend;
+					fixupWithAddend = fit;
+					break;
+				case ld::Fixup::kindSubtractAddend:
+					minusTargetAddend = fit->u.addend;
+					fixupWithAddend = fit;
+					break;
+				case ld::Fixup::kindSubtractTargetAddress:
 					switch ( fit->binding ) {
 						case ld::Fixup::bindingNone:
 						case ld::Fixup::bindingByNameUnbound:
 							break;
 						case ld::Fixup::bindingByContentBound:
 						case ld::Fixup::bindingDirectlyBound:
-							fixupWithTarget = fit;
-							target = fit->u.target;
+							fixupWithMinusTarget = fit;
+							minusTarget = fit->u.target;
 							break;
 						case ld::Fixup::bindingsIndirectlyBound:
-							fixupWithTarget = fit;
-							target = state.indirectBindingTable[fit->u.bindingIndex];
+							fixupWithMinusTarget = fit;
+							minusTarget = state.indirectBindingTable[fit->u.bindingIndex];
 							break;
 					}
-					assert(target != NULL);
-				}
-				switch ( fit->kind ) {
-					case ld::Fixup::kindAddAddend:
-						targetAddend = fit->u.addend;
-						fixupWithAddend = fit;
-						break;
-					case ld::Fixup::kindSubtractAddend:
-						minusTargetAddend = fit->u.addend;
-						fixupWithAddend = fit;
-						break;
-					case ld::Fixup::kindSubtractTargetAddress:
-						switch ( fit->binding ) {
-							case ld::Fixup::bindingNone:
-							case ld::Fixup::bindingByNameUnbound:
-								break;
-							case ld::Fixup::bindingByContentBound:
-							case ld::Fixup::bindingDirectlyBound:
-								fixupWithMinusTarget = fit;
-								minusTarget = fit->u.target;
-								break;
-							case ld::Fixup::bindingsIndirectlyBound:
-								fixupWithMinusTarget = fit;
-								minusTarget = state.indirectBindingTable[fit->u.bindingIndex];
-								break;
-						}
-						assert(minusTarget != NULL);
-						break;
-					case ld::Fixup::kindDataInCodeStartData:
-					case ld::Fixup::kindDataInCodeStartJT8:
-					case ld::Fixup::kindDataInCodeStartJT16:
-					case ld::Fixup::kindDataInCodeStartJT32:
-					case ld::Fixup::kindDataInCodeStartJTA32:
-					case ld::Fixup::kindDataInCodeEnd:
-						hasDataInCode = true;
-						break;
+					assert(minusTarget != NULL);
+					break;
+				case ld::Fixup::kindDataInCodeStartData:
+				case ld::Fixup::kindDataInCodeStartJT8:
+				case ld::Fixup::kindDataInCodeStartJT16:
+				case ld::Fixup::kindDataInCodeStartJT32:
+				case ld::Fixup::kindDataInCodeStartJTA32:
+				case ld::Fixup::kindDataInCodeEnd:
+					chunk.hasDataInCode = true;
+					break;
 #if SUPPORT_ARCH_arm64e
-					case ld::Fixup::kindSetAuthData:
-						fixupWithAuthData = fit;
-						break;
+				case ld::Fixup::kindSetAuthData:
+					fixupWithAuthData = fit;
+					break;
 #endif
-					default:
+				default:
                         break;    
-				}
-				if ( fit->isStore() ) {
-					fixupWithStore = fit;
-				}
-				if ( fit->lastInCluster() ) {
-					if ( (fixupWithStore != NULL) && (target != NULL) ) {
-						if ( _options.outputKind() == Options::kObjectFile ) {
-							this->addSectionRelocs(state, sect, atom, fixupWithTarget, fixupWithMinusTarget, fixupWithAddend, fixupWithStore,
+			}
+			if ( fit->isStore() ) {
+				fixupWithStore = fit;
+			}
+			if ( fit->lastInCluster() ) {
+				if ( (fixupWithStore != NULL) && (target != NULL) ) {
+					if ( _options.outputKind() == Options::kObjectFile ) {
+						this->addSectionRelocs(state, sect, atom, fixupWithTarget, fixupWithMinusTarget, fixupWithAddend, fixupWithStore,
 #if SUPPORT_ARCH_arm64e
-												   fixupWithAuthData,
+											   fixupWithAuthData,
 #endif
+												target, minusTarget, targetAddend, minusTargetAddend);
+					}
+					else {
+						if ( _options.makeChainedFixups() && !state.cantUseChainedFixups ) {
+							addChainedFixupLocation(state, sect, atom, fixupWithTarget, fixupWithMinusTarget, fixupWithStore,
 													target, minusTarget, targetAddend, minusTargetAddend);
 						}
-						else {
-							if ( _options.makeChainedFixups() && !state.cantUseChainedFixups ) {
-								addChainedFixupLocation(state, sect, atom, fixupWithTarget, fixupWithMinusTarget, fixupWithStore,
-														target, minusTarget, targetAddend, minusTargetAddend);
-							}
-							else if ( _options.makeCompressedDyldInfo() || state.cantUseChainedFixups ) {
+						else if ( _options.makeCompressedDyldInfo() || state.cantUseChainedFixups ) {
 #if SUPPORT_ARCH_arm64e
-								if ( _options.sharedRegionEligible() && (fixupWithAuthData != NULL) ) {
-									switch ( fixupWithAuthData->u.authData.key ) {
-										case ld::Fixup::AuthData::ptrauth_key_asib:
-										case ld::Fixup::AuthData::ptrauth_key_asdb:
-											throwf("dylibs for dyld cache cannot use B key of auth-pointer, found in %s", atom->name());
-										case ld::Fixup::AuthData::ptrauth_key_asia:
-										case ld::Fixup::AuthData::ptrauth_key_asda:
-											break;
-									}
+							if ( _options.sharedRegionEligible() && (fixupWithAuthData != NULL) ) {
+								switch ( fixupWithAuthData->u.authData.key ) {
+									case ld::Fixup::AuthData::ptrauth_key_asib:
+									case ld::Fixup::AuthData::ptrauth_key_asdb:
+										throwf("dylibs for dyld cache cannot use B key of auth-pointer, found in %s", atom->name());
+									case ld::Fixup::AuthData::ptrauth_key_asia:
+									case ld::Fixup::AuthData::ptrauth_key_asda:
+										break;
 								}
-#endif
-								this->addDyldInfo(state, sect, atom, fixupWithTarget, fixupWithMinusTarget, fixupWithStore,
-												  target, minusTarget, targetAddend, minusTargetAddend);
-							}
-							else if ( _options.makeThreadedStartsSection() ) {
-								this->addThreadedRebaseInfo(state, sect, atom, fixupWithTarget, fixupWithMinusTarget, fixupWithStore,
-															target, minusTarget, targetAddend, minusTargetAddend);
-							}
-							else { 
-								this->addClassicRelocs(state, sect, atom, fixupWithTarget, fixupWithMinusTarget, fixupWithStore,
-													target, minusTarget, targetAddend, minusTargetAddend);
 							}
+#endif
+							this->addDyldInfo(state, sect, atom, fixupWithTarget, fixupWithMinusTarget, fixupWithStore,
+											  target, minusTarget, targetAddend, minusTargetAddend, chunk);
+						}
+						else if ( _options.makeThreadedStartsSection() ) {
+							this->addThreadedRebaseInfo(state, sect, atom, fixupWithTarget, fixupWithMinusTarget, fixupWithStore,
+														target, minusTarget, targetAddend, minusTargetAddend, chunk);
+						}
+						else { 
+							this->addClassicRelocs(state, sect, atom, fixupWithTarget, fixupWithMinusTarget, fixupWithStore,
+												target, minusTarget, targetAddend, minusTargetAddend);
 						}
-					}
 					}
 				}
 			}
 		}
-	if ( _hasUnalignedFixup && (_options.unalignedPointerTreatment() == Options::kUnalignedPointerError) ) {
-		throw "unaligned pointer(s)";
 	}
 }
 
@@ -5356,6 +5706,7 @@ void OutputFile::buildChainedFixupInfo(ld::Internal& state)
 	const char* 						curSegName   = "";
 	const ld::Internal::FinalSection* 	firstSegSect = nullptr;
 	const ld::Internal::FinalSection* 	lastSect     = nullptr;
+	std::vector<uint32_t>				sectSegIndexes;
 	for (ld::Internal::FinalSection* sect : state.sections) {
 		if ( strcmp(sect->segmentName(), curSegName) != 0 ) {
 			if ( firstSegSect != nullptr ) {
@@ -5373,165 +5724,227 @@ void OutputFile::buildChainedFixupInfo(ld::Internal& state)
 			seg.pointerFormat = chainedPointerFormat();
 			_chainedFixupSegments.push_back(seg);
 		}
-		for (const ld::Atom* atom : sect->atoms) {
-			const ld::Atom* target;
-			const ld::Atom* fromTarget;
-			bool hadSubtract;
-			uint64_t accumulator;
-			bool isBind = false;
-			bool isAuthPtr = false;
-			for (ld::Fixup::iterator fit = atom->fixupsBegin(), end=atom->fixupsEnd(); fit != end; ++fit) {
-				if ( fit->firstInCluster() ) {
-					accumulator = 0;
-					target = NULL;
-					hadSubtract = false;
-					isBind = false;
-					isAuthPtr = false;
-				}
-				if ( this->setsTarget(*fit) ) {
-					switch ( fit->binding ) {
-						case ld::Fixup::bindingNone:
-						case ld::Fixup::bindingByNameUnbound:
-							break;
-						case ld::Fixup::bindingByContentBound:
-							target = fit->u.target;
-							break;
-						case ld::Fixup::bindingDirectlyBound:
-							target = fit->u.target;
-							if ( target->isAlias() && (target->definition() == ld::Atom::definitionProxy) ) {
-								// <rdar://problem/13828711> if target is an import alias, use base of alias
-								for (ld::Fixup::iterator tfit = target->fixupsBegin(), end=target->fixupsEnd(); tfit != end; ++tfit) {
-									if ( tfit->firstInCluster() && (tfit->kind == ld::Fixup::kindNoneFollowOn) && (tfit->binding == ld::Fixup::bindingDirectlyBound) ) {
-										//fprintf(stderr, "switching import of %s to import of %s\n", target->name(),  tfit->u.target->name());
-										fit->u.target = tfit->u.target;
-										target = fit->u.target;
+		sectSegIndexes.push_back(_chainedFixupSegments.size() - 1);
+		lastSect = sect;
+	}
+
+	// split the atoms of each section into chunks of about the same number of fixups, each chunk
+	// records its fixup locations and bind targets in atom order so that merging the chunks in
+	// order gives the same pages and bind ordinals as a single walk over all atoms
+	struct UnalignedFixup {
+		uint64_t						address;
+		const ld::Atom*					atom;
+		uint32_t						offsetInAtom;
+	};
+	struct BindTarget {
+		const ld::Atom*					atom;
+		bool							authPtr;
+		uint64_t						addend;
+	};
+	struct FixupChunk {
+		const ld::Internal::FinalSection*	sect;
+		uint32_t							segIndex;
+		size_t								atomStart;
+		size_t								atomEnd;
+		std::vector<uint64_t>				fixupAddrs;
+		std::vector<BindTarget>				binds;
+		std::vector<UnalignedFixup>			unalignedFixups;
+	};
+	const size_t fixupsPerChunk = 4096;
+	std::vector<FixupChunk> chunks;
+	for (size_t sectIndex = 0; sectIndex < state.sections.size(); ++sectIndex) {
+		const ld::Internal::FinalSection* sect = state.sections[sectIndex];
+		size_t fixupCount = fixupsPerChunk;
+		for (size_t atomIndex = 0; atomIndex < sect->atoms.size(); ++atomIndex) {
+			if ( fixupCount >= fixupsPerChunk ) {
+				if ( !chunks.empty() && (chunks.back().sect == sect) )
+					chunks.back().atomEnd = atomIndex;
+				FixupChunk chunk;
+				chunk.sect      = sect;
+				chunk.segIndex  = sectSegIndexes[sectIndex];
+				chunk.atomStart = atomIndex;
+				chunk.atomEnd   = sect->atoms.size();
+				chunks.push_back(std::move(chunk));
+				fixupCount = 0;
+			}
+			const ld::Atom* atom = sect->atoms[atomIndex];
+			fixupCount += 1 + (atom->fixupsEnd() - atom->fixupsBegin());
+		}
+	}
+
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, chunks.size(), 1), [&](const tbb::blocked_range<size_t>& range) {
+		for (size_t chunkIndex = range.begin(); chunkIndex != range.end(); ++chunkIndex) {
+			FixupChunk& chunk = chunks[chunkIndex];
+			const uint32_t pointerFormat = _chainedFixupSegments[chunk.segIndex].pointerFormat;
+			for (size_t atomIndex = chunk.atomStart; atomIndex < chunk.atomEnd; ++atomIndex) {
+				const ld::Atom* atom = chunk.sect->atoms[atomIndex];
+				const ld::Atom* target;
+				const ld::Atom* fromTarget;
+				bool hadSubtract;
+				uint64_t accumulator;
+				bool isBind = false;
+				bool isAuthPtr = false;
+				for (ld::Fixup::iterator fit = atom->fixupsBegin(), end=atom->fixupsEnd(); fit != end; ++fit) {
+					if ( fit->firstInCluster() ) {
+						accumulator = 0;
+						target = NULL;
+						hadSubtract = false;
+						isBind = false;
+						isAuthPtr = false;
+					}
+					if ( this->setsTarget(*fit) ) {
+						switch ( fit->binding ) {
+							case ld::Fixup::bindingNone:
+							case ld::Fixup::bindingByNameUnbound:
+								break;
+							case ld::Fixup::bindingByContentBound:
+								target = fit->u.target;
+								break;
+							case ld::Fixup::bindingDirectlyBound:
+								target = fit->u.target;
+								if ( target->isAlias() && (target->definition() == ld::Atom::definitionProxy) ) {
+									// <rdar://problem/13828711> if target is an import alias, use base of alias
+									for (ld::Fixup::iterator tfit = target->fixupsBegin(), end=target->fixupsEnd(); tfit != end; ++tfit) {
+										if ( tfit->firstInCluster() && (tfit->kind == ld::Fixup::kindNoneFollowOn) && (tfit->binding == ld::Fixup::bindingDirectlyBound) ) {
+											//fprintf(stderr, "switching import of %s to import of %s\n", target->name(),  tfit->u.target->name());
+											fit->u.target = tfit->u.target;
+											target = fit->u.target;
+										}
 									}
 								}
-							}
+								break;
+							case ld::Fixup::bindingsIndirectlyBound:
+								target = state.indirectBindingTable[fit->u.bindingIndex];
+								break;
+						}
+						assert(target != NULL);
+					}
+					switch ( fit->kind ) {
+						case ld::Fixup::kindSetTargetAddress:
+							accumulator = addressOf(state, fit, &target);
+							if ( targetIsThumb(state, fit) )
+								accumulator |= 1;
+							if ( fit->contentAddendOnly || fit->contentDetlaToAddendOnly )
+								accumulator = 0;
 							break;
-						case ld::Fixup::bindingsIndirectlyBound:
-							target = state.indirectBindingTable[fit->u.bindingIndex];
+						case ld::Fixup::kindSubtractTargetAddress:
+							accumulator -= addressOf(state, fit, &fromTarget);
+							hadSubtract = true;
+							break;
+						case ld::Fixup::kindAddAddend:
+							accumulator += fit->u.addend;
+							break;
+						case ld::Fixup::kindSubtractAddend:
+							accumulator -= fit->u.addend;
+							break;
+						case ld::Fixup::kindSetTargetImageOffset:
+							hadSubtract = true;
+							break;
+						case ld::Fixup::kindStoreLittleEndian32:
+						case ld::Fixup::kindStoreLittleEndian64:
+							isBind = true;
+							break;
+						case ld::Fixup::kindStoreTargetAddressLittleEndian32:
+							accumulator = addressOf(state, fit, &target);
+							if ( targetIsThumb(state, fit) )
+								accumulator |= 1;
+							if ( fit->contentAddendOnly )
+								accumulator = 0;
+							isBind = true;
+							break;
+						case ld::Fixup::kindStoreTargetAddressLittleEndian64:
+							accumulator = addressOf(state, fit, &target);
+							if ( fit->contentAddendOnly )
+								accumulator = 0;
+							isBind = true;
 							break;
-					}
-					assert(target != NULL);
-				}
-				switch ( fit->kind ) {
-					case ld::Fixup::kindSetTargetAddress:
-						accumulator = addressOf(state, fit, &target);
-						if ( targetIsThumb(state, fit) )
-							accumulator |= 1;
-						if ( fit->contentAddendOnly || fit->contentDetlaToAddendOnly )
-							accumulator = 0;
-						break;
-					case ld::Fixup::kindSubtractTargetAddress:
-                        accumulator -= addressOf(state, fit, &fromTarget);
-						hadSubtract = true;
-						break;
-                    case ld::Fixup::kindAddAddend:
-						accumulator += fit->u.addend;
-						break;
-                    case ld::Fixup::kindSubtractAddend:
-						accumulator -= fit->u.addend;
-						break;
-                    case ld::Fixup::kindSetTargetImageOffset:
-                        hadSubtract = true;
-                        break;
-					case ld::Fixup::kindStoreLittleEndian32:
-					case ld::Fixup::kindStoreLittleEndian64:
-						isBind = true;
-						break;
-					case ld::Fixup::kindStoreTargetAddressLittleEndian32:
-						accumulator = addressOf(state, fit, &target);
-						if ( targetIsThumb(state, fit) )
-							accumulator |= 1;
-						if ( fit->contentAddendOnly )
-							accumulator = 0;
-						isBind = true;
-						break;
-					case ld::Fixup::kindStoreTargetAddressLittleEndian64:
-						accumulator = addressOf(state, fit, &target);
-						if ( fit->contentAddendOnly )
-							accumulator = 0;
-						isBind = true;
-						break;
 #if SUPPORT_ARCH_arm64e
-					case ld::Fixup::kindStoreLittleEndianAuth64:
-						if ( fit->contentAddendOnly ) {
-							// ld -r mode.  We want to write out the original relocation again
+						case ld::Fixup::kindStoreLittleEndianAuth64:
+							if ( fit->contentAddendOnly ) {
+								// ld -r mode.  We want to write out the original relocation again
+								break;
+							}
+							isBind = true;
+							break;
+						case ld::Fixup::kindStoreTargetAddressLittleEndianAuth64:
+							accumulator = addressOf(state, fit, &target);
+							if ( fit->contentAddendOnly )
+								accumulator = 0;
+							isBind = true;
+							break;
+						case ld::Fixup::kindSetAuthData:
+							isAuthPtr = true;
 							break;
-						}
-						isBind = true;
-						break;
-					case ld::Fixup::kindStoreTargetAddressLittleEndianAuth64:
-						accumulator = addressOf(state, fit, &target);
-						if ( fit->contentAddendOnly )
-							accumulator = 0;
-						isBind = true;
-						break;
-					case ld::Fixup::kindSetAuthData:
-						isAuthPtr = true;
-						break;
 #endif
-					default:
-						break;
-				}
-				if ( fit->lastInCluster() && isBind ) {
-					// this is an absolute pointer which means it needs to be in fixup chain
-					if ( (target != NULL) && !hadSubtract ) {
-						uint64_t fixUpAddr = atom->finalAddress() + fit->offsetInAtom;
-						//fprintf(stderr, "fixUpAddr=0x%0llX\n",fixUpAddr);
-
-						// Diagnose unaligned pointers
-						switch (_chainedFixupSegments.back().pointerFormat) {
-							case DYLD_CHAINED_PTR_ARM64E:
-							case DYLD_CHAINED_PTR_ARM64E_USERLAND:
-							case DYLD_CHAINED_PTR_ARM64E_USERLAND24:
-								if ( fixUpAddr % 8 ) {
-									warning("pointer not aligned at address 0x%llX (%s + %u from %s)",
-											fixUpAddr, atom->name(), fit->offsetInAtom, atom->safeFilePath());
-									_hasUnalignedFixup = true;
-								}
-								break;
-							case DYLD_CHAINED_PTR_ARM64E_KERNEL:
-							case DYLD_CHAINED_PTR_64:
-							case DYLD_CHAINED_PTR_64_OFFSET:
-							case DYLD_CHAINED_PTR_ARM64E_FIRMWARE:
-							case DYLD_CHAINED_PTR_32:
-							case DYLD_CHAINED_PTR_32_FIRMWARE:
-								if ( fixUpAddr % 4 ) {
-									warning("pointer not aligned at address 0x%llX (%s + %u from %s)",
-										   fixUpAddr, atom->name(), fit->offsetInAtom, atom->safeFilePath());
-									_hasUnalignedFixup = true;
-								}
-								break;
-							default:
-								assert(0 && "unknown pointer format");
-						}
-
-						unsigned pageIndex = (fixUpAddr - _chainedFixupSegments.back().startAddr)/pageSize;
-						while ( pageIndex >= _chainedFixupSegments.back().pages.size() ) {
-							ChainedFixupPageInfo emptyPage;
-							_chainedFixupSegments.back().pages.push_back(emptyPage);
+						default:
+							break;
+					}
+					if ( fit->lastInCluster() && isBind ) {
+						// this is an absolute pointer which means it needs to be in fixup chain
+						if ( (target != NULL) && !hadSubtract ) {
+							uint64_t fixUpAddr = atom->finalAddress() + fit->offsetInAtom;
+							//fprintf(stderr, "fixUpAddr=0x%0llX\n",fixUpAddr);
+
+							// Diagnose unaligned pointers
+							switch (pointerFormat) {
+								case DYLD_CHAINED_PTR_ARM64E:
+								case DYLD_CHAINED_PTR_ARM64E_USERLAND:
+								case DYLD_CHAINED_PTR_ARM64E_USERLAND24:
+									if ( fixUpAddr % 8 )
+										chunk.unalignedFixups.push_back({ fixUpAddr, atom, fit->offsetInAtom });
+									break;
+								case DYLD_CHAINED_PTR_ARM64E_KERNEL:
+								case DYLD_CHAINED_PTR_64:
+								case DYLD_CHAINED_PTR_64_OFFSET:
+								case DYLD_CHAINED_PTR_ARM64E_FIRMWARE:
+								case DYLD_CHAINED_PTR_32:
+								case DYLD_CHAINED_PTR_32_FIRMWARE:
+									if ( fixUpAddr % 4 )
+										chunk.unalignedFixups.push_back({ fixUpAddr, atom, fit->offsetInAtom });
+									break;
+								default:
+									assert(0 && "unknown pointer format");
+							}
+							chunk.fixupAddrs.push_back(fixUpAddr);
+							// build map for binds
+							if ( needsBind(target, isAuthPtr, &accumulator) )
+								chunk.binds.push_back({ target, isAuthPtr, accumulator });
 						}
-						uint16_t pageOffset = fixUpAddr - (_chainedFixupSegments.back().startAddr + pageIndex*pageSize);
-						_chainedFixupSegments.back().pages[pageIndex].fixupOffsets.push_back(pageOffset);
-						// build map for binds
-						if ( needsBind(target, isAuthPtr, &accumulator) )
-							_chainedFixupBinds.ensureTarget(target, isAuthPtr, accumulator);
 					}
 				}
 			}
 		}
-		lastSect = sect;
+	});
+
+	// merge chunks in atom order, so warnings and bind ordinals come out as from a serial walk
+	for (FixupChunk& chunk : chunks) {
+		for (const UnalignedFixup& unaligned : chunk.unalignedFixups) {
+			warning("pointer not aligned at address 0x%llX (%s + %u from %s)",
+					unaligned.address, unaligned.atom->name(), unaligned.offsetInAtom, unaligned.atom->safeFilePath());
+			_hasUnalignedFixup = true;
+		}
+		ChainedFixupSegInfo& segInfo = _chainedFixupSegments[chunk.segIndex];
+		for (uint64_t fixUpAddr : chunk.fixupAddrs) {
+			unsigned pageIndex = (fixUpAddr - segInfo.startAddr)/pageSize;
+			if ( pageIndex >= segInfo.pages.size() )
+				segInfo.pages.resize(pageIndex+1);
+			uint16_t pageOffset = fixUpAddr - (segInfo.startAddr + pageIndex*pageSize);
+			segInfo.pages[pageIndex].fixupOffsets.push_back(pageOffset);
+		}
+		for (const BindTarget& bind : chunk.binds)
+			_chainedFixupBinds.ensureTarget(bind.atom, bind.authPtr, bind.addend);
 	}
 	if ( _hasUnalignedFixup )
 		throw "unaligned pointer(s)";
 
 	// sort all fixups on each page, so chain can be built
 	for (ChainedFixupSegInfo& segInfo : _chainedFixupSegments) {
-		for (ChainedFixupPageInfo& pageInfo : segInfo.pages) {
-			std::sort(pageInfo.fixupOffsets.begin(), pageInfo.fixupOffsets.end());
-		}
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, segInfo.pages.size(), 16), [&](const tbb::blocked_range<size_t>& range) {
+			for (size_t pageIndex = range.begin(); pageIndex != range.end(); ++pageIndex) {
+				std::vector<uint16_t>& fixupOffsets = segInfo.pages[pageIndex].fixupOffsets;
+				std::sort(fixupOffsets.begin(), fixupOffsets.end());
+			}
+		});
 	}
 	// remember largest legal rebase target
 	uint64_t baseAddress = 0;
@@ -5596,7 +6009,7 @@ void OutputFile::noteTextReloc(const ld::Atom* atom, const ld::Atom* target)
 void OutputFile::addDyldInfo(ld::Internal& state,  ld::Internal::FinalSection* sect, const ld::Atom* atom,  
 								ld::Fixup* fixupWithTarget, ld::Fixup* fixupWithMinusTarget, ld::Fixup* fixupWithStore,
 								const ld::Atom* target, const ld::Atom* minusTarget, 
-								uint64_t targetAddend, uint64_t minusTargetAddend)
+								uint64_t targetAddend, uint64_t minusTargetAddend, LinkEditInfoChunk& chunk)
 {
 	if ( sect->isSectionHidden() )
 		return;
@@ -5798,8 +6211,8 @@ void OutputFile::addDyldInfo(ld::Internal& state,  ld::Internal::FinalSection* s
 	// record dyld info for this cluster
 	if ( needsRebase ) {
 		if ( inReadOnlySeg ) {
-			noteTextReloc(atom, target);
-			sect->hasLocalRelocs = true;  // so dyld knows to change permissions on __TEXT segment
+			chunk.textRelocs.push_back(std::make_pair(atom, target));
+			chunk.hasLocalRelocs = true;  // so dyld knows to change permissions on __TEXT segment
 			rebaseType = REBASE_TYPE_TEXT_ABSOLUTE32;
 		}
 		if ( _options.sharedRegionEligible() ) {
@@ -5832,9 +6245,9 @@ void OutputFile::addDyldInfo(ld::Internal& state,  ld::Internal::FinalSection* s
 					warning("pointer not aligned at address 0x%llX (%s + %lld from %s)",
 							address, atom->name(), (address - atom->finalAddress()), atom->safeFilePath());
 			}
-			_hasUnalignedFixup = true;
+			chunk.hasUnalignedFixup = true;
 		}
-		_rebaseInfo.push_back(RebaseInfo(rebaseType, address));
+		chunk.rebaseInfo.push_back(RebaseInfo(rebaseType, address));
 	}
 
 	if ( (needsBinding || needsWeakBinding) && _options.sharedRegionEligible() && (addend > 31) )
@@ -5842,26 +6255,26 @@ void OutputFile::addDyldInfo(ld::Internal& state,  ld::Internal::FinalSection* s
 
 	if ( needsBinding ) {
 		if ( inReadOnlySeg ) {
-			noteTextReloc(atom, target);
-			sect->hasExternalRelocs = true; // so dyld knows to change permissions on __TEXT segment
+			chunk.textRelocs.push_back(std::make_pair(atom, target));
+			chunk.hasExternalRelocs = true; // so dyld knows to change permissions on __TEXT segment
 		}
 		if ( ((address & (pointerSize-1)) != 0) && (type == BIND_TYPE_POINTER) ) {
 			if ( _options.unalignedPointerTreatment() != Options::kUnalignedPointerIgnore ) {
 					warning("pointer not aligned at address 0x%llX (%s + %lld from %s)",
 							address, atom->name(), (address - atom->finalAddress()), atom->safeFilePath());
 			}
-			_hasUnalignedFixup = true;
+			chunk.hasUnalignedFixup = true;
 		}
-		_bindingInfo.push_back(BindingInfo(type, compressedOrdinal, target->name(), weak_import, address, addend));
+		chunk.bindingInfo.push_back(BindingInfo(type, compressedOrdinal, target->name(), weak_import, address, addend));
 	}
 	if ( needsLazyBinding ) {
 		if ( _options.bindAtLoad() )
-			_bindingInfo.push_back(BindingInfo(type, compressedOrdinal, target->name(), weak_import, address, addend));
+			chunk.bindingInfo.push_back(BindingInfo(type, compressedOrdinal, target->name(), weak_import, address, addend));
 		else
-			_lazyBindingInfo.push_back(BindingInfo(type, compressedOrdinal, target->name(), weak_import, address, addend));
+			chunk.lazyBindingInfo.push_back(BindingInfo(type, compressedOrdinal, target->name(), weak_import, address, addend));
 	}
 	if ( needsWeakBinding )
-		_weakBindingInfo.push_back(BindingInfo(type, 0, target->name(), false, address, addend));
+		chunk.weakBindingInfo.push_back(BindingInfo(type, 0, target->name(), false, address, addend));
 }
 
 
@@ -5942,7 +6355,7 @@ void OutputFile::addChainedFixupLocation(ld::Internal& state, ld::Internal::Fina
 void OutputFile::addThreadedRebaseInfo(ld::Internal& state,  ld::Internal::FinalSection* sect, const ld::Atom* atom,
 									   ld::Fixup* fixupWithTarget, ld::Fixup* fixupWithMinusTarget, ld::Fixup* fixupWithStore,
 									   const ld::Atom* target, const ld::Atom* minusTarget,
-									   uint64_t targetAddend, uint64_t minusTargetAddend)
+									   uint64_t targetAddend, uint64_t minusTargetAddend, LinkEditInfoChunk& chunk)
 {
 	if ( sect->isSectionHidden() )
 		return;
@@ -6038,14 +6451,14 @@ void OutputFile::addThreadedRebaseInfo(ld::Internal& state,  ld::Internal::Final
 	// record dyld info for this cluster
 	if ( needsRebase ) {
 		if ( inReadOnlySeg ) {
-			noteTextReloc(atom, target);
-			sect->hasLocalRelocs = true;  // so dyld knows to change permissions on __TEXT segment
+			chunk.textRelocs.push_back(std::make_pair(atom, target));
+			chunk.hasLocalRelocs = true;  // so dyld knows to change permissions on __TEXT segment
 		}
 		if ( ((address & (minAlignment-1)) != 0) ) {
 			throwf("pointer not aligned to at least 4-bytes at address 0x%llX (%s + %lld from %s)",
 				   address, atom->name(), (address - atom->finalAddress()), atom->safeFilePath());
 		}
-		_rebaseInfo.push_back(RebaseInfo(rebaseType, address));
+		chunk.rebaseInfo.push_back(RebaseInfo(rebaseType, address));
 	}
 }
 
@@ -41,6 +41,7 @@
 #include <dlfcn.h>
 #include <mach-o/dyld.h>
 
+#include <utility>
 #include <vector>
 
 #include "Options.h"
@@ -66,6 +67,9 @@ public:
 	uint32_t					encryptedTextEndOffset()	{ return _encryptedTEXTendOffset; }
 	int							compressedOrdinalForAtom(const ld::Atom* target) const;
 	uint64_t					fileSize() const { return _fileSize; }
+	// mach_absolute_time() spent in each LINKEDIT encoder, for -print_statistics
+	const std::vector<std::pair<const char*, uint64_t>>& linkEditEncodeTimes() const { return _linkEditEncodeTimes; }
+	const std::vector<uint64_t>& writeAtomsBusyTimes() const { return _writeAtomsBusyTimes; }
 	
 	bool						needsBind(const ld::Atom* toTarget, bool authPtr, uint64_t* accumulator = nullptr,
 										  uint64_t* inlineAddend = nullptr, uint32_t* bindOrdinal = nullptr,
@@ -189,14 +193,38 @@ private:
 		AtomOperation(const Atom *atom, uint64_t fileOffset, uint64_t fileOffsetOfEndOfLastAtom, uint64_t mhAddress, bool lastAtomUsesNoOps, bool lastAtomWasThumb): atom(atom), fileOffset(fileOffset), fileOffsetOfEndOfLastAtom(fileOffsetOfEndOfLastAtom), mhAddress(mhAddress), lastAtomUsesNoOps(lastAtomUsesNoOps), lastAtomWasThumb(lastAtomWasThumb) {}
 	};
 
+	// dyld info found in a run of a section's atoms, merged into the OutputFile in atom order
+	struct LinkEditInfoChunk {
+		ld::Internal::FinalSection*										sect;
+		size_t															atomStart;
+		size_t															atomEnd;
+		std::vector<RebaseInfo>											rebaseInfo;
+		std::vector<BindingInfo>										bindingInfo;
+		std::vector<BindingInfo>										lazyBindingInfo;
+		std::vector<BindingInfo>										weakBindingInfo;
+		std::vector<std::pair<const ld::Atom*, const ld::Atom*>>		textRelocs;
+		bool															hasLocalRelocs = false;
+		bool															hasExternalRelocs = false;
+		bool															hasUnalignedFixup = false;
+		bool															hasDataInCode = false;
+		bool															overridesWeakExternalSymbols = false;
+		// diagnostics from a worker thread, reported when the chunk is merged
+		std::vector<std::string>										warnings;
+		const char*														error = NULL;
+	};
+
 	void						writeAtoms(ld::Internal& state, uint8_t* wholeBuffer);
+	void						invalidateCodeSignaturePages(uint64_t fileOffset, uint64_t size);
 	void						computeContentUUID(ld::Internal& state, uint8_t* wholeBuffer);
+	void						prefaultBuffer(uint8_t* buffer, uint64_t size);
+	void						writeBufferInParallel(int fd, const uint8_t* buffer, uint64_t size);
 	void						buildDylibOrdinalMapping(ld::Internal&);
 	bool						hasOrdinalForInstallPath(const char* path, int* ordinal);
 	void						addLoadCommands(ld::Internal& state);
 	void						addLinkEdit(ld::Internal& state);
 	void						addPreloadLinkEdit(ld::Internal& state);
 	void						generateLinkEditInfo(ld::Internal& state);
+	void						generateLinkEditInfo(ld::Internal& state, LinkEditInfoChunk& chunk);
 	void						buildSymbolTable(ld::Internal& state);
 	void						writeOutputFile(ld::Internal& state);
 	void						addSectionRelocs(ld::Internal& state, ld::Internal::FinalSection* sect,  
@@ -212,12 +240,12 @@ private:
 												const ld::Atom* atom, ld::Fixup* fixupWithTarget,
 												ld::Fixup* fixupWithMinusTarget, ld::Fixup* fixupWithStore,
 												const ld::Atom* target, const ld::Atom* minusTarget, 
-												uint64_t targetAddend, uint64_t minusTargetAddend);
+												uint64_t targetAddend, uint64_t minusTargetAddend, LinkEditInfoChunk& chunk);
 	void						addThreadedRebaseInfo(ld::Internal& state, ld::Internal::FinalSection* sect,
 													  const ld::Atom* atom, ld::Fixup* fixupWithTarget,
 													  ld::Fixup* fixupWithMinusTarget, ld::Fixup* fixupWithStore,
 													  const ld::Atom* target, const ld::Atom* minusTarget,
-													  uint64_t targetAddend, uint64_t minusTargetAddend);
+													  uint64_t targetAddend, uint64_t minusTargetAddend, LinkEditInfoChunk& chunk);
 	void						addChainedFixupLocation(ld::Internal& state, ld::Internal::FinalSection* sect,
 													  const ld::Atom* atom, ld::Fixup* fixupWithTarget,
 													  ld::Fixup* fixupWithMinusTarget, ld::Fixup* fixupWithStore,
@@ -304,6 +332,7 @@ private:
 #endif
 	bool 						isFixupForChain(ld::Fixup::iterator fit);
 	uint16_t					chainedPointerFormat() const;
+	void						chainFixupsOnPage(ChainedFixupSegInfo& segInfo, uint8_t* pageBufferStart, uint32_t pageIndex);
 	void 						chain32bitPointers(dyld_chained_ptr_32_rebase* prevLoc, dyld_chained_ptr_32_rebase* loc,
 													ChainedFixupSegInfo& segInfo, uint8_t* pageBufferStart, uint32_t pageIndex);
 	dyld_chained_ptr_32_rebase* farthestChainableLocation(dyld_chained_ptr_32_rebase* start);
@@ -436,6 +465,8 @@ public:
 	class LinkEditAtom*						_optimizationHintsAtom;
 	class LinkEditAtom*						_chainedInfoAtom;
 	class CodeSignatureAtom*				_codeSignatureAtom;
+	std::vector<std::pair<const char*, uint64_t>> _linkEditEncodeTimes;
+	std::vector<uint64_t>					_writeAtomsBusyTimes;
 
 };
 
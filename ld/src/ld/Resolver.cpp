@@ -49,15 +49,24 @@
 #include <vector>
 #include <list>
 #include <algorithm>
+#include <mutex>
 #include <dlfcn.h>
 #include <AvailabilityMacros.h>
 
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_for_each.h>
+#include "pstl/execution"
+#include "pstl/algorithm"
+
 #include "Options.h"
 #include "ld.hpp"
 #include "Bitcode.hpp"
 #include "InputFiles.h"
 #include "SymbolTable.h"
 #include "Resolver.h"
+#include "TraceEvents.h"
 #include "parsers/lto_file.h"
 
 #include "configure.h"
@@ -311,9 +320,13 @@ void Resolver::initializeState()
 
 void Resolver::buildAtomList()
 {
-	// each input files contributes initial atoms
+	// each input files contributes initial atoms, which are added to the symbol table in bulk
+	// unless command line aliases need each atom's symbol to be known as it is added
 	_atoms.reserve(1024);
+	_addAtomsInBulk = !_options.haveCmdLineAliases();
 	_inputFiles.forEachInitialAtom(*this, _internal);
+	_addAtomsInBulk = false;
+	this->addPendingAtoms();
     
 	_completedInitialObjectFiles = true;
 	
@@ -367,6 +380,10 @@ void Resolver::doLinkerOption(const std::vector<const char*>& linkerOption, cons
 
 void Resolver::doFile(const ld::File& file)
 {
+	// commit deferred atoms now and then, so adding them overlaps with parsing the remaining files
+	if ( _pendingAtoms.size() >= 65536 )
+		this->addPendingAtoms();
+
 	const ld::relocatable::File* objFile = dynamic_cast<const ld::relocatable::File*>(&file);
 	const ld::dylib::File* dylibFile = dynamic_cast<const ld::dylib::File*>(&file);
 
@@ -753,37 +770,13 @@ void Resolver::doAtom(const ld::Atom& atom)
 		(const_cast<ld::Atom*>(&atom))->setSymbolTableInclusion(ld::Atom::symbolTableIn);
 
 
-	// tell symbol table about non-static atoms
-	if ( atom.scope() != ld::Atom::scopeTranslationUnit ) {
-		Options::Treatment duplicates = Options::Treatment::kError;
-		if (_options.deadCodeStrip() ) {
-			if ( _options.allowDeadDuplicates() )
-				duplicates = Options::Treatment::kSuppress;
-			else if ( _completedInitialObjectFiles )
-				duplicates = Options::Treatment::kWarning;
-		}
-		_symbolTable.add(atom, duplicates);
-		
-		// add symbol aliases defined on the command line
-		if ( _options.haveCmdLineAliases() ) {
-			const std::vector<Options::AliasPair>& aliases = _options.cmdLineAliases();
-			for (std::vector<Options::AliasPair>::const_iterator it=aliases.begin(); it != aliases.end(); ++it) {
-				if ( strcmp(it->realName, atom.name()) == 0 ) {
-					if ( strcmp(it->realName, it->alias) == 0 ) {
-						warning("ignoring alias of itself '%s'", it->realName);
-					}
-					else {
-						const AliasAtom* alias = new AliasAtom(atom, it->alias);
-						_aliasesFromCmdLine.push_back(alias);
-						this->doAtom(*alias);
-					}
-				}
-			}
-		}
+	if ( _addAtomsInBulk ) {
+		// addPendingAtoms() adds it to the symbol table and converts its references
+		_pendingAtoms.push_back(&atom);
+	}
+	else {
+		this->addToSymbolTable(atom);
 	}
-
-	// convert references by-name or by-content to by-slot
-	this->convertReferencesToIndirect(atom);
 	
 	// remember if any atoms are proxies that require LTO
 	if ( atom.contentType() == ld::Atom::typeLTOtemporary )
@@ -824,6 +817,112 @@ void Resolver::doAtom(const ld::Atom& atom)
 	}
 }
 
+Options::Treatment Resolver::duplicatesTreatment() const
+{
+	Options::Treatment duplicates = Options::Treatment::kError;
+	if (_options.deadCodeStrip() ) {
+		if ( _options.allowDeadDuplicates() )
+			duplicates = Options::Treatment::kSuppress;
+		else if ( _completedInitialObjectFiles )
+			duplicates = Options::Treatment::kWarning;
+	}
+	return duplicates;
+}
+
+void Resolver::addToSymbolTable(const ld::Atom& atom)
+{
+	// tell symbol table about non-static atoms
+	if ( atom.scope() != ld::Atom::scopeTranslationUnit ) {
+		_symbolTable.add(atom, this->duplicatesTreatment());
+		
+		// add symbol aliases defined on the command line
+		if ( _options.haveCmdLineAliases() ) {
+			const std::vector<Options::AliasPair>& aliases = _options.cmdLineAliases();
+			for (std::vector<Options::AliasPair>::const_iterator it=aliases.begin(); it != aliases.end(); ++it) {
+				if ( strcmp(it->realName, atom.name()) == 0 ) {
+					if ( strcmp(it->realName, it->alias) == 0 ) {
+						warning("ignoring alias of itself '%s'", it->realName);
+					}
+					else {
+						const AliasAtom* alias = new AliasAtom(atom, it->alias);
+						_aliasesFromCmdLine.push_back(alias);
+						this->doAtom(*alias);
+					}
+				}
+			}
+		}
+	}
+
+	// convert references by-name or by-content to by-slot
+	this->convertReferencesToIndirect(atom);
+	
+}
+
+void Resolver::addPendingAtoms()
+{
+	// Adds the atoms deferred by doAtom() to the symbol table.  Atoms combined by name and all by-name
+	// references go through the sharded by-name table concurrently.  Atoms combined by content or
+	// references, and references bound by content, are still added one at a time in input order,
+	// which is what decides which duplicate survives.
+	std::vector<const ld::Atom*> atoms;
+	atoms.swap(_pendingAtoms);
+	if ( atoms.size() < 4096 ) {
+		// too few to be worth fanning out
+		for (const ld::Atom* atom : atoms)
+			this->addToSymbolTable(*atom);
+		return;
+	}
+	const Options::Treatment duplicates = this->duplicatesTreatment();
+	const bool removeDtraceProbes = (_options.outputKind() != Options::kObjectFile);
+	std::vector<uint8_t> hasContentReferences(atoms.size());
+	std::atomic<bool> hasOptimizationHints(false);
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, atoms.size()), [&](const tbb::blocked_range<size_t>& range) {
+		bool rangeHasOptimizationHints = false;
+		for (size_t i=range.begin(); i != range.end(); ++i) {
+			const ld::Atom* atom = atoms[i];
+			for (ld::Fixup::iterator fit=atom->fixupsBegin(), end=atom->fixupsEnd(); fit != end; ++fit) {
+				if ( fit->kind == ld::Fixup::kindLinkerOptimizationHint )
+					rangeHasOptimizationHints = true;
+				switch ( fit->binding ) {
+					case ld::Fixup::bindingByNameUnbound:
+						// in final linked images, remove reference
+						if ( removeDtraceProbes && isDtraceProbe(fit->kind) )
+							fit->binding = ld::Fixup::bindingNone;
+						break;
+					case ld::Fixup::bindingByContentBound:
+						hasContentReferences[i] = true;
+						break;
+					default:
+						break;
+				}
+			}
+		}
+		if ( rangeHasOptimizationHints )
+			hasOptimizationHints = true;
+	});
+	if ( hasOptimizationHints )
+		_internal.someObjectHasOptimizationHints = true;
+
+	_symbolTable.addAtoms(atoms, duplicates);
+
+	for (size_t i=0; i < atoms.size(); ++i) {
+		const ld::Atom* atom = atoms[i];
+		if ( atom->scope() != ld::Atom::scopeTranslationUnit ) {
+			switch ( atom->combine() ) {
+				case ld::Atom::combineNever:
+				case ld::Atom::combineByName:
+					break;
+				case ld::Atom::combineByNameAndContent:
+				case ld::Atom::combineByNameAndReferences:
+					_symbolTable.add(*atom, duplicates);
+					break;
+			}
+		}
+		if ( hasContentReferences[i] )
+			this->convertReferencesToIndirect(*atom);
+	}
+}
+
 bool Resolver::isDtraceProbe(ld::Fixup::Kind kind)
 {
 	switch (kind) {
@@ -899,14 +998,38 @@ void Resolver::addInitialUndefines()
 	}
 }
 
+static void sortUniqueNames(std::vector<const char*>& names)
+{
+	// sort so that names are in a stable order (not dependent on hashing functions)
+	std::sort(names.begin(), names.end(), [](const char* left, const char* right) { return (strcmp(left, right) < 0); });
+	names.erase(std::unique(names.begin(), names.end(), CStringEquals()), names.end());
+}
+
 void Resolver::resolveUndefines()
 {
-	// keep looping until no more undefines were added in last loop
-	unsigned int undefineGenCount = 0xFFFFFFFF;
-	while ( undefineGenCount != _symbolTable.updateCount() ) {
-		undefineGenCount = _symbolTable.updateCount();
+	// keep looping until a round finds no new undefines or tentatives to search for.  The symbol table queues
+	// each name as it is first referenced, so a round only costs as much as the names added by the last one.
+	// Names that could not be found are searched again only if libraries have been added since.
+	bool firstRound = true;
+	size_t searchedGeneration = 0;
+	for (;;) {
+		const size_t generation = _inputFiles.searchLibrariesGeneration();
+		const bool retryUnresolved = firstRound || (generation != searchedGeneration);
+		firstRound = false;
+		searchedGeneration = generation;
+		ld::TraceEvents::Span round("resolver round", "resolve");
 		std::vector<const char*> undefineNames;
-		_symbolTable.undefines(undefineNames);
+		if ( retryUnresolved ) {
+			for (const char* name : _unresolvedUndefines) {
+				if ( _symbolTable.isUndefined(name) )
+					undefineNames.push_back(name);
+			}
+			_unresolvedUndefines.clear();
+		}
+		// adds the names referenced since the last round, then sorts and uniques them all
+		_symbolTable.newUndefines(undefineNames);
+		// parse the archive members this round will load in parallel, before loading them in order
+		_inputFiles.preParseArchiveMembers(undefineNames);
 		for(std::vector<const char*>::iterator it = undefineNames.begin(); it != undefineNames.end(); ++it) {
 			const char* undef = *it;
 			// load for previous undefine may also have loaded this undefine, so check again
@@ -946,34 +1069,48 @@ void Resolver::resolveUndefines()
 						}
 					}
 				}
+				if ( _symbolTable.isUndefined(undef) )
+					_unresolvedUndefines.push_back(undef);
 			}
 		}
 		// <rdar://problem/5894163> need to search archives for overrides of common symbols 
+		std::vector<const char*> tents;
 		if ( _symbolTable.hasExternalTentativeDefinitions() ) {
 			bool searchDylibs = (_options.commonsMode() == Options::kCommonsOverriddenByDylibs);
-			std::vector<const char*> tents;
-			_symbolTable.tentativeDefs(tents);
+			if ( retryUnresolved ) {
+				for (const char* name : _searchedTentativeDefs) {
+					if ( _symbolTable.isTentativeDef(name) )
+						tents.push_back(name);
+				}
+				_searchedTentativeDefs.clear();
+			}
+			_symbolTable.newTentativeDefs(tents);
 			for(std::vector<const char*>::iterator it = tents.begin(); it != tents.end(); ++it) {
 				// load for previous tentative may also have loaded this tentative, so check again
 				const ld::Atom* curAtom = _symbolTable.atomForSlot(_symbolTable.findSlotForName(*it));
 				assert(curAtom != NULL);
 				if ( curAtom->definition() == ld::Atom::definitionTentative ) {
 					_inputFiles.searchLibraries(*it, searchDylibs, true, true, *this);
+					_searchedTentativeDefs.push_back(*it);
 				}
 			}
 		}
+		round.counter("undefines", undefineNames.size());
+		round.counter("tentatives", tents.size());
+		round.counter("atoms", _atoms.size());
+		if ( undefineNames.empty() && tents.empty() )
+			break;
 	}
+	sortUniqueNames(_unresolvedUndefines);
 	
 	// Use linker options to resolve any remaining undefined symbols
 	if ( !_internal.linkerOptionLibraries.empty() || !_internal.linkerOptionFrameworks.empty() ) {
-		std::vector<const char*> undefineNames;
-		_symbolTable.undefines(undefineNames);
-		if ( undefineNames.size() != 0 ) {
-			for (std::vector<const char*>::iterator it = undefineNames.begin(); it != undefineNames.end(); ++it) {
-				const char* undef = *it;
-				if ( ! _symbolTable.hasName(undef) ) {
-					_inputFiles.searchLibraries(undef, true, true, false, *this);
-				}
+		// every name still unbound was queued and searched above, so _unresolvedUndefines is the complete list
+		std::vector<const char*> undefineNames = _unresolvedUndefines;
+		for (std::vector<const char*>::iterator it = undefineNames.begin(); it != undefineNames.end(); ++it) {
+			const char* undef = *it;
+			if ( _symbolTable.isUndefined(undef) ) {
+				_inputFiles.searchLibraries(undef, true, true, false, *this);
 			}
 		}
 	}
@@ -1013,128 +1150,277 @@ void Resolver::resolveUndefines()
 }
 
 
-void Resolver::markLive(const ld::Atom& atom, WhyLiveBackChain* previous)
+// references that keep their target alive when dead stripping
+static bool isLiveReference(ld::Fixup::Kind kind)
 {
-	//fprintf(stderr, "markLive(%p) %s\n", &atom, atom.name());
-	// if -why_live cares about this symbol, then dump chain
-	if ( (previous->referer != NULL) && _options.printWhyLive(atom.name()) ) {
-		fprintf(stderr, "%s from %s\n", atom.name(), atom.safeFilePath());
-		int depth = 1;
-		for(WhyLiveBackChain* p = previous; p != NULL; p = p->previous, ++depth) {
-			for(int i=depth; i > 0; --i)
-				fprintf(stderr, "  ");
-			fprintf(stderr, "%s from %s\n", p->referer->name(), p->referer->safeFilePath());
-		}
-	}
-	
-	// if already marked live, then done (stop recursion)
-	if ( atom.live() )
-		return;
-		
-	// mark this atom is live
-	(const_cast<ld::Atom*>(&atom))->setLive();
-	
-	// mark all atoms it references as live
-	WhyLiveBackChain thisChain;
-	thisChain.previous = previous;
-	thisChain.referer = &atom;
-	for (ld::Fixup::iterator fit = atom.fixupsBegin(), end=atom.fixupsEnd(); fit != end; ++fit) {
-		const ld::Atom* target;
-		switch ( fit->kind ) {
-			case ld::Fixup::kindNone:
-			case ld::Fixup::kindNoneFollowOn:
-			case ld::Fixup::kindNoneGroupSubordinate:
-			case ld::Fixup::kindNoneGroupSubordinateFDE:
-			case ld::Fixup::kindNoneGroupSubordinateLSDA:
-			case ld::Fixup::kindNoneGroupSubordinatePersonality:
-			case ld::Fixup::kindSetTargetAddress:
-			case ld::Fixup::kindSubtractTargetAddress:
-			case ld::Fixup::kindStoreTargetAddressLittleEndian32:
-			case ld::Fixup::kindStoreTargetAddressLittleEndian64:
+	switch ( kind ) {
+		case ld::Fixup::kindNone:
+		case ld::Fixup::kindNoneFollowOn:
+		case ld::Fixup::kindNoneGroupSubordinate:
+		case ld::Fixup::kindNoneGroupSubordinateFDE:
+		case ld::Fixup::kindNoneGroupSubordinateLSDA:
+		case ld::Fixup::kindNoneGroupSubordinatePersonality:
+		case ld::Fixup::kindSetTargetAddress:
+		case ld::Fixup::kindSubtractTargetAddress:
+		case ld::Fixup::kindStoreTargetAddressLittleEndian32:
+		case ld::Fixup::kindStoreTargetAddressLittleEndian64:
 #if SUPPORT_ARCH_arm64e
-			case ld::Fixup::kindStoreTargetAddressLittleEndianAuth64:
+		case ld::Fixup::kindStoreTargetAddressLittleEndianAuth64:
 #endif
-			case ld::Fixup::kindStoreTargetAddressBigEndian32:
-			case ld::Fixup::kindStoreTargetAddressBigEndian64:
-			case ld::Fixup::kindStoreTargetAddressX86PCRel32:
-			case ld::Fixup::kindStoreTargetAddressX86BranchPCRel32:
-			case ld::Fixup::kindStoreTargetAddressX86PCRel32GOTLoad:
-			case ld::Fixup::kindStoreTargetAddressX86PCRel32GOTLoadNowLEA:
-			case ld::Fixup::kindStoreTargetAddressX86PCRel32TLVLoad:
-			case ld::Fixup::kindStoreTargetAddressX86PCRel32TLVLoadNowLEA:
-			case ld::Fixup::kindStoreTargetAddressX86Abs32TLVLoad:
-			case ld::Fixup::kindStoreTargetAddressX86Abs32TLVLoadNowLEA:
-			case ld::Fixup::kindStoreTargetAddressARMBranch24:
-			case ld::Fixup::kindStoreTargetAddressThumbBranch22:
+		case ld::Fixup::kindStoreTargetAddressBigEndian32:
+		case ld::Fixup::kindStoreTargetAddressBigEndian64:
+		case ld::Fixup::kindStoreTargetAddressX86PCRel32:
+		case ld::Fixup::kindStoreTargetAddressX86BranchPCRel32:
+		case ld::Fixup::kindStoreTargetAddressX86PCRel32GOTLoad:
+		case ld::Fixup::kindStoreTargetAddressX86PCRel32GOTLoadNowLEA:
+		case ld::Fixup::kindStoreTargetAddressX86PCRel32TLVLoad:
+		case ld::Fixup::kindStoreTargetAddressX86PCRel32TLVLoadNowLEA:
+		case ld::Fixup::kindStoreTargetAddressX86Abs32TLVLoad:
+		case ld::Fixup::kindStoreTargetAddressX86Abs32TLVLoadNowLEA:
+		case ld::Fixup::kindStoreTargetAddressARMBranch24:
+		case ld::Fixup::kindStoreTargetAddressThumbBranch22:
 #if SUPPORT_ARCH_arm64
-			case ld::Fixup::kindStoreTargetAddressARM64Branch26:
-			case ld::Fixup::kindStoreTargetAddressARM64Page21:
-			case ld::Fixup::kindStoreTargetAddressARM64GOTLoadPage21:
-			case ld::Fixup::kindStoreTargetAddressARM64GOTLeaPage21:
-			case ld::Fixup::kindStoreTargetAddressARM64TLVPLoadPage21:
-			case ld::Fixup::kindStoreTargetAddressARM64TLVPLoadNowLeaPage21:
+		case ld::Fixup::kindStoreTargetAddressARM64Branch26:
+		case ld::Fixup::kindStoreTargetAddressARM64Page21:
+		case ld::Fixup::kindStoreTargetAddressARM64GOTLoadPage21:
+		case ld::Fixup::kindStoreTargetAddressARM64GOTLeaPage21:
+		case ld::Fixup::kindStoreTargetAddressARM64TLVPLoadPage21:
+		case ld::Fixup::kindStoreTargetAddressARM64TLVPLoadNowLeaPage21:
 #endif
-				if ( fit->binding == ld::Fixup::bindingByContentBound ) {
-					// normally this was done in convertReferencesToIndirect()
-					// but a archive loaded .o file may have a forward reference
-					SymbolTable::IndirectBindingSlot slot;
-					const ld::Atom* dummy;
-					switch ( fit->u.target->combine() ) {
-						case ld::Atom::combineNever:
-						case ld::Atom::combineByName:
-							assert(0 && "wrong combine type for bind by content");
-							break;
-						case ld::Atom::combineByNameAndContent:
-							slot = _symbolTable.findSlotForContent(fit->u.target, &dummy);
-							fit->binding = ld::Fixup::bindingsIndirectlyBound;
-							fit->u.bindingIndex = slot;
-							break;
-						case ld::Atom::combineByNameAndReferences:
-							slot = _symbolTable.findSlotForReferences(fit->u.target, &dummy);
-							fit->binding = ld::Fixup::bindingsIndirectlyBound;
-							fit->u.bindingIndex = slot;
-							break;
-					}
+			return true;
+		default:
+			return false;
+	}
+}
+
+const ld::Atom* Resolver::liveReferenceTarget(const ld::Atom& atom, ld::Fixup::iterator fit)
+{
+	const ld::Atom* target;
+	if ( fit->binding == ld::Fixup::bindingByContentBound ) {
+		// normally this was done in convertReferencesToIndirect()
+		// but a archive loaded .o file may have a forward reference
+		SymbolTable::IndirectBindingSlot slot;
+		const ld::Atom* dummy;
+		switch ( fit->u.target->combine() ) {
+			case ld::Atom::combineNever:
+			case ld::Atom::combineByName:
+				assert(0 && "wrong combine type for bind by content");
+				break;
+			case ld::Atom::combineByNameAndContent:
+				slot = _symbolTable.findSlotForContent(fit->u.target, &dummy);
+				fit->binding = ld::Fixup::bindingsIndirectlyBound;
+				fit->u.bindingIndex = slot;
+				break;
+			case ld::Atom::combineByNameAndReferences:
+				slot = _symbolTable.findSlotForReferences(fit->u.target, &dummy);
+				fit->binding = ld::Fixup::bindingsIndirectlyBound;
+				fit->u.bindingIndex = slot;
+				break;
+		}
+	}
+	switch ( fit->binding ) {
+		case ld::Fixup::bindingDirectlyBound:
+			return fit->u.target;
+		case ld::Fixup::bindingByNameUnbound:
+			// doAtom() did not convert to indirect in dead-strip mode, so that now
+			fit->u.bindingIndex = _symbolTable.findSlotForName(fit->u.name);
+			fit->binding = ld::Fixup::bindingsIndirectlyBound;
+			// fall into next case
+		case ld::Fixup::bindingsIndirectlyBound:
+			target = _internal.indirectBindingTable[fit->u.bindingIndex];
+			if ( target == NULL ) {
+				const char* targetName = _symbolTable.indirectName(fit->u.bindingIndex);
+				_inputFiles.searchLibraries(targetName, true, true, false, *this);
+				target = _internal.indirectBindingTable[fit->u.bindingIndex];
+			}
+			if ( target != NULL ) {
+				if ( target->definition() == ld::Atom::definitionTentative ) {
+					// <rdar://problem/5894163> need to search archives for overrides of common symbols 
+					bool searchDylibs = (_options.commonsMode() == Options::kCommonsOverriddenByDylibs);
+					_inputFiles.searchLibraries(target->name(), searchDylibs, true, true, *this);
+					// recompute target since it may have been overridden by searchLibraries()
+					target = _internal.indirectBindingTable[fit->u.bindingIndex];
 				}
+				return target;
+			}
+			_atomsWithUnresolvedReferences.push_back(&atom);
+			return NULL;
+		default:
+			assert(0 && "bad binding during dead stripping");
+	}
+	return NULL;
+}
+
+void Resolver::markLive(const ld::Atom& root, WhyLiveBackChain* rootChain)
+{
+	// Depth first in fixup order, exactly like a recursive walk, so -why_live prints the same chains.
+	// The stack is explicit so that long reference chains cannot overflow the thread stack.
+	struct Frame {
+		WhyLiveBackChain		chain;
+		ld::Fixup::iterator		fit;
+		ld::Fixup::iterator		end;
+	};
+	std::deque<Frame> stack;	// a deque so chain pointers into it stay valid as it grows
+	auto visit = [&](const ld::Atom& atom, WhyLiveBackChain* previous) {
+		//fprintf(stderr, "markLive(%p) %s\n", &atom, atom.name());
+		// if -why_live cares about this symbol, then dump chain
+		if ( (previous->referer != NULL) && _options.printWhyLive(atom.name()) ) {
+			fprintf(stderr, "%s from %s\n", atom.name(), atom.safeFilePath());
+			int depth = 1;
+			for(WhyLiveBackChain* p = previous; p != NULL; p = p->previous, ++depth) {
+				for(int i=depth; i > 0; --i)
+					fprintf(stderr, "  ");
+				fprintf(stderr, "%s from %s\n", p->referer->name(), p->referer->safeFilePath());
+			}
+		}
+		// if already marked live, then done
+		if ( atom.live() )
+			return;
+		// mark this atom is live, then all atoms it references
+		(const_cast<ld::Atom*>(&atom))->setLive();
+		Frame frame;
+		frame.chain.previous = previous;
+		frame.chain.referer = &atom;
+		frame.fit = atom.fixupsBegin();
+		frame.end = atom.fixupsEnd();
+		stack.push_back(frame);
+	};
+	visit(root, rootChain);
+	while ( !stack.empty() ) {
+		Frame& frame = stack.back();
+		if ( frame.fit == frame.end ) {
+			stack.pop_back();
+			continue;
+		}
+		ld::Fixup::iterator fit = frame.fit++;
+		if ( ! isLiveReference(fit->kind) )
+			continue;
+		const ld::Atom* target = this->liveReferenceTarget(*frame.chain.referer, fit);
+		if ( target != NULL )
+			visit(*target, &frame.chain);
+	}
+}
+
+static inline bool claimLive(std::atomic<bool>& claim)
+{
+	return !claim.load(std::memory_order_relaxed) && !claim.exchange(true);
+}
+
+uint32_t Resolver::liveSlot(const ld::Atom* atom)
+{
+	const auto pos = _liveSlots.find(atom);
+	if ( pos != _liveSlots.end() )
+		return pos->second;
+	const uint32_t slot = (uint32_t)_liveSlotAtoms.size();
+	_liveSlots[atom] = slot;
+	_liveSlotAtoms.push_back(atom);
+	// atoms already live start out claimed, so marking stops at them
+	_liveClaims.emplace_back(atom->live());
+	return slot;
+}
+
+void Resolver::indexAtomsForMarking()
+{
+	_liveSlots.reserve(_atoms.size());
+	for (size_t i=_liveIndexedAtomCount; i < _atoms.size(); ++i)
+		this->liveSlot(_atoms[i]);
+	_liveIndexedAtomCount = _atoms.size();
+}
+
+void Resolver::markLiveConcurrently(const std::vector<const ld::Atom*>& roots)
+{
+	// Marking is a work-stealing traversal over fixups.  Every atom has an atomic claim, and only the
+	// thread that claims an atom queues it, so each atom's fixups are scanned once.  A reference that
+	// still has to be bound in the symbol table, or whose target has to be searched for in libraries,
+	// cannot be followed concurrently.  Its atom is deferred and rescanned serially after the parallel
+	// round, in atom order so the libraries are searched deterministically, and any atoms that loads
+	// or reaches seed the next round.
+	this->indexAtomsForMarking();
+	std::vector<const ld::Atom*> worklist;
+	for (const ld::Atom* root : roots) {
+		if ( claimLive(_liveClaims[this->liveSlot(root)]) )
+			worklist.push_back(root);
+	}
+	tbb::enumerable_thread_specific<std::vector<const ld::Atom*>> marked;
+	while ( !worklist.empty() ) {
+		std::mutex deferredLock;
+		std::vector<uint32_t> deferred;
+		tbb::parallel_for_each(worklist.begin(), worklist.end(), [&](const ld::Atom* atom, tbb::feeder<const ld::Atom*>& feeder) {
+			marked.local().push_back(atom);
+			bool needsResolver = false;
+			for (ld::Fixup::iterator fit = atom->fixupsBegin(), end=atom->fixupsEnd(); fit != end; ++fit) {
+				if ( ! isLiveReference(fit->kind) )
+					continue;
+				const ld::Atom* target = NULL;
 				switch ( fit->binding ) {
 					case ld::Fixup::bindingDirectlyBound:
-						markLive(*(fit->u.target), &thisChain);
+						target = fit->u.target;
 						break;
-					case ld::Fixup::bindingByNameUnbound:
-						// doAtom() did not convert to indirect in dead-strip mode, so that now
-						fit->u.bindingIndex = _symbolTable.findSlotForName(fit->u.name);
-						fit->binding = ld::Fixup::bindingsIndirectlyBound;
-						// fall into next case
 					case ld::Fixup::bindingsIndirectlyBound:
 						target = _internal.indirectBindingTable[fit->u.bindingIndex];
-						if ( target == NULL ) {
-							const char* targetName = _symbolTable.indirectName(fit->u.bindingIndex);
-							_inputFiles.searchLibraries(targetName, true, true, false, *this);
-							target = _internal.indirectBindingTable[fit->u.bindingIndex];
-						}
-						if ( target != NULL ) {
-							if ( target->definition() == ld::Atom::definitionTentative ) {
-								// <rdar://problem/5894163> need to search archives for overrides of common symbols 
-								bool searchDylibs = (_options.commonsMode() == Options::kCommonsOverriddenByDylibs);
-								_inputFiles.searchLibraries(target->name(), searchDylibs, true, true, *this);
-								// recompute target since it may have been overridden by searchLibraries()
-								target = _internal.indirectBindingTable[fit->u.bindingIndex];
-							}
-							this->markLive(*target, &thisChain);
-						}
-						else {
-							_atomsWithUnresolvedReferences.push_back(&atom);
-						}
+						// a tentative definition may be overridden by an archive
+						if ( (target != NULL) && (target->definition() == ld::Atom::definitionTentative) )
+							target = NULL;
 						break;
 					default:
-						assert(0 && "bad binding during dead stripping");
+						break;
 				}
-				break;
-            default:
-                break;    
+				const auto pos = (target != NULL) ? _liveSlots.find(target) : _liveSlots.end();
+				if ( pos == _liveSlots.end() )
+					needsResolver = true;
+				else if ( claimLive(_liveClaims[pos->second]) )
+					feeder.add(target);
+			}
+			if ( needsResolver ) {
+				const uint32_t slot = _liveSlots.find(atom)->second;
+				std::lock_guard<std::mutex> lock(deferredLock);
+				deferred.push_back(slot);
+			}
+		});
+		worklist.clear();
+		const size_t firstNewSlot = _liveSlotAtoms.size();
+		std::sort(deferred.begin(), deferred.end());
+		for (uint32_t slot : deferred) {
+			const ld::Atom* atom = _liveSlotAtoms[slot];
+			for (ld::Fixup::iterator fit = atom->fixupsBegin(), end=atom->fixupsEnd(); fit != end; ++fit) {
+				if ( ! isLiveReference(fit->kind) )
+					continue;
+				const ld::Atom* target = this->liveReferenceTarget(*atom, fit);
+				if ( (target != NULL) && claimLive(_liveClaims[this->liveSlot(target)]) )
+					worklist.push_back(target);
+			}
+		}
+		// give atoms loaded by searchLibraries() a claim before the next round.  Those that must not be
+		// dead stripped are roots, as they would have been had they been loaded before marking started.
+		this->indexAtomsForMarking();
+		for (size_t slot = firstNewSlot; slot < _liveSlotAtoms.size(); ++slot) {
+			const ld::Atom* atom = _liveSlotAtoms[slot];
+			if ( atom->dontDeadStrip() && claimLive(_liveClaims[slot]) )
+				worklist.push_back(atom);
 		}
 	}
 
+	// publish claims as live bits, which are not safe to set concurrently
+	marked.combine_each([](const std::vector<const ld::Atom*>& atoms) {
+		for (const ld::Atom* atom : atoms)
+			(const_cast<ld::Atom*>(atom))->setLive();
+	});
+}
+
+void Resolver::markLive(const std::vector<const ld::Atom*>& roots)
+{
+	// -why_live needs the depth first order to print reference chains
+	if ( _options.hasWhyLive() ) {
+		for (const ld::Atom* anAtom : roots) {
+			WhyLiveBackChain rootChain;
+			rootChain.previous = NULL;
+			rootChain.referer = anAtom;
+			this->markLive(*anAtom, &rootChain);
+		}
+	}
+	else {
+		this->markLiveConcurrently(roots);
+	}
 }
 
 class NotLiveLTO {
@@ -1204,19 +1490,19 @@ void Resolver::deadStripOptimize(bool force)
 	}
 	
 	// mark all roots as live, and all atoms they reference
+	std::vector<const ld::Atom*> roots;
+	roots.reserve(_deadStripRoots.size());
 	for (LDOrderedSet<const ld::Atom*>::iterator it=_deadStripRoots.begin(); it != _deadStripRoots.end(); ++it) {
 		const ld::Atom* anAtom = *it;
-		WhyLiveBackChain rootChain;
-		rootChain.previous = NULL;
-		rootChain.referer = anAtom;
 		if ( force && (anAtom->contentType() == ld::Atom::typeLTOtemporary) && (strcmp((anAtom)->name(), "import-atom") == 0) ) {
 			// <rdar://problem/57667716> LTO code-gen is done, doing second dead strip pass.  Don't use import-atom any more
 		}
 		else {
 			//fprintf(stderr, "dont-dead-strip: %p %s\n", anAtom, (anAtom)->name());
-			this->markLive(*anAtom, &rootChain);
+			roots.push_back(anAtom);
 		}
 	}
+	this->markLive(roots);
 	
 	// special case atoms that need to be live if they reference something live
 	if ( ! _dontDeadStripIfReferencesLive.empty() ) {
@@ -1241,14 +1527,14 @@ void Resolver::deadStripOptimize(bool force)
 				if ( (target != NULL) && target->live() ) 
 					hasLiveRef = true;
 			}
-			if ( hasLiveRef ) {
-				WhyLiveBackChain rootChain;
-				rootChain.previous = NULL;
-				rootChain.referer = liveIfRefLiveAtom;
-				this->markLive(*liveIfRefLiveAtom, &rootChain);
-			}
+			if ( hasLiveRef )
+				this->markLive(std::vector<const ld::Atom*>(1, liveIfRefLiveAtom));
 		}
 	}
+	_liveSlots.clear();
+	_liveClaims.clear();
+	_liveSlotAtoms.clear();
+	_liveIndexedAtomCount = 0;
 	
 	// now remove all non-live atoms from _atoms
 	const bool log = false;
@@ -1260,16 +1546,19 @@ void Resolver::deadStripOptimize(bool force)
 		}
 	}
 	
+	// stable partition keeps both the live atoms and the dead atoms in their original order
+	std::vector<const ld::Atom*>::iterator firstDead;
 	if ( _haveLLVMObjs && !force ) {
-		 std::copy_if(_atoms.begin(), _atoms.end(), std::back_inserter(_internal.deadAtoms), NotLiveLTO() );
 		// <rdar://problem/9777977> don't remove combinable atoms, they may come back in lto output
-		_atoms.erase(std::remove_if(_atoms.begin(), _atoms.end(), NotLiveLTO()), _atoms.end());
-		_symbolTable.removeDeadAtoms();
+		firstDead = std::stable_partition(pstl::execution::par, _atoms.begin(), _atoms.end(), [](const ld::Atom* atom) { return !NotLiveLTO()(atom); });
 	}
 	else {
-		 std::copy_if(_atoms.begin(), _atoms.end(), std::back_inserter(_internal.deadAtoms), NotLive() );
-		_atoms.erase(std::remove_if(_atoms.begin(), _atoms.end(), NotLive()), _atoms.end());
+		firstDead = std::stable_partition(pstl::execution::par, _atoms.begin(), _atoms.end(), [](const ld::Atom* atom) { return !NotLive()(atom); });
 	}
+	_internal.deadAtoms.insert(_internal.deadAtoms.end(), firstDead, _atoms.end());
+	_atoms.erase(firstDead, _atoms.end());
+	if ( _haveLLVMObjs && !force )
+		_symbolTable.removeDeadAtoms();
 
 	if ( log ) {
 		fprintf(stderr, "deadStripOptimize() %ld remaining atoms\n", _atoms.size());
@@ -1980,12 +2269,9 @@ void Resolver::buildArchivesList()
 	_inputFiles.archives(_internal);
 }
 
-void Resolver::dumpMembersParsed()
+void Resolver::saveLinkState()
 {
-	std::ofstream stream;
-	stream.open(_options.cacheFilePath());
-	_inputFiles.dumpMembersParsed(stream);
-	stream.close();
+	_inputFiles.saveLinkState();
 }
 
 void Resolver::dumpAtoms() 
@@ -2053,7 +2339,7 @@ void Resolver::resolve()
 	this->tweakWeakness();
     _symbolTable.checkDuplicateSymbols();
 	this->buildArchivesList();
-	this->dumpMembersParsed();
+	this->saveLinkState();
 	this->checkChainedFixupsBounds();
 }
 
@@ -41,6 +41,8 @@
 #include <dlfcn.h>
 #include <mach-o/dyld.h>
 
+#include <atomic>
+#include <deque>
 #include <vector>
 #include <unordered_set>
 
@@ -64,6 +66,8 @@ public:
 								  _haveLLVMObjs(false),
 								  _completedInitialObjectFiles(false),
 								  _ltoCodeGenFinished(false),
+								  _addAtomsInBulk(false),
+								  _liveIndexedAtomCount(0),
 								  _haveAliases(false), _havellvmProfiling(false) {}
 								
 
@@ -95,15 +99,23 @@ private:
 	void					fillInEntryPoint();
 	void					linkTimeOptimize();
 	void					convertReferencesToIndirect(const ld::Atom& atom);
+	Options::Treatment		duplicatesTreatment() const;
+	void					addToSymbolTable(const ld::Atom& atom);
+	void					addPendingAtoms();
 	const ld::Atom*			entryPoint(bool searchArchives);
 	void					markLive(const ld::Atom& atom, WhyLiveBackChain* previous);
+	void					markLive(const std::vector<const ld::Atom*>& roots);
+	void					markLiveConcurrently(const std::vector<const ld::Atom*>& roots);
+	const ld::Atom*			liveReferenceTarget(const ld::Atom& atom, ld::Fixup::iterator fit);
+	uint32_t				liveSlot(const ld::Atom* atom);
+	void					indexAtomsForMarking();
 	bool					isDtraceProbe(ld::Fixup::Kind kind);
 	void					liveUndefines(std::vector<const char*>&);
 	void					remainingUndefines(std::vector<const char*>&);
 	bool					printReferencedBy(const char* name, SymbolTable::IndirectBindingSlot slot);
 	void					tweakWeakness();
 	void					buildArchivesList();
-	void dumpMembersParsed();
+	void					saveLinkState();
 	void					doLinkerOption(const std::vector<const char*>& linkerOption, const char* fileName);
 	void					dumpAtoms();
 	void					checkChainedFixupsBounds();
@@ -131,11 +143,19 @@ private:
 	LDOrderedSet<const ld::Atom*>		_deadStripRoots;
 	std::vector<const ld::Atom*>	_dontDeadStripIfReferencesLive;
 	std::vector<const ld::Atom*>	_atomsWithUnresolvedReferences;
+	std::vector<const char*>		_unresolvedUndefines;	// searched for but still unbound, sorted
+	std::vector<const char*>		_searchedTentativeDefs;	// tentatives already searched for an override
 	std::vector<const class AliasAtom*>	_aliasesFromCmdLine;
 	SymbolTable						_symbolTable;
 	bool							_haveLLVMObjs;
 	bool							_completedInitialObjectFiles;
 	bool							_ltoCodeGenFinished;
+	bool							_addAtomsInBulk;
+	std::vector<const ld::Atom*>	_pendingAtoms;			// atoms doAtom() left for addPendingAtoms()
+	LDMap<const ld::Atom*, uint32_t>	_liveSlots;			// dead strip marking state, see markLiveConcurrently()
+	std::deque<std::atomic<bool>>	_liveClaims;
+	std::vector<const ld::Atom*>	_liveSlotAtoms;
+	size_t							_liveIndexedAtomCount;
 	bool							_haveAliases;
 	bool							_havellvmProfiling;
 };
@@ -0,0 +1,99 @@
+//
+//  SearchPathCache.cpp
+//  ld
+//
+
+#include <dirent.h>
+#include <errno.h>
+#include <string.h>
+
+#include "SearchPathCache.h"
+
+namespace ld {
+
+static bool isASCII(const std::string& name)
+{
+	for (char c : name) {
+		if ( (unsigned char)c >= 0x80 )
+			return false;
+	}
+	return true;
+}
+
+static std::string lowerCase(const std::string& name)
+{
+	std::string result(name);
+	for (char& c : result) {
+		if ( (c >= 'A') && (c <= 'Z') )
+			c += 'a' - 'A';
+	}
+	return result;
+}
+
+bool SearchPathCache::Directory::contains(const std::string& name) const
+{
+	switch ( state ) {
+		case kMissing:
+			return false;
+		case kUnreadable:
+			return true;
+		case kListed:
+			// the file system may normalize non-ASCII names, so only stat() can tell
+			return !isASCII(name) || (names.count(lowerCase(name)) != 0);
+	}
+	return true;
+}
+
+bool SearchPathCache::split(const std::string& path, std::string& dirPath, std::string& leafName)
+{
+	std::string::size_type lastSlash = path.find_last_of('/');
+	if ( lastSlash == std::string::npos ) {
+		dirPath = ".";
+		leafName = path;
+	}
+	else {
+		std::string::size_type dirEnd = path.find_last_not_of('/', lastSlash);
+		dirPath = (dirEnd == std::string::npos) ? "/" : path.substr(0, dirEnd+1);
+		leafName = path.substr(lastSlash+1);
+	}
+	return !leafName.empty() && (leafName != ".") && (leafName != "..");
+}
+
+const SearchPathCache::Directory& SearchPathCache::directory(const std::string& dirPath)
+{
+	auto pos = _directories.find(dirPath);
+	if ( pos != _directories.end() )
+		return *pos->second;
+
+	std::unique_ptr<Directory> dir(new Directory());
+	dir->state = Directory::kUnreadable;
+	std::string parentPath;
+	std::string leafName;
+	if ( split(dirPath, parentPath, leafName) && (parentPath != dirPath) && !directory(parentPath).contains(leafName) ) {
+		dir->state = Directory::kMissing;
+	}
+	else if ( DIR* dirp = ::opendir(dirPath.c_str()) ) {
+		dir->state = Directory::kListed;
+		while ( dirent* entry = ::readdir(dirp) )
+			dir->names.insert(lowerCase(entry->d_name));
+		::closedir(dirp);
+	}
+	else if ( (errno == ENOENT) || (errno == ENOTDIR) ) {
+		dir->state = Directory::kMissing;
+	}
+	const Directory& result = *dir;
+	_directories[dirPath] = std::move(dir);
+	return result;
+}
+
+bool SearchPathCache::mayExist(const char* path)
+{
+	std::string dirPath;
+	std::string leafName;
+	if ( !split(path, dirPath, leafName) )
+		return true;
+	std::lock_guard<std::mutex> guard(_lock);
+	return directory(dirPath).contains(leafName);
+}
+
+} // namespace ld
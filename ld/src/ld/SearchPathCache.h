@@ -0,0 +1,48 @@
+//
+//  SearchPathCache.h
+//  ld
+//
+
+#ifndef __SEARCH_PATH_CACHE_H__
+#define __SEARCH_PATH_CACHE_H__
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "MapDefines.h"
+
+namespace ld {
+
+//
+// SearchPathCache reads each directory that library, framework and indirect dylib searches look
+// in once, and answers whether a candidate path can exist from the listing, so the many misses of
+// a search over -L/-F paths cost no system call.  A directory is only opened if its own parent's
+// listing contains it.  Names are compared case-insensitively, and names with non-ASCII bytes or
+// directories that cannot be read are never ruled out, so a positive answer still has to be
+// confirmed with stat() but a negative one is always right.  Thread safe.
+//
+class SearchPathCache
+{
+public:
+	// false if path certainly does not exist
+	bool					mayExist(const char* path);
+
+private:
+	struct Directory {
+		enum State { kMissing, kUnreadable, kListed };
+		State				state;
+		LDSet<std::string>	names;		// lower-cased
+		bool				contains(const std::string& name) const;
+	};
+
+	const Directory&		directory(const std::string& dirPath);
+	static bool				split(const std::string& path, std::string& dirPath, std::string& leafName);
+
+	std::mutex										_lock;
+	LDMap<std::string, std::unique_ptr<Directory>>	_directories;
+};
+
+} // namespace ld
+
+#endif // __SEARCH_PATH_CACHE_H__
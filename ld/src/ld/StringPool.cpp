@@ -0,0 +1,331 @@
+//
+//  StringPool.cpp
+//  ld
+//
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <functional>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "pstl/execution"
+#include "pstl/algorithm"
+
+#include "StringPool.h"
+
+namespace ld {
+namespace tool {
+
+
+StringPool::StringPool()
+	: _currentBuffer(NULL), _currentBufferUsed(0)
+{
+	_currentBuffer = new char[kBufferSize];
+	// burn first byte of string pool (so zero is never a valid string offset)
+	_currentBuffer[_currentBufferUsed++] = ' ';
+	// make offset 1 always point to an empty string
+	_currentBuffer[_currentBufferUsed++] = '\0';
+}
+
+StringPool::~StringPool()
+{
+	for (char* buffer : _fullBuffers)
+		delete [] buffer;
+	delete [] _currentBuffer;
+}
+
+void StringPool::copyTo(uint8_t buffer[]) const
+{
+	uint64_t offset = 0;
+	for (unsigned int i=0; i < _fullBuffers.size(); ++i) {
+		memcpy(&buffer[offset], _fullBuffers[i], kBufferSize);
+		offset += kBufferSize;
+	}
+	memcpy(&buffer[offset], _currentBuffer, _currentBufferUsed);
+}
+
+int32_t StringPool::getOffset() const
+{
+	return kBufferSize * _fullBuffers.size() + _currentBufferUsed;
+}
+
+// makes room for size bytes at the end of the pool, which may span buffers, and returns its offset
+int32_t StringPool::reserve(uint64_t size)
+{
+	int32_t offset = getOffset();
+	while ( (_currentBufferUsed + size) >= kBufferSize ) {
+		size -= kBufferSize - _currentBufferUsed;
+		_fullBuffers.push_back(_currentBuffer);
+		_currentBuffer = new char[kBufferSize];
+		_currentBufferUsed = 0;
+	}
+	_currentBufferUsed += size;
+	return offset;
+}
+
+void StringPool::copyIn(uint64_t offset, const char* bytes, size_t size)
+{
+	while ( size != 0 ) {
+		uint64_t bufferIndex = offset / kBufferSize;
+		uint64_t offsetInBuffer = offset % kBufferSize;
+		char* buffer = (bufferIndex < _fullBuffers.size()) ? _fullBuffers[bufferIndex] : _currentBuffer;
+		size_t amount = std::min(size, (size_t)(kBufferSize - offsetInBuffer));
+		memcpy(&buffer[offsetInBuffer], bytes, amount);
+		offset += amount;
+		bytes += amount;
+		size -= amount;
+	}
+}
+
+int32_t StringPool::add(std::string_view str)
+{
+	int32_t offset = this->reserve(str.size()+1);
+	this->copyIn(offset, str.data(), str.size());
+	this->copyIn(offset+str.size(), "", 1);
+	return offset;
+}
+
+uint32_t StringPool::currentOffset() const
+{
+	return kBufferSize * _fullBuffers.size() + _currentBufferUsed;
+}
+
+unsigned StringPool::uniqueShard(std::string_view str)
+{
+	return std::hash<std::string_view>()(str) % kUniqueShardCount;
+}
+
+int32_t StringPool::addUnique(std::string_view str)
+{
+	StringToOffset& uniqueStrings = _uniqueStrings[uniqueShard(str)];
+	std::string key(str);
+	StringToOffset::iterator pos = uniqueStrings.find(key);
+	if ( pos != uniqueStrings.end() ) {
+		return pos->second;
+	}
+	else {
+		int32_t offset = this->add(str);
+		uniqueStrings[key] = offset;
+		return offset;
+	}
+}
+
+void StringPool::addInParallel(const std::vector<std::string_view>& strings, bool unique, std::vector<int32_t>& offsets)
+{
+	const size_t count = strings.size();
+	const size_t inPool = SIZE_MAX;
+	offsets.resize(count);
+	// firsts[i] is the index of the first of strings equal to strings[i], or inPool if it was
+	// already in the pool, in which case offsets[i] is already set
+	std::vector<size_t> firsts(count);
+	// where the offset of each new unique string goes in _uniqueStrings
+	std::vector<int32_t*> uniqueOffsets;
+	if ( unique ) {
+		// sort the indexes by shard, keeping their order within each shard, so that the shards
+		// can be searched concurrently and each still sees the first of equal strings first
+		std::vector<uint8_t> shards(count);
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, count, 4096), [&](const tbb::blocked_range<size_t>& range) {
+			for (size_t i = range.begin(); i != range.end(); ++i)
+				shards[i] = uniqueShard(strings[i]);
+		});
+		std::vector<size_t> shardStarts(kUniqueShardCount+1, 0);
+		for (uint8_t shard : shards)
+			++shardStarts[shard+1];
+		for (unsigned shard = 0; shard < kUniqueShardCount; ++shard)
+			shardStarts[shard+1] += shardStarts[shard];
+		std::vector<size_t> shardEnds(shardStarts.begin(), shardStarts.end()-1);
+		std::vector<size_t> byShard(count);
+		for (size_t i = 0; i < count; ++i)
+			byShard[shardEnds[shards[i]]++] = i;
+		// a string new to the pool is entered right away, as -1 - (index of its first use) until
+		// its offset is known
+		uniqueOffsets.resize(count);
+		tbb::parallel_for(0U, (unsigned)kUniqueShardCount, [&](unsigned shard) {
+			StringToOffset& uniqueStrings = _uniqueStrings[shard];
+			uniqueStrings.reserve(uniqueStrings.size() + (shardStarts[shard+1] - shardStarts[shard]));
+			for (size_t j = shardStarts[shard]; j != shardStarts[shard+1]; ++j) {
+				size_t i = byShard[j];
+				auto inserted = uniqueStrings.emplace(std::string(strings[i]), (int32_t)(-1 - (int64_t)i));
+				int32_t offset = inserted.first->second;
+				if ( inserted.second ) {
+					firsts[i] = i;
+					uniqueOffsets[i] = &inserted.first->second;
+				}
+				else if ( offset < 0 ) {
+					firsts[i] = -1 - (int64_t)offset;
+				}
+				else {
+					firsts[i] = inPool;
+					offsets[i] = offset;
+				}
+			}
+		});
+	}
+	else {
+		for (size_t i = 0; i < count; ++i)
+			firsts[i] = i;
+	}
+
+	// size the new strings in chunks, then copy each chunk to its place in the pool
+	const size_t chunkSize = 4096;
+	const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+	std::vector<uint64_t> chunkOffsets(chunkCount+1, 0);
+	tbb::parallel_for((size_t)0, chunkCount, [&](size_t chunk) {
+		uint64_t chunkBytes = 0;
+		for (size_t i = chunk*chunkSize, end = std::min(count, (chunk+1)*chunkSize); i != end; ++i) {
+			if ( firsts[i] == i )
+				chunkBytes += strings[i].size() + 1;
+		}
+		chunkOffsets[chunk+1] = chunkBytes;
+	});
+	for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+		chunkOffsets[chunk+1] += chunkOffsets[chunk];
+	const uint64_t startOffset = this->reserve(chunkOffsets[chunkCount]);
+	tbb::parallel_for((size_t)0, chunkCount, [&](size_t chunk) {
+		uint64_t offset = startOffset + chunkOffsets[chunk];
+		for (size_t i = chunk*chunkSize, end = std::min(count, (chunk+1)*chunkSize); i != end; ++i) {
+			if ( firsts[i] == i ) {
+				offsets[i] = offset;
+				if ( unique )
+					*uniqueOffsets[i] = offset;
+				this->copyIn(offset, strings[i].data(), strings[i].size());
+				this->copyIn(offset+strings[i].size(), "", 1);
+				offset += strings[i].size() + 1;
+			}
+		}
+	});
+
+	// point repeated strings at the first copy
+	if ( unique ) {
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, count, 4096), [&](const tbb::blocked_range<size_t>& range) {
+			for (size_t i = range.begin(); i != range.end(); ++i) {
+				if ( (firsts[i] != i) && (firsts[i] != inPool) )
+					offsets[i] = offsets[firsts[i]];
+			}
+		});
+	}
+}
+
+// orders strings as if their bytes were reversed, so each string is followed by those ending with it
+bool StringPool::reversedLess(std::string_view a, std::string_view b)
+{
+	const size_t length = std::min(a.size(), b.size());
+	for (size_t i = 1; i <= length; ++i) {
+		unsigned char ca = a[a.size()-i];
+		unsigned char cb = b[b.size()-i];
+		if ( ca != cb )
+			return ca < cb;
+	}
+	return a.size() < b.size();
+}
+
+bool StringPool::endsWith(std::string_view str, std::string_view suffix)
+{
+	return (str.size() >= suffix.size()) && (memcmp(str.data() + str.size() - suffix.size(), suffix.data(), suffix.size()) == 0);
+}
+
+void StringPool::addTailMerged(const std::vector<std::string_view>& strings, std::vector<int32_t>& offsets)
+{
+	const size_t count = strings.size();
+	const size_t none = SIZE_MAX;
+	offsets.resize(count);
+
+	// in reversed byte order, every string that ends another one ends the string right after it,
+	// and a run of such strings all end the last string of the run, which is the only one copied
+	std::vector<size_t> sorted(count);
+	for (size_t i = 0; i < count; ++i)
+		sorted[i] = i;
+	std::sort(std::execution::par, sorted.begin(), sorted.end(), [&](size_t a, size_t b) {
+		if ( reversedLess(strings[a], strings[b]) )
+			return true;
+		if ( reversedLess(strings[b], strings[a]) )
+			return false;
+		return a < b;
+	});
+	// hosts[k] is the position in sorted of the string that strings[sorted[k]] is copied as part of
+	std::vector<size_t> hosts(count);
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, count, 4096), [&](const tbb::blocked_range<size_t>& range) {
+		for (size_t k = range.begin(); k != range.end(); ++k) {
+			bool merged = (k+1 < count) && endsWith(strings[sorted[k+1]], strings[sorted[k]]);
+			hosts[k] = merged ? none : k;
+		}
+	});
+	for (size_t k = count; k-- > 0; ) {
+		if ( hosts[k] == none )
+			hosts[k] = hosts[k+1];
+	}
+
+	// each copied string is placed where the first of the strings it holds was added, so the
+	// pool keeps roughly the order of the symbols
+	std::vector<size_t> firstUses(count, none);
+	for (size_t k = 0; k < count; ++k) {
+		size_t& firstUse = firstUses[hosts[k]];
+		firstUse = std::min(firstUse, sorted[k]);
+	}
+	std::vector<size_t> placed(count, none);
+	for (size_t k = 0; k < count; ++k) {
+		if ( firstUses[k] != none )
+			placed[firstUses[k]] = k;
+	}
+
+	// size the copied strings in chunks, then copy each chunk to its place in the pool
+	const size_t chunkSize = 4096;
+	const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+	std::vector<uint64_t> chunkOffsets(chunkCount+1, 0);
+	tbb::parallel_for((size_t)0, chunkCount, [&](size_t chunk) {
+		uint64_t chunkBytes = 0;
+		for (size_t i = chunk*chunkSize, end = std::min(count, (chunk+1)*chunkSize); i != end; ++i) {
+			if ( placed[i] != none )
+				chunkBytes += strings[sorted[placed[i]]].size() + 1;
+		}
+		chunkOffsets[chunk+1] = chunkBytes;
+	});
+	for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+		chunkOffsets[chunk+1] += chunkOffsets[chunk];
+	const uint64_t startOffset = this->reserve(chunkOffsets[chunkCount]);
+	std::vector<int32_t> hostOffsets(count);
+	tbb::parallel_for((size_t)0, chunkCount, [&](size_t chunk) {
+		uint64_t offset = startOffset + chunkOffsets[chunk];
+		for (size_t i = chunk*chunkSize, end = std::min(count, (chunk+1)*chunkSize); i != end; ++i) {
+			if ( placed[i] != none ) {
+				std::string_view str = strings[sorted[placed[i]]];
+				hostOffsets[placed[i]] = offset;
+				this->copyIn(offset, str.data(), str.size());
+				this->copyIn(offset+str.size(), "", 1);
+				offset += str.size() + 1;
+			}
+		}
+	});
+
+	// point every string at its end of the copy it is part of
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, count, 4096), [&](const tbb::blocked_range<size_t>& range) {
+		for (size_t k = range.begin(); k != range.end(); ++k) {
+			const size_t host = hosts[k];
+			offsets[sorted[k]] = hostOffsets[host] + (int32_t)(strings[sorted[host]].size() - strings[sorted[k]].size());
+		}
+	});
+}
+
+
+const char* StringPool::stringForIndex(int32_t index) const
+{
+	int32_t currentBufferStartIndex = kBufferSize * _fullBuffers.size();
+	int32_t maxIndex = currentBufferStartIndex + _currentBufferUsed;
+	// check for out of bounds
+	if ( index > maxIndex )
+		return "";
+	// check for index in _currentBuffer
+	if ( index > currentBufferStartIndex )
+		return &_currentBuffer[index-currentBufferStartIndex];
+	// otherwise index is in a full buffer
+	uint32_t fullBufferIndex = index/kBufferSize;
+	return &_fullBuffers[fullBufferIndex][index-(kBufferSize*fullBufferIndex)];
+}
+
+
+} // namespace tool
+} // namespace ld
@@ -0,0 +1,71 @@
+//
+//  StringPool.h
+//  ld
+//
+
+#ifndef __STRING_POOL_H__
+#define __STRING_POOL_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MapDefines.h"
+
+namespace ld {
+namespace tool {
+
+//
+// StringPool holds the bytes of the string table of the output.  Offset 0 is never a string and
+// offset 1 is always the empty string.  Strings are appended, optionally uniqued, one at a time or
+// many at once on every core.  The string pool atom of the output writes it to LINKEDIT.
+//
+class StringPool
+{
+public:
+												StringPool();
+												~StringPool();
+
+	int32_t										add(std::string_view str);
+	int32_t										addUnique(std::string_view str);
+	// adds all strings using every core, leaving the pool as add() (or addUnique() if unique) on
+	// each string in order would, and sets offsets[i] to the offset of strings[i]
+	void										addInParallel(const std::vector<std::string_view>& strings, bool unique,
+															  std::vector<int32_t>& offsets);
+	// like addInParallel(), but a string that is the end of another one (or the same as one) is
+	// not copied, and its offset points into that string instead (-zld_tail_merge_strings)
+	void										addTailMerged(const std::vector<std::string_view>& strings,
+															  std::vector<int32_t>& offsets);
+	int32_t										getOffset() const;
+	int32_t										emptyString() const		{ return 1; }
+	const char*									stringForIndex(int32_t) const;
+	uint32_t									currentOffset() const;
+	// copies the currentOffset() bytes of the pool to buffer
+	void										copyTo(uint8_t buffer[]) const;
+
+private:
+	enum { kBufferSize = 0x01000000, kUniqueShardCount = 64 };
+	typedef LDMap<std::string, int32_t> StringToOffset;
+
+												StringPool(const StringPool&) = delete;
+	StringPool&									operator=(const StringPool&) = delete;
+
+	int32_t										reserve(uint64_t size);
+	void										copyIn(uint64_t offset, const char* bytes, size_t size);
+	static unsigned								uniqueShard(std::string_view str);
+	static bool									reversedLess(std::string_view a, std::string_view b);
+	static bool									endsWith(std::string_view str, std::string_view suffix);
+
+	std::vector<char*>							_fullBuffers;
+	char*										_currentBuffer;
+	uint32_t									_currentBufferUsed;
+	// unique strings are split by hash, so addInParallel() can look them up and add them per shard
+	StringToOffset								_uniqueStrings[kUniqueShardCount];
+};
+
+} // namespace tool
+} // namespace ld
+
+#endif // __STRING_POOL_H__
@@ -42,6 +42,9 @@
 #include <vector>
 #include <algorithm>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
 #include "Options.h"
 
 #include "ld.hpp"
@@ -117,16 +120,6 @@ bool SymbolTable::ReferencesHashFuncs::operator()(const ld::Atom* left, const ld
 }
 
 
-void SymbolTable::addDuplicateSymbolError(const char* name, const ld::Atom* atom)
-{
-	addDuplicateSymbol(_duplicateSymbolErrors, name, atom);
-}
-
-void SymbolTable::addDuplicateSymbolWarning(const char* name, const ld::Atom* atom)
-{
-	addDuplicateSymbol(_duplicateSymbolWarnings, name, atom);
-}
-
 void SymbolTable::addDuplicateSymbol(DuplicateSymbols& dups, const char *name, const ld::Atom *atom)
 {
     // Look up or create the file list for name.
@@ -425,6 +418,23 @@ private:
 	}
 };
 
+bool SymbolTable::pickByName(const ld::Atom& newAtom, const ld::Atom& existingAtom, Options::Treatment duplicates,
+								DuplicateSymbols& errors, DuplicateSymbols& warnings)
+{
+	assert(&newAtom != &existingAtom);
+	const char* name = newAtom.name();
+	NameCollisionResolution picker(newAtom, existingAtom, duplicates, _options);
+	if ( picker.reportDuplicateError() ) {
+		addDuplicateSymbol(errors, name, &existingAtom);
+		addDuplicateSymbol(errors, name, &newAtom);
+	}
+	else if ( picker.reportDuplicateWarning() ) {
+		addDuplicateSymbol(warnings, name, &existingAtom);
+		addDuplicateSymbol(warnings, name, &newAtom);
+	}
+	return picker.choseAtom(newAtom);
+}
+
 bool SymbolTable::addByName(const ld::Atom& newAtom, Options::Treatment duplicates)
 {
 	bool useNew = true;
@@ -433,19 +443,8 @@ bool SymbolTable::addByName(const ld::Atom& newAtom, Options::Treatment duplicat
 	IndirectBindingSlot slot = this->findSlotForName(name);
 	const ld::Atom* existingAtom = _indirectBindingTable[slot];
 	//fprintf(stderr, "addByName(%p) name=%s, slot=%u, existing=%p\n", &newAtom, newAtom.name(), slot, existingAtom);
-	if ( existingAtom != NULL ) {
-		assert(&newAtom != existingAtom);
-		NameCollisionResolution picker(newAtom, *existingAtom, duplicates, _options);
-		if ( picker.reportDuplicateError() ) {
-			addDuplicateSymbolError(name, existingAtom);
-			addDuplicateSymbolError(name, &newAtom);
-		}
-		else if ( picker.reportDuplicateWarning() ) {
-			addDuplicateSymbolWarning(name, existingAtom);
-			addDuplicateSymbolWarning(name, &newAtom);
-		}
-		useNew = picker.choseAtom(newAtom);
-	}
+	if ( existingAtom != NULL )
+		useNew = this->pickByName(newAtom, *existingAtom, duplicates, _duplicateSymbolErrors, _duplicateSymbolWarnings);
 	if ( useNew ) {
 		_indirectBindingTable[slot] = &newAtom;
 		if ( existingAtom != NULL ) {
@@ -454,6 +453,7 @@ bool SymbolTable::addByName(const ld::Atom& newAtom, Options::Treatment duplicat
 		if ( newAtom.scope() == ld::Atom::scopeGlobal ) {
 			if ( newAtom.definition() == ld::Atom::definitionTentative ) {
 				_hasExternalTentativeDefinitions = true;
+				_newTentativeDefs.push_back(name);
 			}
 		}
 	}
@@ -533,6 +533,168 @@ bool SymbolTable::add(const ld::Atom& atom, Options::Treatment duplicates)
 	return false;
 }
 
+// a definition (atom != NULL) or by-name reference (fixup != NULL) handed to the shard that owns its name
+struct SymbolTable::NameOperation {
+	const char*				name;
+	const ld::Atom*			atom;
+	ld::Fixup*				fixup;
+};
+
+// what filling a name shard changed, merged into the symbol table once all shards are done
+struct SymbolTable::NameShardResult {
+	std::vector<const char*>							newNames;		// in order of first use
+	std::vector<const ld::Atom*>						newBindings;	// atom bound to each new name
+	std::vector<std::pair<ld::Fixup*, uint32_t>>		newNameFixups;	// references to a new name
+	std::vector<const ld::Atom*>						coalescedAway;
+	std::vector<const char*>							tentativeDefs;
+	DuplicateSymbols									duplicateErrors;
+	DuplicateSymbols									duplicateWarnings;
+	bool												hasExternalTentativeDefinitions = false;
+};
+
+const unsigned SymbolTable::kNameShardCount;
+
+// marks a slot that fillNameShard() created, which is only numbered after all shards are filled
+static const uint32_t kNewNameSlot = 0x80000000;
+
+void SymbolTable::fillNameShard(unsigned shard, const std::vector<std::vector<NameOperation>>& operations,
+								size_t chunkCount, Options::Treatment duplicates, NameShardResult& result)
+{
+	// Only this thread touches this shard's table, its new names, and the slots of names it owns.
+	// Atoms are marked coalesced away afterwards, since other threads may be reading their bits.
+	NameToSlot& byNameTable = _byNameShards[shard];
+	for (size_t chunk=0; chunk < chunkCount; ++chunk) {
+		for (const NameOperation& op : operations[chunk*kNameShardCount + shard]) {
+			NameToSlot::iterator pos = byNameTable.find(op.name);
+			IndirectBindingSlot slot;
+			if ( pos != byNameTable.end() ) {
+				slot = pos->second;
+			}
+			else {
+				slot = kNewNameSlot | (uint32_t)result.newNames.size();
+				byNameTable[op.name] = slot;
+				result.newNames.push_back(op.name);
+				result.newBindings.push_back(NULL);
+			}
+			if ( op.fixup != NULL ) {
+				if ( slot & kNewNameSlot ) {
+					result.newNameFixups.push_back(std::make_pair(op.fixup, slot & ~kNewNameSlot));
+				}
+				else {
+					op.fixup->binding = ld::Fixup::bindingsIndirectlyBound;
+					op.fixup->u.bindingIndex = slot;
+				}
+				continue;
+			}
+			// same as addByName()
+			const ld::Atom*& binding = (slot & kNewNameSlot) ? result.newBindings[slot & ~kNewNameSlot] : _indirectBindingTable[slot];
+			const ld::Atom& newAtom = *op.atom;
+			const ld::Atom* existingAtom = binding;
+			bool useNew = true;
+			if ( existingAtom != NULL )
+				useNew = this->pickByName(newAtom, *existingAtom, duplicates, result.duplicateErrors, result.duplicateWarnings);
+			if ( useNew ) {
+				binding = &newAtom;
+				if ( existingAtom != NULL )
+					result.coalescedAway.push_back(existingAtom);
+				if ( newAtom.scope() == ld::Atom::scopeGlobal ) {
+					if ( newAtom.definition() == ld::Atom::definitionTentative ) {
+						result.hasExternalTentativeDefinitions = true;
+						result.tentativeDefs.push_back(op.name);
+					}
+				}
+			}
+			else {
+				result.coalescedAway.push_back(&newAtom);
+			}
+		}
+	}
+}
+
+void SymbolTable::addAtoms(const std::vector<const ld::Atom*>& atoms, Options::Treatment duplicates)
+{
+	// Gives the same result as add() on each atom combined by name, followed by binding its by-name
+	// references, one atom at a time.  Each definition and reference is routed to the shard owning its
+	// name, keeping input order, so collisions are resolved in the same order.  Shards are then filled
+	// concurrently.  Names first seen here are numbered shard by shard afterwards, so slots depend on
+	// input order only, never on thread timing.
+	const size_t chunkSize = 1024;
+	const size_t chunkCount = (atoms.size() + chunkSize - 1) / chunkSize;
+	std::vector<std::vector<NameOperation>> operations(chunkCount * kNameShardCount);
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, chunkCount, 1), [&](const tbb::blocked_range<size_t>& range) {
+		for (size_t chunk=range.begin(); chunk != range.end(); ++chunk) {
+			std::vector<NameOperation>* chunkOperations = &operations[chunk*kNameShardCount];
+			const size_t end = std::min(atoms.size(), (chunk+1)*chunkSize);
+			for (size_t i=chunk*chunkSize; i < end; ++i) {
+				const ld::Atom* atom = atoms[i];
+				if ( atom->scope() != ld::Atom::scopeTranslationUnit ) {
+					switch ( atom->combine() ) {
+						case ld::Atom::combineNever:
+						case ld::Atom::combineByName:
+							assert(atom->name() != NULL);
+							chunkOperations[nameShard(atom->name())].push_back({ atom->name(), atom, NULL });
+							break;
+						case ld::Atom::combineByNameAndContent:
+						case ld::Atom::combineByNameAndReferences:
+							break;
+					}
+				}
+				for (ld::Fixup::iterator fit=atom->fixupsBegin(), fend=atom->fixupsEnd(); fit != fend; ++fit) {
+					if ( fit->binding == ld::Fixup::bindingByNameUnbound )
+						chunkOperations[nameShard(fit->u.name)].push_back({ fit->u.name, NULL, fit });
+				}
+			}
+		}
+	});
+
+	std::vector<NameShardResult> results(kNameShardCount);
+	tbb::parallel_for(tbb::blocked_range<unsigned>(0, kNameShardCount, 1), [&](const tbb::blocked_range<unsigned>& range) {
+		for (unsigned shard=range.begin(); shard != range.end(); ++shard)
+			this->fillNameShard(shard, operations, chunkCount, duplicates, results[shard]);
+	});
+
+	// number the new names
+	std::vector<IndirectBindingSlot> firstNewSlot(kNameShardCount);
+	for (unsigned shard=0; shard < kNameShardCount; ++shard) {
+		NameShardResult& result = results[shard];
+		firstNewSlot[shard] = (IndirectBindingSlot)_indirectBindingTable.size();
+		_indirectBindingTable.insert(_indirectBindingTable.end(), result.newBindings.begin(), result.newBindings.end());
+		for (size_t i=0; i < result.newNames.size(); ++i)
+			_byNameReverseTable[firstNewSlot[shard] + (IndirectBindingSlot)i] = result.newNames[i];
+		// a new name starts out unbound, so queue it for the resolver
+		_newUndefines.insert(_newUndefines.end(), result.newNames.begin(), result.newNames.end());
+		_newTentativeDefs.insert(_newTentativeDefs.end(), result.tentativeDefs.begin(), result.tentativeDefs.end());
+		if ( result.hasExternalTentativeDefinitions )
+			_hasExternalTentativeDefinitions = true;
+		for (const auto& entry : result.duplicateErrors) {
+			for (const ld::Atom* atom : *entry.second)
+				addDuplicateSymbol(_duplicateSymbolErrors, entry.first, atom);
+			delete entry.second;
+		}
+		for (const auto& entry : result.duplicateWarnings) {
+			for (const ld::Atom* atom : *entry.second)
+				addDuplicateSymbol(_duplicateSymbolWarnings, entry.first, atom);
+			delete entry.second;
+		}
+	}
+	tbb::parallel_for(tbb::blocked_range<unsigned>(0, kNameShardCount, 1), [&](const tbb::blocked_range<unsigned>& range) {
+		for (unsigned shard=range.begin(); shard != range.end(); ++shard) {
+			const NameShardResult& result = results[shard];
+			NameToSlot& byNameTable = _byNameShards[shard];
+			for (size_t i=0; i < result.newNames.size(); ++i)
+				byNameTable[result.newNames[i]] = firstNewSlot[shard] + (IndirectBindingSlot)i;
+			for (const auto& entry : result.newNameFixups) {
+				entry.first->binding = ld::Fixup::bindingsIndirectlyBound;
+				entry.first->u.bindingIndex = firstNewSlot[shard] + entry.second;
+			}
+		}
+	});
+	for (const NameShardResult& result : results) {
+		for (const ld::Atom* atom : result.coalescedAway)
+			this->markCoalescedAway(atom);
+	}
+}
+
 void SymbolTable::markCoalescedAway(const ld::Atom* atom)
 {
 	// remove this from list of all atoms used
@@ -572,11 +734,13 @@ struct StrcmpSorter {
 
 void SymbolTable::undefines(std::vector<const char*>& undefs)
 {
-	// return all names in _byNameTable that have no associated atom
-	for (NameToSlot::iterator it=_byNameTable.begin(); it != _byNameTable.end(); ++it) {
-		//fprintf(stderr, "  _byNameTable[%s] = slot %d which has atom %p\n", it->first, it->second, _indirectBindingTable[it->second]);
-		if ( _indirectBindingTable[it->second] == NULL )
-			undefs.push_back(it->first);
+	// return all names in _byNameShards that have no associated atom
+	for (const NameToSlot& byNameTable : _byNameShards) {
+		for (NameToSlot::const_iterator it=byNameTable.begin(); it != byNameTable.end(); ++it) {
+			//fprintf(stderr, "  _byNameTable[%s] = slot %d which has atom %p\n", it->first, it->second, _indirectBindingTable[it->second]);
+			if ( _indirectBindingTable[it->second] == NULL )
+				undefs.push_back(it->first);
+		}
 	}
 	// sort so that undefines are in a stable order (not dependent on hashing functions)
 	struct StrcmpSorter strcmpSorter;
@@ -586,71 +750,130 @@ void SymbolTable::undefines(std::vector<const char*>& undefs)
 
 void SymbolTable::tentativeDefs(std::vector<const char*>& tents)
 {
-	// return all names in _byNameTable that have no associated atom
-	for (NameToSlot::iterator it=_byNameTable.begin(); it != _byNameTable.end(); ++it) {
-		const char* name = it->first;
-		const ld::Atom* atom = _indirectBindingTable[it->second];
-		if ( (atom != NULL) && (atom->definition() == ld::Atom::definitionTentative) )
-			tents.push_back(name);
+	// return all names in _byNameShards that have no associated atom
+	for (const NameToSlot& byNameTable : _byNameShards) {
+		for (NameToSlot::const_iterator it=byNameTable.begin(); it != byNameTable.end(); ++it) {
+			const char* name = it->first;
+			const ld::Atom* atom = _indirectBindingTable[it->second];
+			if ( (atom != NULL) && (atom->definition() == ld::Atom::definitionTentative) )
+				tents.push_back(name);
+		}
 	}
 	std::sort(tents.begin(), tents.end());
 }
 
 
+void SymbolTable::newUndefines(std::vector<const char*>& undefs)
+{
+	// add names referenced since the last call that are still unbound to any names already in undefs
+	for (const char* name : _newUndefines) {
+		if ( isUndefined(name) )
+			undefs.push_back(name);
+	}
+	_newUndefines.clear();
+	// sort so that undefines are in a stable order (not dependent on hashing functions)
+	struct StrcmpSorter strcmpSorter;
+	std::sort(undefs.begin(), undefs.end(), strcmpSorter);
+	undefs.erase(std::unique(undefs.begin(), undefs.end(), CStringEquals()), undefs.end());
+}
+
+
+void SymbolTable::newTentativeDefs(std::vector<const char*>& tents)
+{
+	// add names that became global tentative definitions since the last call and still are to any names already in tents
+	for (const char* name : _newTentativeDefs) {
+		if ( isTentativeDef(name) )
+			tents.push_back(name);
+	}
+	_newTentativeDefs.clear();
+	struct StrcmpSorter strcmpSorter;
+	std::sort(tents.begin(), tents.end(), strcmpSorter);
+	tents.erase(std::unique(tents.begin(), tents.end(), CStringEquals()), tents.end());
+}
+
+
 void SymbolTable::mustPreserveForBitcode(LDSet<const char*>& syms)
 {
-	// return all names in _byNameTable that have no associated atom
-	for (const auto &entry: _byNameTable) {
-		const char* name = entry.first;
-		const ld::Atom* atom = _indirectBindingTable[entry.second];
-		if ( (atom == NULL) || (atom->definition() == ld::Atom::definitionProxy) )
-			syms.insert(name);
+	// return all names in _byNameShards that have no associated atom
+	for (const NameToSlot& byNameTable : _byNameShards) {
+		for (const auto &entry: byNameTable) {
+			const char* name = entry.first;
+			const ld::Atom* atom = _indirectBindingTable[entry.second];
+			if ( (atom == NULL) || (atom->definition() == ld::Atom::definitionProxy) )
+				syms.insert(name);
+		}
 	}
 }
 
 
 bool SymbolTable::hasName(const char* name)			
 { 
-	NameToSlot::iterator pos = _byNameTable.find(name);
-	if ( pos == _byNameTable.end() ) 
+	NameToSlot& byNameTable = this->byNameTable(name);
+	NameToSlot::iterator pos = byNameTable.find(name);
+	if ( pos == byNameTable.end() ) 
 		return false;
 	return (_indirectBindingTable[pos->second] != NULL); 
 }
 
+bool SymbolTable::isUndefined(const char* name)
+{
+	// unlike !hasName(), names no longer in _byNameShards are not undefined
+	NameToSlot& byNameTable = this->byNameTable(name);
+	NameToSlot::iterator pos = byNameTable.find(name);
+	if ( pos == byNameTable.end() ) 
+		return false;
+	return (_indirectBindingTable[pos->second] == NULL); 
+}
+
+bool SymbolTable::isTentativeDef(const char* name)
+{
+	NameToSlot& byNameTable = this->byNameTable(name);
+	NameToSlot::iterator pos = byNameTable.find(name);
+	if ( pos == byNameTable.end() ) 
+		return false;
+	const ld::Atom* atom = _indirectBindingTable[pos->second];
+	return (atom != NULL) && (atom->definition() == ld::Atom::definitionTentative);
+}
+
 // find existing or create new slot
 SymbolTable::IndirectBindingSlot SymbolTable::findSlotForName(const char* name)
 {
-	NameToSlot::iterator pos = _byNameTable.find(name);
-	if ( pos != _byNameTable.end() ) 
+	NameToSlot& byNameTable = this->byNameTable(name);
+	NameToSlot::iterator pos = byNameTable.find(name);
+	if ( pos != byNameTable.end() ) 
 		return pos->second;
 	// create new slot for this name
 	SymbolTable::IndirectBindingSlot slot = _indirectBindingTable.size();
 	_indirectBindingTable.push_back(NULL);
-	_byNameTable[name] = slot;
+	byNameTable[name] = slot;
 	_byNameReverseTable[slot] = name;
+	// a new name starts out unbound, so queue it for the resolver
+	_newUndefines.push_back(name);
 	return slot;
 }
 
 void SymbolTable::removeDeadAtoms()
 {
-	// remove dead atoms from: _byNameTable, _byNameReverseTable, and _indirectBindingTable
-	std::vector<const char*> namesToRemove;
-	for (NameToSlot::iterator it=_byNameTable.begin(); it != _byNameTable.end(); ++it) {
-		IndirectBindingSlot slot = it->second;
-		const ld::Atom* atom = _indirectBindingTable[slot];
-		if ( atom != NULL ) {
-			if ( !atom->live() && !atom->dontDeadStrip() ) {
-				//fprintf(stderr, "removing from symbolTable[%u] %s\n", slot, atom->name());
-				_indirectBindingTable[slot] = NULL;
-				// <rdar://problem/16025786> need to completely remove dead atoms from symbol table
-				_byNameReverseTable.erase(slot);
-				// can't remove while iterating, do it after iteration
-				namesToRemove.push_back(it->first);
+	// remove dead atoms from: _byNameShards, _byNameReverseTable, and _indirectBindingTable
+	for (NameToSlot& byNameTable : _byNameShards) {
+		std::vector<const char*> namesToRemove;
+		for (NameToSlot::iterator it=byNameTable.begin(); it != byNameTable.end(); ++it) {
+			IndirectBindingSlot slot = it->second;
+			const ld::Atom* atom = _indirectBindingTable[slot];
+			if ( atom != NULL ) {
+				if ( !atom->live() && !atom->dontDeadStrip() ) {
+					//fprintf(stderr, "removing from symbolTable[%u] %s\n", slot, atom->name());
+					_indirectBindingTable[slot] = NULL;
+					// <rdar://problem/16025786> need to completely remove dead atoms from symbol table
+					_byNameReverseTable.erase(slot);
+					// can't remove while iterating, do it after iteration
+					namesToRemove.push_back(it->first);
+				}
 			}
 		}
-	}
-	for (std::vector<const char*>::iterator it = namesToRemove.begin(); it != namesToRemove.end(); ++it) {
-		_byNameTable.erase(*it);
+		for (std::vector<const char*>::iterator it = namesToRemove.begin(); it != namesToRemove.end(); ++it) {
+			byNameTable.erase(*it);
+		}
 	}
 
 	// remove dead atoms from _nonLazyPointerTable
@@ -922,14 +1145,14 @@ void SymbolTable::removeDeadUndefs(std::vector<const ld::Atom*>& allAtoms, const
 				const char* name = atom->name();
 				_indirectBindingTable[slot] = NULL;
 				_byNameReverseTable.erase(slot);
-				_byNameTable.erase(name);
+				this->byNameTable(name).erase(name);
 				allAtoms.erase(std::remove(allAtoms.begin(), allAtoms.end(), atom), allAtoms.end());
 			}
 			else if ( atom == nullptr ) {
 				if ( const char* undefName = _byNameReverseTable[slot] ) {
 					// <rdar://problem/55544746> Remove unused undef symbols from symbol table after LTO before doing final resolve
 					_byNameReverseTable.erase(slot);
-					_byNameTable.erase(undefName);
+					this->byNameTable(undefName).erase(undefName);
 				}
 			}
 		}
@@ -95,17 +95,37 @@ private:
 	
 public:
 
+	// names are spread over shards by hash, so that addAtoms() can fill the shards concurrently
+	static const unsigned kNameShardCount = 64;
+
 	class byNameIterator {
 	public:
-		byNameIterator&			operator++(int) { ++_nameTableIterator; return *this; }
+		byNameIterator&			operator++(int) { ++_nameTableIterator; skipEmptyShards(); return *this; }
 		const ld::Atom*			operator*() { return _slotTable[_nameTableIterator->second]; }
-		bool					operator!=(const byNameIterator& lhs) { return _nameTableIterator != lhs._nameTableIterator; }
+		bool					operator!=(const byNameIterator& lhs) { 
+									if ( _shard != lhs._shard )
+										return true;
+									return (_shard != kNameShardCount) && (_nameTableIterator != lhs._nameTableIterator); }
 
 	private:
 		friend class SymbolTable;
-								byNameIterator(NameToSlot::iterator it, std::vector<const ld::Atom*>& indirectTable)
-									: _nameTableIterator(it), _slotTable(indirectTable) {} 
-		
+								byNameIterator(NameToSlot* shards, unsigned shard, std::vector<const ld::Atom*>& indirectTable)
+									: _shards(shards), _shard(shard), _slotTable(indirectTable) {
+										if ( _shard != kNameShardCount ) {
+											_nameTableIterator = _shards[_shard].begin();
+											skipEmptyShards();
+										}
+									}
+		void					skipEmptyShards() {
+									while ( _nameTableIterator == _shards[_shard].end() ) {
+										if ( ++_shard == kNameShardCount )
+											return;
+										_nameTableIterator = _shards[_shard].begin();
+									}
+								}
+
+		NameToSlot*						_shards;
+		unsigned						_shard;
 		NameToSlot::iterator			_nameTableIterator;
 		std::vector<const ld::Atom*>&	_slotTable;
 	};
@@ -113,6 +133,8 @@ public:
 						SymbolTable(const Options& opts, std::vector<const ld::Atom*>& ibt);
 
 	bool				add(const ld::Atom& atom, Options::Treatment duplicates);
+	// add the atoms combined by name and bind all by-name references, for many atoms at once
+	void				addAtoms(const std::vector<const ld::Atom*>& atoms, Options::Treatment duplicates);
 	IndirectBindingSlot	findSlotForName(const char* name);
 	IndirectBindingSlot	findSlotForContent(const ld::Atom* atom, const ld::Atom** existingAtom);
 	IndirectBindingSlot	findSlotForReferences(const ld::Atom* atom, const ld::Atom** existingAtom);
@@ -120,12 +142,16 @@ public:
 	unsigned int		updateCount()						{ return _indirectBindingTable.size(); }
 	void				undefines(std::vector<const char*>& undefines);
 	void				tentativeDefs(std::vector<const char*>& undefines);
+	void				newUndefines(std::vector<const char*>& undefines);
+	void				newTentativeDefs(std::vector<const char*>& tents);
+	bool				isUndefined(const char* name);
+	bool				isTentativeDef(const char* name);
 	void				mustPreserveForBitcode(LDSet<const char*>& syms);
 	void				removeDeadAtoms();
 	bool				hasName(const char* name);
 	bool				hasExternalTentativeDefinitions()	{ return _hasExternalTentativeDefinitions; }
-	byNameIterator		begin()								{ return byNameIterator(_byNameTable.begin(),_indirectBindingTable); }
-	byNameIterator		end()								{ return byNameIterator(_byNameTable.end(),_indirectBindingTable); }
+	byNameIterator		begin()								{ return byNameIterator(_byNameShards, 0, _indirectBindingTable); }
+	byNameIterator		end()								{ return byNameIterator(_byNameShards, kNameShardCount, _indirectBindingTable); }
 	void				printStatistics();
 	void				removeDeadUndefs(std::vector<const ld::Atom *>& allAtoms, const LDSet<const ld::Atom*>& keep);
 
@@ -138,7 +164,16 @@ public:
 
 
 private:
+	struct NameOperation;
+	struct NameShardResult;
+
+	static unsigned			nameShard(const char* name)		{ return (unsigned)(CStringHash()(name) >> 58) & (kNameShardCount-1); }
+	NameToSlot&				byNameTable(const char* name)	{ return _byNameShards[nameShard(name)]; }
 	bool					addByName(const ld::Atom& atom, Options::Treatment duplicates);
+	bool					pickByName(const ld::Atom& newAtom, const ld::Atom& existingAtom, Options::Treatment duplicates,
+										DuplicateSymbols& errors, DuplicateSymbols& warnings);
+	void					fillNameShard(unsigned shard, const std::vector<std::vector<NameOperation>>& operations,
+										size_t chunkCount, Options::Treatment duplicates, NameShardResult& result);
 	bool					addByContent(const ld::Atom& atom);
 	bool					addByReferences(const ld::Atom& atom);
 	void					markCoalescedAway(const ld::Atom* atom);
@@ -146,11 +181,9 @@ private:
     // Tracks duplicated symbols. Each call adds file to the list of files defining symbol.
     // The file list is uniqued per symbol, so calling multiple times for the same symbol/file pair is permitted.
     void                    addDuplicateSymbol(DuplicateSymbols& dups, const char* symbol, const ld::Atom* atom);
-	void 					addDuplicateSymbolError(const char* name, const ld::Atom* atom);
-	void 					addDuplicateSymbolWarning(const char* name, const ld::Atom* atom);
 
 	const Options&					_options;
-	NameToSlot						_byNameTable;
+	NameToSlot						_byNameShards[kNameShardCount];
 	SlotToName						_byNameReverseTable;
 	ContentToSlot					_literal4Table;
 	ContentToSlot					_literal8Table;
@@ -165,6 +198,8 @@ private:
 	ReferencesToSlot				_pointerToCStringTable;
 	std::vector<const ld::Atom*>&	_indirectBindingTable;
 	bool							_hasExternalTentativeDefinitions;
+	std::vector<const char*>		_newUndefines;		// names given a slot since last newUndefines()
+	std::vector<const char*>		_newTentativeDefs;	// names bound to a global tentative since last newTentativeDefs()
 	
     DuplicateSymbols                _duplicateSymbolErrors;
     DuplicateSymbols                _duplicateSymbolWarnings;
@@ -0,0 +1,162 @@
+//
+//  TraceEvents.cpp
+//  ld
+//
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <mach/mach_time.h>
+
+#include <algorithm>
+#include <mutex>
+
+#include "Options.h"
+#include "TraceEvents.h"
+
+namespace ld {
+
+std::atomic<bool> TraceEvents::_s_enabled(false);
+
+static std::mutex							sTraceLock;
+static std::string							sTracePath;
+static uint64_t								sMainThreadID = 0;
+
+
+TraceEvents::Span::Span(const char* name, const char* category, const char* detail)
+	: _recording(TraceEvents::enabled())
+{
+	if ( !_recording )
+		return;
+	_event.name = name;
+	_event.category = category;
+	if ( detail != NULL )
+		_event.detail = detail;
+	_event.startTime = mach_absolute_time();
+}
+
+TraceEvents::Span::~Span()
+{
+	if ( !_recording )
+		return;
+	_event.endTime = mach_absolute_time();
+	TraceEvents::threadEvents().events.push_back(std::move(_event));
+}
+
+void TraceEvents::Span::counter(const char* name, uint64_t value)
+{
+	if ( _recording )
+		_event.counters.emplace_back(name, value);
+}
+
+// every thread's buffer, which are never freed so that write() can run while threads are alive
+std::vector<TraceEvents::ThreadEvents*>& TraceEvents::allThreadEvents()
+{
+	static std::vector<TraceEvents::ThreadEvents*> threads;
+	return threads;
+}
+
+TraceEvents::ThreadEvents& TraceEvents::threadEvents()
+{
+	static thread_local ThreadEvents* events = NULL;
+	if ( events == NULL ) {
+		events = new ThreadEvents();
+		pthread_threadid_np(NULL, &events->threadID);
+		std::lock_guard<std::mutex> guard(sTraceLock);
+		allThreadEvents().push_back(events);
+	}
+	return *events;
+}
+
+void TraceEvents::start(const char* path)
+{
+	sTracePath = path;
+	pthread_threadid_np(NULL, &sMainThreadID);
+	_s_enabled.store(true, std::memory_order_relaxed);
+}
+
+void TraceEvents::addSpan(const char* name, const char* category, uint64_t startTime, uint64_t endTime)
+{
+	if ( !enabled() )
+		return;
+	Event event;
+	event.name = name;
+	event.category = category;
+	event.startTime = startTime;
+	event.endTime = endTime;
+	threadEvents().events.push_back(std::move(event));
+}
+
+static void writeJSONString(FILE* file, const char* str)
+{
+	fputc('"', file);
+	for (const char* s = str; *s != '\0'; ++s) {
+		unsigned char c = *s;
+		if ( (c == '"') || (c == '\\') )
+			fprintf(file, "\\%c", c);
+		else if ( c < 0x20 )
+			fprintf(file, "\\u%04x", c);
+		else
+			fputc(c, file);
+	}
+	fputc('"', file);
+}
+
+void TraceEvents::write()
+{
+	if ( !enabled() )
+		return;
+	FILE* file = fopen(sTracePath.c_str(), "w");
+	if ( file == NULL ) {
+		warning("could not write trace events to %s: %s", sTracePath.c_str(), strerror(errno));
+		return;
+	}
+	mach_timebase_info_data_t timebase;
+	mach_timebase_info(&timebase);
+	// Chrome trace events are in microseconds from any origin, so time starts at the earliest span
+	std::lock_guard<std::mutex> guard(sTraceLock);
+	uint64_t origin = UINT64_MAX;
+	for (const ThreadEvents* thread : allThreadEvents()) {
+		for (const Event& event : thread->events)
+			origin = std::min(origin, event.startTime);
+	}
+	auto microseconds = [&](uint64_t time) -> double {
+		return (double)time * timebase.numer / timebase.denom / 1000.0;
+	};
+
+	const int pid = getpid();
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%llu,\"args\":{\"name\":\"ld\"}}", pid, sMainThreadID);
+	for (const ThreadEvents* thread : allThreadEvents()) {
+		fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%llu,\"args\":{\"name\":\"%s\"}}",
+				pid, thread->threadID, (thread->threadID == sMainThreadID) ? "main" : "worker");
+		for (const Event& event : thread->events) {
+			fprintf(file, ",\n{\"name\":");
+			writeJSONString(file, event.name);
+			fprintf(file, ",\"cat\":");
+			writeJSONString(file, event.category);
+			fprintf(file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%llu,\"args\":{",
+					microseconds(event.startTime - origin), microseconds(event.endTime - event.startTime), pid, thread->threadID);
+			const char* separator = "";
+			if ( !event.detail.empty() ) {
+				fprintf(file, "\"detail\":");
+				writeJSONString(file, event.detail.c_str());
+				separator = ",";
+			}
+			for (const auto& counter : event.counters) {
+				fprintf(file, "%s", separator);
+				writeJSONString(file, counter.first);
+				fprintf(file, ":%llu", counter.second);
+				separator = ",";
+			}
+			fprintf(file, "}}");
+		}
+	}
+	fprintf(file, "\n]}\n");
+	if ( fclose(file) != 0 )
+		warning("could not write trace events to %s: %s", sTracePath.c_str(), strerror(errno));
+}
+
+} // namespace ld
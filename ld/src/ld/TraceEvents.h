@@ -0,0 +1,73 @@
+//
+//  TraceEvents.h
+//  ld
+//
+
+#ifndef __TRACE_EVENTS_H__
+#define __TRACE_EVENTS_H__
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ld {
+
+//
+// TraceEvents records how long each phase of the link took and on which thread, and writes the
+// spans as Chrome trace events that chrome://tracing or Perfetto show as a timeline
+// (-zld_trace_events <path>).  Each thread appends to its own buffer, so recording takes no lock,
+// and until tracing starts a Span costs no more than checking a flag.
+//
+class TraceEvents
+{
+public:
+	struct Event {
+		const char*										name;
+		const char*										category;
+		std::string										detail;
+		uint64_t										startTime;
+		uint64_t										endTime;
+		std::vector<std::pair<const char*, uint64_t>>	counters;
+	};
+
+	// records the time from its construction to its destruction on the current thread
+	class Span
+	{
+	public:
+						Span(const char* name, const char* category, const char* detail=NULL);
+						~Span();
+		// attaches a count (atoms, fixups, bytes, ...) to the span
+		void			counter(const char* name, uint64_t value);
+		bool			recording() const		{ return _recording; }
+
+	private:
+		bool			_recording;
+		Event			_event;
+	};
+
+	// starts recording spans, to be written to path
+	static void			start(const char* path);
+	static bool			enabled()				{ return _s_enabled.load(std::memory_order_relaxed); }
+	// records a span that already ended, such as one from before tracing started
+	static void			addSpan(const char* name, const char* category, uint64_t startTime, uint64_t endTime);
+	// writes all spans recorded so far
+	static void			write();
+
+private:
+	struct ThreadEvents {
+		uint64_t				threadID;
+		std::vector<Event>		events;
+	};
+
+	static ThreadEvents&						threadEvents();
+	static std::vector<ThreadEvents*>&			allThreadEvents();
+
+	static std::atomic<bool>					_s_enabled;
+};
+
+} // namespace ld
+
+#endif // __TRACE_EVENTS_H__
@@ -54,6 +54,7 @@ extern "C" double log2 ( double );
 #include <string>
 #include <vector>
 #include <list>
+#include <memory>
 #include <algorithm>
 #include <unordered_map>
 #include <cxxabi.h>
@@ -68,6 +69,8 @@ extern "C" double log2 ( double );
 #include "Resolver.h"
 #include "OutputFile.h"
 #include "Snapshot.h"
+#include "TraceEvents.h"
+#include "InputCosts.h"
 
 #include "passes/stubs/make_stubs.h"
 #include "passes/dtrace_dof.h"
@@ -1480,18 +1483,52 @@ static void getVMInfo(vm_statistics_data_t& info)
 	}
 }
 
+// runs a pass, recording it in the trace with the number of atoms it leaves
+template <typename O, typename P>
+static void runPass(const char* name, void (*pass)(O& opts, ld::Internal& internal), P& options, ld::Internal& state)
+{
+	ld::TraceEvents::Span span(name, "pass");
+	pass(options, state);
+	if ( span.recording() ) {
+		uint64_t atomCount = 0;
+		for (const ld::Internal::FinalSection* sect : state.sections)
+			atomCount += sect->atoms.size();
+		span.counter("atoms", atomCount);
+	}
+}
+
 static const char *kOriginalPathFlag = "-zld_original_ld_path";
+// zld-only options, each taking one argument, that ld does not understand
+static const char *kZldFlagsWithArgument[] = { kOriginalPathFlag, "-zld_cache_input", "-zld_cache_output", "-zld_tbd_cache", "-zld_uuid_hash", "-zld_write_threads", "-threads", "-zld_trace_events", "-zld_input_costs" };
+static const char *kZldFlagsWithoutArgument[] = { "-zld_prefault_output", "-zld_tail_merge_strings" };
 
 void useFallbackLd(const char *fallbackPath, int argc, const char* argv[], const char *reason);
 void useFallbackLd(const char *fallbackPath, int argc, const char* argv[], const char *reason) {
 	fprintf(stderr, "note: zld does not fully support this invocation and will instead fall back to ld. Support will be added in the future. Reason: %s\n", reason);
 	argv[0] = fallbackPath;
-	for (int i = 0; i < argc; i++) {
-		if (strcmp(kOriginalPathFlag, argv[i]) == 0) {
+	for (int i = 0; i < argc; ) {
+		bool isZldFlag = false;
+		for (const char *flag : kZldFlagsWithArgument) {
+			if (strcmp(flag, argv[i]) == 0)
+				isZldFlag = true;
+		}
+		bool isZldSwitch = false;
+		for (const char *flag : kZldFlagsWithoutArgument) {
+			if (strcmp(flag, argv[i]) == 0)
+				isZldSwitch = true;
+		}
+		if (isZldFlag && i < argc - 1) {
 			for (int j = i; j < argc - 1 /* include null char * terminator */; j++) {
 				argv[j] = argv[j + 2];
 			}
-			break;
+			argc -= 2;
+		} else if (isZldSwitch) {
+			for (int j = i; j < argc /* include null char * terminator */; j++) {
+				argv[j] = argv[j + 1];
+			}
+			argc -= 1;
+		} else {
+			i++;
 		}
 	}
 	execv(fallbackPath, (char * const *)argv);
@@ -1499,7 +1536,8 @@ void useFallbackLd(const char *fallbackPath, int argc, const char* argv[], const
 
 int main(int argc, const char* argv[])
 {
-	tbb::global_control c(tbb::global_control::thread_stack_size, 8 * 1024 * 1024);
+	// input files are parsed on tbb threads, and some parsers use large stack buffers
+	tbb::global_control c(tbb::global_control::thread_stack_size, 16 * 1024 * 1024);
 	const char* archName = NULL;
 	bool showArch = false;
 	try {
@@ -1534,6 +1572,21 @@ int main(int argc, const char* argv[])
 		// create object to track command line arguments
 		Options options(argc, argv);
 
+		// record a timeline of the link from the launch of the tool
+		if ( options.traceEventsPath() != NULL ) {
+			ld::TraceEvents::start(options.traceEventsPath());
+			ld::TraceEvents::addSpan("parse options", "ld", statistics.startTool, mach_absolute_time());
+		}
+
+		// attribute parse time, library probes and output to each input file
+		if ( options.inputCostCount() != 0 )
+			ld::InputCosts::start(options.inputCostCount());
+
+		// all parallel work, whether tbb or pstl on top of it, shares one pool capped by -threads
+		std::unique_ptr<tbb::global_control> threads;
+		if ( options.threadCount() != 0 )
+			threads.reset(new tbb::global_control(tbb::global_control::max_allowed_parallelism, options.threadCount()));
+
 		InternalState state(options);
 		
 		// allow libLTO to be overridden by command line -lto_library
@@ -1566,26 +1619,26 @@ int main(int argc, const char* argv[])
 
 		// run passes
 		statistics.startPasses = mach_absolute_time();
-		ld::passes::objc::doPass(options, state);
-		ld::passes::stubs::doPass(options, state);
-		ld::passes::inits::doPass(options, state);
-		ld::passes::huge::doPass(options, state);
-		ld::passes::got::doPass(options, state);
-		//ld::passes::objc_constants::doPass(options, state);
-		ld::passes::tlvp::doPass(options, state);
-		ld::passes::dylibs::doPass(options, state);	// must be after stubs and GOT passes
-		ld::passes::order::doPass(options, state);
+		runPass("objc", ld::passes::objc::doPass, options, state);
+		runPass("stubs", ld::passes::stubs::doPass, options, state);
+		runPass("inits", ld::passes::inits::doPass, options, state);
+		runPass("huge", ld::passes::huge::doPass, options, state);
+		runPass("got", ld::passes::got::doPass, options, state);
+		//runPass("objc constants", ld::passes::objc_constants::doPass, options, state);
+		runPass("tlvp", ld::passes::tlvp::doPass, options, state);
+		runPass("dylibs", ld::passes::dylibs::doPass, options, state);	// must be after stubs and GOT passes
+		runPass("order", ld::passes::order::doPass, options, state);
 		state.markAtomsOrdered();
-		ld::passes::dedup::doPass(options, state);
-		ld::passes::branch_shim::doPass(options, state);	// must be after stubs
-		ld::passes::branch_island::doPass(options, state);	// must be after stubs and order pass
-		ld::passes::dtrace::doPass(options, state);
-		ld::passes::compact_unwind::doPass(options, state);  // must be after order pass
-		ld::passes::bitcode_bundle::doPass(options, state);  // must be after dylib
+		runPass("dedup", ld::passes::dedup::doPass, options, state);
+		runPass("branch shim", ld::passes::branch_shim::doPass, options, state);	// must be after stubs
+		runPass("branch island", ld::passes::branch_island::doPass, options, state);	// must be after stubs and order pass
+		runPass("dtrace", ld::passes::dtrace::doPass, options, state);
+		runPass("compact unwind", ld::passes::compact_unwind::doPass, options, state);  // must be after order pass
+		runPass("bitcode bundle", ld::passes::bitcode_bundle::doPass, options, state);  // must be after dylib
 
 		// Sort again so that we get the segments in order.
 		state.sortSections();
-		ld::passes::thread_starts::doPass(options, state);  // must be after dylib
+		runPass("thread starts", ld::passes::thread_starts::doPass, options, state);  // must be after dylib
 		
 		// sort final sections
 		state.sortSections();
@@ -1597,6 +1650,15 @@ int main(int argc, const char* argv[])
 		ld::tool::OutputFile out(options, state);
 		out.write(state);
 		statistics.startDone = mach_absolute_time();
+		ld::InputCosts::addOutput(state);
+
+		ld::TraceEvents::addSpan("open input files", "ld", statistics.startInputFileProcessing, statistics.startResolver);
+		ld::TraceEvents::addSpan("resolve symbols", "ld", statistics.startResolver, statistics.startDylibs);
+		ld::TraceEvents::addSpan("build atom list", "ld", statistics.startDylibs, statistics.startPasses);
+		ld::TraceEvents::addSpan("passes", "ld", statistics.startPasses, statistics.startOutput);
+		ld::TraceEvents::addSpan("write output", "ld", statistics.startOutput, statistics.startDone);
+		ld::TraceEvents::write();
+		ld::InputCosts::print();
 		
 		// print statistics
 		//mach_o::relocatable::printCounts();
@@ -1610,6 +1672,16 @@ int main(int argc, const char* argv[])
 			printTime(" build atom list", statistics.startPasses				 -	statistics.startDylibs,				totalTime);
 			printTime(" passess", statistics.startOutput				 -	statistics.startPasses,				totalTime);
 			printTime(" write output", statistics.startDone				 -	statistics.startOutput,				totalTime);
+			for (const auto& encoder : out.linkEditEncodeTimes()) {
+				std::string label = std::string("  ") + encoder.first;
+				printTime(label.c_str(), encoder.second, totalTime);
+			}
+			const std::vector<uint64_t>& writeBusyTimes = out.writeAtomsBusyTimes();
+			for (size_t i = 0; i < writeBusyTimes.size(); ++i) {
+				char label[32];
+				snprintf(label, sizeof(label), "  write atoms thread %zu", i);
+				printTime(label, writeBusyTimes[i], totalTime);
+			}
 			fprintf(stderr, "pageins=%u, pageouts=%u, faults=%u\n", 
 								statistics.vmEnd.pageins-statistics.vmStart.pageins,
 								statistics.vmEnd.pageouts-statistics.vmStart.pageouts, 
@@ -1633,6 +1705,8 @@ int main(int argc, const char* argv[])
 		_exit(0);
 	}
 	catch (const char* msg) {
+		// the timeline of a failed link shows how far it got
+		ld::TraceEvents::write();
 		if ( strstr(msg, "malformed") != NULL )
 			fprintf(stderr, "ld: %s\n", msg);
 		else if ( showArch && (strstr(msg, archName) == NULL) )
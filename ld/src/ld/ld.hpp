@@ -41,6 +41,7 @@
 #include "configure.h"
 #include "MapDefines.h"
 #include "PlatformSupport.h"
+#include "NameInterner.h"
 
 #ifdef __x86_64__
 #include <nmmintrin.h>
@@ -527,6 +528,8 @@ namespace dylib {
 		virtual bool						installPathVersionSpecific() const { return false; }
 		virtual bool						appExtensionSafe() const = 0;
 		virtual void						forEachExportedSymbol(void (^handler)(const char* symbolName, bool weakDef)) const = 0;
+		// true if forEachExportedSymbol() names every symbol justInTimeforEachAtom() can provide (i.e. no re-exports)
+		virtual bool						exportsAreIndexable() const { return false; }
 		virtual bool						hasReExportedDependentsThatProvidedExportAtom() const { return false; }
 		virtual bool						isUnzipperedTwin() const { return false; }
 
@@ -561,9 +564,12 @@ namespace archive {
 												: ld::File(pth, modTime, ord, Archive) { }
 		virtual								~File() {}
 		virtual bool						justInTimeDataOnlyforEachAtom(const char* name, AtomHandler&) const = 0;
-    	virtual void dumpMembersParsed(std::ofstream &stream) const = 0;
+		virtual void						forEachMemberLoaded(void (^handler)(const char* memberName)) const = 0;
 		virtual std::vector<void *> membersToParse(LDSet<std::string> &set) const = 0;
 		virtual void parseMember(void *member) const = 0;
+		virtual void						forEachTableOfContentsName(void (^handler)(const char* symbolName)) const = 0;
+		// member justInTimeforEachAtom(name) would load, or NULL, suitable for parseMember()
+		virtual void*						memberForName(const char* name) const = 0;
 	};
 } // namespace archive 
 
@@ -1345,10 +1351,10 @@ struct CLDStringHash {
 };
 
 // utility classes for using LDMap with c-strings
+// interned names carry their hash, other strings compute the same hash on demand
 struct CStringHash {
 	size_t operator()(const char* __s) const {
-		int len = strlen(__s);
-		return CRCHash(__s, len);
+		return NameInterner::hash(__s);
 	};
 };
 
@@ -1362,7 +1368,14 @@ struct CLDStringEquals
 
 struct CStringEquals
 {
-	bool operator()(const char* left, const char* right) const { return (strcmp(left, right) == 0); }
+	bool operator()(const char* left, const char* right) const {
+		if ( left == right )
+			return true;
+		// each name is interned once, so two different interned pointers never match
+		if ( NameInterner::isInterned(left) && NameInterner::isInterned(right) )
+			return false;
+		return (strcmp(left, right) == 0);
+	}
 };
 
 typedef	LDSet<const char*, ld::CStringHash, ld::CStringEquals>  CStringSet;
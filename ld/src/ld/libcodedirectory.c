@@ -159,6 +159,11 @@ struct _libcd {
     unsigned int hash_types_count;
     _cdhash_for_hash_type_t* cdhashes;
 
+    // page hashes computed ahead of serialization, one byte of validity per page
+    // and hash_types_count * page count * _max_known_hash_len bytes of hashes
+    uint8_t *prehash_valid;
+    uint8_t *prehash_buf;
+
     uint8_t platform_identifier;
 
     char const *team_id;
@@ -416,6 +421,8 @@ libcd_free (libcd *s)
         }
         free(s->hash_types);
         free(s->cdhashes);
+        free(s->prehash_valid);
+        free(s->prehash_buf);
 
         libcd_reset_write_method(s);
         libcd_reset_read_method(s);
@@ -500,6 +507,7 @@ libcd_set_hash_types (libcd *s, int const hash_types[], unsigned int count)
     s->hash_types = calloc(count, sizeof(int));
     memcpy(s->hash_types, hash_types, count*sizeof(int));
     s->hash_types_count = count;
+    libcd_disable_prehashing(s);
     s->cdhashes = realloc(s->cdhashes, count*sizeof(_cdhash_for_hash_type_t));
     memset(s->cdhashes, 0, count*sizeof(_cdhash_for_hash_type_t));
 
@@ -801,10 +809,131 @@ _libcd_hash_page(libcd *s,
     return LIBCD_SERIALIZE_SUCCESS;
 }
 
+static size_t
+_libcd_page_count (libcd *s)
+{
+    return (size_t)((s->image_size + _cs_page_bytes-1) >> _cs_page_shift);
+}
+
+static uint8_t *
+_libcd_prehash_slot (libcd *s, unsigned int hash_type_idx, size_t page_idx)
+{
+    return s->prehash_buf + (hash_type_idx * _libcd_page_count(s) + page_idx) * _max_known_hash_len;
+}
+
+void
+libcd_enable_prehashing (libcd *s)
+{
+    libcd_disable_prehashing(s);
+
+    size_t const page_count = _libcd_page_count(s);
+    if (page_count == 0 || s->hash_types_count == 0) {
+        return;
+    }
+    s->prehash_valid = calloc(page_count, 1);
+    s->prehash_buf = malloc(s->hash_types_count * page_count * _max_known_hash_len);
+    if (s->prehash_valid == NULL || s->prehash_buf == NULL) {
+        libcd_disable_prehashing(s);
+    }
+}
+
+void
+libcd_disable_prehashing (libcd *s)
+{
+    free(s->prehash_valid);
+    free(s->prehash_buf);
+    s->prehash_valid = NULL;
+    s->prehash_buf = NULL;
+}
+
+enum libcd_serialize_ret
+libcd_prehash_pages (libcd *s, size_t first_page, size_t count)
+{
+    if (s->prehash_valid == NULL) {
+        return LIBCD_SERIALIZE_SUCCESS;
+    }
+
+    size_t const page_count = _libcd_page_count(s);
+    size_t const end_page = MIN(first_page + count, page_count);
+
+    for (size_t page_no = first_page; page_no < end_page; page_no++) {
+        for (unsigned int i = 0; i < s->hash_types_count; i++) {
+            struct _hash_info const *hi = _libcd_get_hash_info(s->hash_types[i]);
+            enum libcd_serialize_ret ret = _libcd_hash_page(s, page_no, page_count, hi, _libcd_prehash_slot(s, i, page_no));
+            if (ret != LIBCD_SERIALIZE_SUCCESS) {
+                return ret;
+            }
+        }
+        s->prehash_valid[page_no] = 1;
+    }
+
+    return LIBCD_SERIALIZE_SUCCESS;
+}
+
+enum libcd_serialize_ret
+libcd_prehash_missing_pages (libcd *s, size_t first_page, size_t count)
+{
+    if (s->prehash_valid == NULL) {
+        return LIBCD_SERIALIZE_SUCCESS;
+    }
+
+    size_t const page_count = _libcd_page_count(s);
+    size_t const end_page = MIN(first_page + count, page_count);
+
+    for (size_t page_no = first_page; page_no < end_page; page_no++) {
+        if (s->prehash_valid[page_no]) {
+            continue;
+        }
+        enum libcd_serialize_ret ret = libcd_prehash_pages(s, page_no, 1);
+        if (ret != LIBCD_SERIALIZE_SUCCESS) {
+            return ret;
+        }
+    }
+
+    return LIBCD_SERIALIZE_SUCCESS;
+}
+
+void
+libcd_invalidate_prehashed_pages (libcd *s, size_t first_page, size_t count)
+{
+    if (s->prehash_valid == NULL) {
+        return;
+    }
+
+    size_t const page_count = _libcd_page_count(s);
+    size_t const end_page = MIN(first_page + count, page_count);
+
+    for (size_t page_no = first_page; page_no < end_page; page_no++) {
+        s->prehash_valid[page_no] = 0;
+    }
+}
+
+static enum libcd_serialize_ret
+_libcd_hash_or_copy_page (libcd *s,
+                          size_t page_idx,
+                          size_t page_count,
+                          struct _hash_info const *hi,
+                          int hash_type_idx,
+                          uint8_t* hash_destination)
+{
+    if (hash_type_idx >= 0 && s->prehash_valid != NULL && s->prehash_valid[page_idx]) {
+        memcpy(hash_destination, _libcd_prehash_slot(s, hash_type_idx, page_idx), hi->hash_len);
+        return LIBCD_SERIALIZE_SUCCESS;
+    }
+    return _libcd_hash_page(s, page_idx, page_count, hi, hash_destination);
+}
+
 static enum libcd_serialize_ret
 _libcd_serialize_cd (libcd *s, uint32_t hash_type)
 {
     struct _hash_info const *hi = _libcd_get_hash_info(hash_type);
+    int hash_type_idx = -1;
+    for (unsigned int i = 0; i < s->hash_types_count; i++) {
+        if ((uint32_t)s->hash_types[i] == hash_type) {
+            hash_type_idx = (int)i;
+            break;
+        }
+    }
     size_t cd_size = libcd_cd_size(s, hash_type);
     uint8_t* cd_mem = calloc(1, cd_size);
 
@@ -917,14 +1046,14 @@ _libcd_serialize_cd (libcd *s, uint32_t hash_type)
         if(s->parallel_read && s->parallel_write && !s->parallelization_disabled) {
             dispatch_apply(page_count, DISPATCH_APPLY_AUTO, ^(size_t page_no) {
                 uint8_t* destination = cursor + page_no * hi->hash_len;
-                enum libcd_serialize_ret local_ret = _libcd_hash_page(s, page_no, page_count, hi, destination);
+                enum libcd_serialize_ret local_ret = _libcd_hash_or_copy_page(s, page_no, page_count, hi, hash_type_idx, destination);
                 ret = (ret == LIBCD_SERIALIZE_SUCCESS) ? local_ret : ret;
             });
         } else {
 #endif
             for (size_t page_no = 0; page_no < page_count; page_no++) {
                 uint8_t* destination = cursor + page_no * hi->hash_len;
-                ret = _libcd_hash_page(s, page_no, page_count, hi, destination);
+                ret = _libcd_hash_or_copy_page(s, page_no, page_count, hi, hash_type_idx, destination);
                 if (ret != LIBCD_SERIALIZE_SUCCESS) {
                     break;
                 }
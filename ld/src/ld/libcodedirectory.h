@@ -97,6 +97,18 @@ enum libcd_serialize_ret {
     LIBCD_SERIALIZE_NO_MEM,
 };
 
+// Page hashes can be computed while the image is still being produced: after
+// libcd_enable_prehashing, libcd_prehash_pages may be called concurrently for
+// distinct pages that are final, and libcd_invalidate_prehashed_pages drops the
+// hashes of pages changed afterwards, which libcd_serialize then hashes again.
+// libcd_prehash_missing_pages only hashes the pages that have no valid hash, so
+// a caller can finish them on its own threads before serializing.
+void libcd_enable_prehashing (libcd *s);
+void libcd_disable_prehashing (libcd *s);
+enum libcd_serialize_ret libcd_prehash_pages (libcd *s, size_t first_page, size_t count);
+enum libcd_serialize_ret libcd_prehash_missing_pages (libcd *s, size_t first_page, size_t count);
+void libcd_invalidate_prehashed_pages (libcd *s, size_t first_page, size_t count);
+
 enum libcd_serialize_ret libcd_serialize_as_type (libcd *s, uint32_t type);
 enum libcd_serialize_ret libcd_serialize (libcd *s);
 
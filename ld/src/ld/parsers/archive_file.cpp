@@ -46,6 +46,8 @@
 #include "macho_relocatable_file.h"
 #include "lto_file.h"
 #include "archive_file.h"
+#include "TraceEvents.h"
+#include "InputCosts.h"
 
 
 namespace archive {
@@ -84,9 +86,11 @@ public:
 															ld::File::Ordinal ord, const ParserOptions& opts);
 	virtual											~File() {}
 
-	virtual void dumpMembersParsed(std::ofstream &stream) const;
+	virtual void forEachMemberLoaded(void (^handler)(const char* memberName)) const;
 	virtual std::vector<void *> membersToParse(LDSet<std::string> &set) const;
 	virtual void parseMember(void *member) const;
+	virtual void forEachTableOfContentsName(void (^handler)(const char* symbolName)) const;
+	virtual void* memberForName(const char* name) const;
 	// overrides of ld::File
 	virtual bool										forEachAtom(ld::File::AtomHandler&) const;
 	virtual bool										justInTimeforEachAtom(const char* name, ld::File::AtomHandler&) const;
@@ -118,7 +122,8 @@ private:
 
 	};
 
-	struct MemberState { ld::relocatable::File* file; const Entry *entry; bool logged; bool loaded; uint32_t index;};
+	struct MemberState { ld::relocatable::File* file; const Entry *entry; bool logged; bool loaded; uint32_t index;
+						 bool speculative = false; std::vector<std::string> deferredWarnings; };
 	bool											loadMember(MemberState& state, ld::File::AtomHandler& handler, const char *format, ...) const;
 
 	typedef LDMap<const char*, uint64_t, ld::CStringHash, ld::CStringEquals> NameToOffsetMap;
@@ -128,14 +133,13 @@ private:
 
 	typedef LDOrderedMap<const class Entry*, MemberState> MemberToStateMap;
 
-	MemberState&									makeObjectFileForMember(const Entry* member) const;
+	MemberState&									makeObjectFileForMember(const Entry* member, bool speculative=false) const;
 	bool											memberHasObjCCategories(const Entry* member) const;
 	void											dumpTableOfContents();
 	void											buildHashTable();
 #ifdef SYMDEF_64
 	void											buildHashTable64();
 #endif
-	mutable LDSet<std::string>						_membersParsed;
 	const uint8_t*									_archiveFileContent;
 	uint64_t										_archiveFilelength;
 	const struct ranlib*							_tableOfContents;
@@ -363,7 +367,7 @@ bool File<A>::memberHasObjCCategories(const Entry* member) const
 }
 
 template <typename A>
-typename File<A>::MemberState& File<A>::makeObjectFileForMember(const Entry* member) const
+typename File<A>::MemberState& File<A>::makeObjectFileForMember(const Entry* member, bool speculative) const
 {
 	uint32_t memberIndex = 0;
 	{
@@ -405,6 +409,13 @@ typename File<A>::MemberState& File<A>::makeObjectFileForMember(const Entry* mem
 	strcat(memberPath, memberName);
 	strcat(memberPath, ")");
 	//fprintf(stderr, "using %s from %s\n", memberName, this->path());
+	ld::TraceEvents::Span span(speculative ? "pre-parse archive member" : "parse archive member", "input", memberPath);
+	span.counter("bytes", member->contentSize());
+	// the member is parsed in place, its bytes were mapped with the archive.  A speculative parse is
+	// only charged to the member, and its warnings only printed, if the member is loaded later
+	ld::InputCosts::Parse cost(memberPath, speculative);
+	std::vector<std::string> deferredWarnings;
+	::WarningCapture capture(speculative ? &deferredWarnings : NULL);
 	try {
 		ld::File::Ordinal ordinal = Ordinal::NullOrdinal();
 		const char* mPath = strdup(memberPath);
@@ -423,18 +434,15 @@ typename File<A>::MemberState& File<A>::makeObjectFileForMember(const Entry* mem
 																	ordinal, _objOpts);
 		{
     		std::scoped_lock<std::mutex> guard(_mutex);
-    		_membersParsed.insert(std::string(memberName));
-    		if ( result != NULL ) {
-    			MemberState state = {result, member, false, false, memberIndex};
-    			_instantiatedEntries[member] = state;
-    			return _instantiatedEntries[member];
+    		if ( result == NULL ) {
+    			// see if member is llvm bitcode file
+    			result = lto::parse(member->content(), member->contentSize(),
+    									mPath, member->modificationTime(), ordinal,
+    									_objOpts.architecture, _objOpts.subType, _logAllFiles, _objOpts.verboseOptimizationHints);
     		}
-    		// see if member is llvm bitcode file
-    		result = lto::parse(member->content(), member->contentSize(),
-    								mPath, member->modificationTime(), ordinal,
-    								_objOpts.architecture, _objOpts.subType, _logAllFiles, _objOpts.verboseOptimizationHints);
     		if ( result != NULL ) {
-    			MemberState state = {result, member, false, false, memberIndex};
+    			MemberState state = {result, member, false, false, memberIndex, speculative};
+    			state.deferredWarnings.swap(deferredWarnings);
     			_instantiatedEntries[member] = state;
     			return _instantiatedEntries[member];
     		}
@@ -461,6 +469,14 @@ bool File<A>::loadMember(MemberState& state, ld::File::AtomHandler& handler, con
 			state.logged = true;
 		}
 		state.loaded = true;
+		if ( state.speculative ) {
+			// report what the speculative parse found now, in load order, as if it had just been parsed
+			for (const std::string& message : state.deferredWarnings)
+				warning("%s", message.c_str());
+			ld::InputCosts::loaded(state.file->path());
+			state.deferredWarnings.clear();
+			state.speculative = false;
+		}
 		didSomething = state.file->forEachAtom(handler);
 	}
 	return didSomething;
@@ -542,20 +558,19 @@ bool File<A>::forEachAtom(ld::File::AtomHandler& handler) const
 }
 
 template <typename A>
-void File<A>::dumpMembersParsed(std::ofstream &stream) const {
-	if (_membersParsed.empty()) {
-		return;
-	}
-	
-	stream << path() << "\n";
-	for (auto name : _membersParsed) {
-		stream << "\t" << name << "\n";
+void File<A>::forEachMemberLoaded(void (^handler)(const char* memberName)) const {
+	for (const auto& entry : _instantiatedEntries) {
+		if ( !entry.second.loaded )
+			continue;
+		char memberName[256];
+		entry.first->getName(memberName, sizeof(memberName));
+		handler(memberName);
 	}
 }
 
 template <typename A>
 void File<A>::parseMember(void *member) const {
-	makeObjectFileForMember((const Entry *)member);
+	makeObjectFileForMember((const Entry *)member, true);
 }
 
 template <typename A>
@@ -576,6 +591,27 @@ std::vector<void *> File<A>::membersToParse(LDSet<std::string> &set) const {
 	return membersToParse;
 }
 
+template <typename A>
+void File<A>::forEachTableOfContentsName(void (^handler)(const char* symbolName)) const {
+	// in force load case, all members already loaded, so no name can load anything
+	if ( _alreadyLoadedAll )
+		return;
+	for (const auto& entry : _hashTable) {
+		handler(entry.first);
+	}
+}
+
+template <typename A>
+void* File<A>::memberForName(const char* name) const {
+	// in force load case, all members already loaded
+	if ( _alreadyLoadedAll )
+		return NULL;
+	const auto& pos = _hashTable.find(name);
+	if ( pos == _hashTable.end() )
+		return NULL;
+	return (void*)&_archiveFileContent[pos->second];
+}
+
 template <typename A>
 bool File<A>::justInTimeforEachAtom(const char* name, ld::File::AtomHandler& handler) const
 {
@@ -58,7 +58,7 @@ ImportAtom::ImportAtom(File& f, std::vector<const char*>& imports)
       _file(f)
 {
     for(auto *name : imports)
-        _undefs.emplace_back(0, ld::Fixup::k1of1, ld::Fixup::kindNone, false, strdup(name));
+        _undefs.emplace_back(0, ld::Fixup::k1of1, ld::Fixup::kindNone, false, ld::NameInterner::intern(name));
 }
 
 ld::File* ImportAtom::file() const { return &_file; }
@@ -75,6 +75,8 @@ File::File(const char* path, time_t mTime, ld::File::Ordinal ord, const ld::Vers
       _providedAtom(false),
       _indirectDylibsProcessed(false),
       _platforms(platforms),
+      _lazyExports(false),
+      _recentMisses(),
       _importAtom(nullptr),
       _parentUmbrella(nullptr),
       _swiftVersion(0),
@@ -121,9 +123,35 @@ File::File(const char* path, time_t mTime, ld::File::Ordinal ord, const ld::Vers
     }
 }
 
+File::NameToAtomMap::iterator File::findExport(const char* name) const
+{
+    auto pos = _atoms.find(name);
+    if ( (pos != _atoms.end()) || !_lazyExports )
+        return pos;
+
+    // all $ld$ symbols were added when the dylib was loaded, and hidden ones must never be found
+    if ( (strncmp(name, "$ld$", 4) == 0) || (_ignoreExports.count(name) != 0) )
+        return pos;
+
+    // the same name is usually asked for several times in a row (hasDefinition(), then
+    // justInTimeforEachAtom()), so remember the latest misses in a small direct mapped table
+    const char*& recentMiss = _recentMisses[ld::NameInterner::hash(name) & (kRecentMissCount-1)];
+    if ( (recentMiss != nullptr) && ((recentMiss == name) || (strcmp(recentMiss, name) == 0)) )
+        return pos;
+
+    AtomAndWeak bucket = { nullptr, false, false, 0, nullptr, 0 };
+    if ( !findLazyExport(name, bucket.weakDef, bucket.tlv, bucket.address) ) {
+        recentMiss = ld::NameInterner::intern(name);
+        return pos;
+    }
+    if ( _s_logHashtable )
+        fprintf(stderr, "  adding %s to hash table for %s\n", name, this->path());
+    return _atoms.insert(std::make_pair(ld::NameInterner::intern(name), bucket)).first;
+}
+
 std::pair<bool, bool> File::hasWeakDefinitionImpl(const char* name) const
 {
-    const auto pos = _atoms.find(name);
+    const auto pos = findExport(name);
     if ( pos != this->_atoms.end() )
         return std::make_pair(true, pos->second.weakDef);
 
@@ -140,7 +168,7 @@ std::pair<bool, bool> File::hasWeakDefinitionImpl(const char* name) const
 
 bool File::hasDefinitionImpl(const char* name) const
 {
-    const auto pos = _atoms.find(name);
+    const auto pos = findExport(name);
     if ( pos != this->_atoms.end() )
         return true;
 
@@ -178,7 +206,7 @@ bool File::containsOrReExports(const char* name, AtomAndWeak& atom) const
         return false;
 
     // check myself
-    const auto pos = _atoms.find(name);
+    const auto pos = findExport(name);
     if ( pos != _atoms.end() ) {
         atom = pos->second;
         return true;
@@ -235,6 +263,34 @@ void File::forEachExportedSymbol(void (^handler)(const char* symbolName, bool we
     for (const auto& entry : _atoms) {
         handler(entry.first, entry.second.weakDef);
     }
+    if ( !_lazyExports )
+        return;
+    // the rest are read straight from the trie or cache, without adding them all to _atoms
+    forEachLazyExport(^(const char* name, bool weakDef, bool tlv, uint64_t address) {
+        // $ld$ symbols were already processed, and exports found earlier were listed above
+        if ( (strncmp(name, "$ld$", 4) == 0) || (_ignoreExports.count(name) != 0) || (_atoms.count(name) != 0) )
+            return;
+        handler(ld::NameInterner::intern(name), weakDef);
+    });
+}
+
+bool File::exportsAreIndexable() const
+{
+    // re-export flags are only final once indirect libraries are processed
+    if ( !_indirectDylibsProcessed )
+        return false;
+
+    // enumerating every export would defeat looking them up lazily, so searchLibraries()
+    // probes these with findLazyExport() instead
+    if ( _lazyExports )
+        return false;
+
+    // symbols found through re-exported dylibs are not in _atoms
+    for (const auto &dep : _dependentDylibs) {
+        if ( dep.reExport )
+            return false;
+    }
+    return true;
 }
 
 File* File::createSyntheticDylib(const char* installName, uint32_t version) const {
@@ -260,7 +316,7 @@ void File::addExportedSymbol(const ExportAtom* atom) {
 
 void File::addExportedSymbol(const char *name, bool weakDef, bool tlv, uint64_t address) {
     const char* copiedInstallname = nullptr;
-    const char* copiedName = strdup(name);
+    const char* copiedName = ld::NameInterner::intern(name);
     uint32_t compat_version = 0;
     if ( strncmp(name, "$ld$", 4) == 0 ) {
         //    $ld$ <action> $ <condition> $ <symbol-name>
@@ -316,8 +372,7 @@ void File::addExportedSymbol(const char *name, bool weakDef, bool tlv, uint64_t
             }
             compat_version = Options::parseVersionNumber32(&*compatVersion);
             copiedInstallname = strdup(&*installname);
-            free((void*)copiedName);
-            copiedName = strdup(&*symbol);
+            copiedName = ld::NameInterner::intern(&*symbol);
         }
     }
 
@@ -129,6 +129,7 @@ public:
 	virtual bool							installPathVersionSpecific() const override final { return _installPathOverride; }
 	virtual bool							appExtensionSafe() const override final	{ return _appExtensionSafe; };
     virtual void                            forEachExportedSymbol(void (^handler)(const char* symbolName, bool weakDef)) const override;
+    virtual bool                            exportsAreIndexable() const override;
     virtual bool						    isUnzipperedTwin() const override { return _isUnzipperedTwin; }
     File*                                   createSyntheticDylib(const char* insstallName, uint32_t version) const;
     void                                    addExportedSymbol(const ExportAtom*);
@@ -164,6 +165,7 @@ private:
 	using NameToAtomMap = LDMap<const char*, AtomAndWeak, ld::CStringHash, ld::CStringEquals>;
 	using NameSet = LDSet<const char*, CStringHash, ld::CStringEquals>;
 
+	NameToAtomMap::iterator		findExport(const char* name) const;
 	std::pair<bool, bool>		hasWeakDefinitionImpl(const char* name) const;
     bool                        hasDefinitionImpl(const char* name) const;
 	bool						containsOrReExports(const char* name, AtomAndWeak& atom) const;
@@ -172,16 +174,25 @@ private:
 protected:
 	bool						isPublicLocation(const char* path) const;
 
+	// Dylibs that set _lazyExports leave _atoms partially filled at load time and answer a miss in
+	// _atoms with findLazyExport(); forEachExportedSymbol() reads the others with forEachLazyExport()
+	// without adding them.  The $ld$ meta-data symbols must still be added when the dylib is loaded.
+	virtual bool				findLazyExport(const char* name, bool& weakDef, bool& tlv, uint64_t& address) const { return false; }
+	virtual void				forEachLazyExport(void (^handler)(const char* name, bool weakDef, bool tlv, uint64_t address)) const { }
+
 private:
 	ld::Section							_importProxySection;
 	ld::Section							_flatDummySection;
 	mutable bool						_providedAtom;
 	bool								_indirectDylibsProcessed;
     mutable NameToAtomMap                _atoms;
+	enum { kRecentMissCount = 64 };		// power of two
+	mutable const char*					_recentMisses[kRecentMissCount];	// interned names findLazyExport() just did not find
     ld::VersionSet                      _platforms;
 
 protected:
 	NameSet								_ignoreExports;
+	mutable bool						_lazyExports;
 	std::vector<Dependent>				_dependentDylibs;
 	ImportAtom*						    _importAtom;
 	std::vector<const char*>   			_allowableClients;
@@ -67,7 +67,11 @@ public:
 													bool logAllFiles, const char* installPath,
 													bool indirectDylib, bool usingBitcode, bool internalSDK,
 													bool fromSDK, bool platformMismatchesAreWarning);
-	virtual									~File() noexcept {}
+	virtual									~File() noexcept;
+
+protected:
+	virtual bool		findLazyExport(const char* name, bool& weakDef, bool& tlv, uint64_t& address) const override;
+	virtual void		forEachLazyExport(void (^handler)(const char* name, bool weakDef, bool tlv, uint64_t address)) const override;
 
 private:
 	using P = typename A::P;
@@ -87,6 +91,9 @@ private:
 
 	uint64_t  _fileLength;
 	uint32_t  _linkeditStartOffset;
+	const uint8_t*	_mappedContent;			// kept mapped while exports are looked up in the trie
+	const uint8_t*	_exportsTrieStart;
+	const uint8_t*	_exportsTrieEnd;
 
 };
 
@@ -106,7 +113,8 @@ File<A>::File(const uint8_t* fileContent, uint64_t fileLength, const char* path,
 			  const char* targetInstallPath, bool indirectDylib, bool usingBitcode, bool internalSDK,
 			  bool fromSDK, bool platformMismatchesAreWarning)
 	: Base(strdup(path), mTime, ord, cmdLinePlatforms, allowWeakImports, linkingFlatNamespace,
-		   hoistImplicitPublicDylibs, allowSimToMacOSX, addVers), _fileLength(fileLength), _linkeditStartOffset(0)
+		   hoistImplicitPublicDylibs, allowSimToMacOSX, addVers), _fileLength(fileLength), _linkeditStartOffset(0),
+		   _mappedContent(nullptr), _exportsTrieStart(nullptr), _exportsTrieEnd(nullptr)
 {
 	const macho_header<P>* header = (const macho_header<P>*)fileContent;
 	const uint32_t cmd_count = header->ncmds();
@@ -392,8 +400,18 @@ File<A>::File(const uint8_t* fileContent, uint64_t fileLength, const char* path,
 	else
 		buildExportHashTableFromSymbolTable(dynamicInfo, symbolTable, strings, fileContent);
 	
-	// unmap file
-	munmap((caddr_t)fileContent, fileLength);
+	// unmap file, unless exports will be looked up in its trie
+	if ( this->_lazyExports )
+		_mappedContent = fileContent;
+	else
+		munmap((caddr_t)fileContent, fileLength);
+}
+
+template <typename A>
+File<A>::~File() noexcept
+{
+	if ( _mappedContent != nullptr )
+		munmap((caddr_t)_mappedContent, _fileLength);
 }
 
 template <typename A>
@@ -435,19 +453,61 @@ void File<A>::buildExportHashTableFromExportInfo(uint32_t exportsOffset, uint32_
 												 const uint8_t* fileContent)
 {
 	if ( this->_s_logHashtable )
-		fprintf(stderr, "ld: building hashtable from export trie in %s\n", this->path());
+		fprintf(stderr, "ld: looking up exports in export trie of %s\n", this->path());
 	if ( exportsSize > 0 ) {
 		const uint8_t* start = fileContent + exportsOffset;
 		const uint8_t* end = &start[exportsSize];
 		if ( (exportsOffset + exportsSize) > _fileLength )
 			throwf("malformed mach-o dylib, exports trie extends beyond end of file");
+		// only the $ld$ meta-data symbols are needed up front, everything else is found in the trie on demand
 		std::vector<mach_o::trie::Entry> list;
-		parseTrie(start, end, list);
+		parseTrieWithPrefix(start, end, "$ld$", list);
 		for (const auto &entry : list)
 			this->addSymbol(entry.name,
 							entry.flags & EXPORT_SYMBOL_FLAGS_WEAK_DEFINITION,
 							(entry.flags & EXPORT_SYMBOL_FLAGS_KIND_MASK) == EXPORT_SYMBOL_FLAGS_KIND_THREAD_LOCAL,
 							entry.address);
+		_exportsTrieStart = start;
+		_exportsTrieEnd = end;
+		this->_lazyExports = true;
+	}
+}
+
+template <typename A>
+bool File<A>::findLazyExport(const char* name, bool& weakDef, bool& tlv, uint64_t& address) const
+{
+	mach_o::trie::Entry entry;
+	try {
+		if ( !findTrieEntry(_exportsTrieStart, _exportsTrieEnd, name, entry) )
+			return false;
+	}
+	catch (const char* msg) {
+		throwf("%s in %s", msg, this->path());
+	}
+	weakDef = (entry.flags & EXPORT_SYMBOL_FLAGS_WEAK_DEFINITION);
+	tlv = ((entry.flags & EXPORT_SYMBOL_FLAGS_KIND_MASK) == EXPORT_SYMBOL_FLAGS_KIND_THREAD_LOCAL);
+	address = (pint_t)entry.address;
+	return true;
+}
+
+template <typename A>
+void File<A>::forEachLazyExport(void (^handler)(const char* name, bool weakDef, bool tlv, uint64_t address)) const
+{
+	if ( this->_s_logHashtable )
+		fprintf(stderr, "ld: building hashtable from export trie in %s\n", this->path());
+	std::vector<mach_o::trie::Entry> list;
+	try {
+		parseTrie(_exportsTrieStart, _exportsTrieEnd, list);
+	}
+	catch (const char* msg) {
+		throwf("%s in %s", msg, this->path());
+	}
+	for (const auto &entry : list) {
+		handler(entry.name,
+				entry.flags & EXPORT_SYMBOL_FLAGS_WEAK_DEFINITION,
+				(entry.flags & EXPORT_SYMBOL_FLAGS_KIND_MASK) == EXPORT_SYMBOL_FLAGS_KIND_THREAD_LOCAL,
+				(pint_t)entry.address);
+		free((void*)entry.name);
 	}
 }
 
@@ -819,7 +819,7 @@ public:
 																sct.alignmentForAddress(sym.n_value()),
 																parser.coldFromSymbol(sym)),
 															_size(sz), _objAddress(sym.n_value()), 
-															_name(parser.nameFromSymbol(sym)), _hash(0), 
+															_name(parser.internedNameFromSymbol(sym)), _hash(0), 
 															_fixupsStartIndex(0), _lineInfoStartIndex(0),
 															_unwindInfoStartIndex(0), _fixupsCount(0),  
 															_lineInfoCount(0), _unwindInfoCount(0) { 
@@ -1062,10 +1062,10 @@ public:
 			fixup(src.offsetInAtom, c, k, b, target), atom(src.atom) { src.atom->incrementFixupCount(); }
 			
 		FixupInAtom(const SourceLocation& src, ld::Fixup::Cluster c, ld::Fixup::Kind k, bool wi, const char* name) :
-			fixup(src.offsetInAtom, c, k, wi, name), atom(src.atom) { src.atom->incrementFixupCount(); }
+			fixup(src.offsetInAtom, c, k, wi, ld::NameInterner::intern(name)), atom(src.atom) { src.atom->incrementFixupCount(); }
 					
 		FixupInAtom(const SourceLocation& src, ld::Fixup::Cluster c, ld::Fixup::Kind k, ld::Fixup::TargetBinding b, const char* name) :
-			fixup(src.offsetInAtom, c, k, b, name), atom(src.atom) { src.atom->incrementFixupCount(); }
+			fixup(src.offsetInAtom, c, k, b, ld::NameInterner::intern(name)), atom(src.atom) { src.atom->incrementFixupCount(); }
 					
 		FixupInAtom(const SourceLocation& src, ld::Fixup::Cluster c, ld::Fixup::Kind k, uint64_t addend) :
 			fixup(src.offsetInAtom, c, k, addend), atom(src.atom) { src.atom->incrementFixupCount(); }
@@ -1117,6 +1117,7 @@ public:
 	uint32_t										indirectSymbol(uint32_t indirectIndex);
 	const macho_nlist<P>&							symbolFromIndex(uint32_t index);
 	const char*										nameFromSymbol(const macho_nlist<P>& sym);
+	const char*										internedNameFromSymbol(const macho_nlist<P>& sym);
 	ld::Atom::Scope									scopeFromSymbol(const macho_nlist<P>& sym);
 	static ld::Atom::Definition						definitionFromSymbol(const macho_nlist<P>& sym);
 	static ld::Atom::Combine						combineFromSymbol(const macho_nlist<P>& sym);
@@ -2426,8 +2427,8 @@ void Parser<A>::appendAliasAtoms(uint8_t* p)
 		if ( (sym.n_type() & N_EXT) == 0 ) 
 			continue;
 
-		const char* symbolName = this->nameFromSymbol(sym);
-		const char* aliasOfName = &_strings[sym.n_value()];
+		const char* symbolName = this->internedNameFromSymbol(sym);
+		const char* aliasOfName = ld::NameInterner::intern(&_strings[sym.n_value()]);
 		bool isHiddenVisibility = (sym.n_type() & N_PEXT);
 		AliasAtom* allocatedSpace = (AliasAtom*)p;
 		new (allocatedSpace) AliasAtom(symbolName, isHiddenVisibility, _file, aliasOfName);
@@ -3377,7 +3378,7 @@ uint32_t TentativeDefinitionSection<A>::appendAtoms(class Parser<A>& parser, uin
 					alignP2 = parser.maxDefaultCommonAlignment();
 			}
 			Atom<A>* allocatedSpace = (Atom<A>*)p;
-			new (allocatedSpace) Atom<A>(*this, parser.nameFromSymbol(sym), (pint_t)ULLONG_MAX, size,
+			new (allocatedSpace) Atom<A>(*this, parser.internedNameFromSymbol(sym), (pint_t)ULLONG_MAX, size,
 										ld::Atom::definitionTentative,  ld::Atom::combineByName, 
 										parser.scopeFromSymbol(sym), ld::Atom::typeZeroFill, ld::Atom::symbolTableIn, 
 										parser.dontDeadStripFromSymbol(sym), false, false, ld::Atom::Alignment(alignP2) );
@@ -3497,6 +3498,16 @@ const char* Parser<A>::nameFromSymbol(const macho_nlist<P>& sym)
 	return &_strings[strOffset];
 }
 
+template <typename A>
+const char* Parser<A>::internedNameFromSymbol(const macho_nlist<P>& sym)
+{
+	// only external names are looked up by name, so local labels keep pointing into the string table
+	const char* name = nameFromSymbol(sym);
+	if ( (sym.n_type() & N_EXT) == 0 )
+		return name;
+	return ld::NameInterner::intern(name);
+}
+
 template <typename A>
 ld::Atom::Scope Parser<A>::scopeFromSymbol(const macho_nlist<P>& sym)
 {
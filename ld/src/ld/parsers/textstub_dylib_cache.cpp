@@ -0,0 +1,312 @@
+//
+//  textstub_dylib_cache.cpp
+//  ld
+//
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "NameInterner.h"
+#include "textstub_dylib_cache.hpp"
+
+namespace textstub {
+namespace dylib {
+
+// bump whenever the layout of any cache structure, or NameInterner::hash(), changes
+static const uint32_t	kCacheVersion = 2;
+static const char		kCacheMagic[8] = { 'z', 'l', 'd', 't', 'b', 'd', 'c', 'h' };
+
+
+std::string StubCache::entryPath(const char* cacheDir, const Key& key)
+{
+	// everything TAPI's answer depends on, other than the .tbd's content which the entry itself records
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	auto addBytes = [&](const void* bytes, size_t length) {
+		for (size_t i=0; i < length; ++i) {
+			hash ^= ((const uint8_t*)bytes)[i];
+			hash *= 0x100000001b3ULL;
+		}
+	};
+	addBytes(key.path, strlen(key.path)+1);
+	addBytes(&key.cpuType, sizeof(key.cpuType));
+	addBytes(&key.cpuSubType, sizeof(key.cpuSubType));
+	addBytes(&key.parsingFlags, sizeof(key.parsingFlags));
+	addBytes(&key.minOSVersion, sizeof(key.minOSVersion));
+	addBytes(&key.platform, sizeof(key.platform));
+	addBytes(key.toolVersion, strlen(key.toolVersion)+1);
+	char leafName[32];
+	snprintf(leafName, sizeof(leafName), "/%016llx.tbdcache", (unsigned long long)hash);
+	return std::string(cacheDir) + leafName;
+}
+
+// anyone who can write to the directory or an entry could make every link of this user trust
+// exports they made up, so both must belong to this user and be writable only by them
+bool StubCache::trustedDirectory(const char* cacheDir, bool create)
+{
+	struct stat statBuffer;
+	if ( ::lstat(cacheDir, &statBuffer) != 0 ) {
+		if ( !create || (errno != ENOENT) || (::mkdir(cacheDir, 0700) != 0) || (::lstat(cacheDir, &statBuffer) != 0) )
+			return false;
+	}
+	return S_ISDIR(statBuffer.st_mode) && (statBuffer.st_uid == ::geteuid()) && ((statBuffer.st_mode & (S_IWGRP|S_IWOTH)) == 0);
+}
+
+StubCache::StubCache(const uint8_t* content, size_t size)
+	: _mappedContent(content), _mappedSize(size), _header((const Header*)content)
+{
+	_slots = (const ExportSlot*)&_mappedContent[sizeof(Header)];
+	const uint32_t* lists = (const uint32_t*)&_slots[_header->exportSlotCount];
+	for (unsigned kind=0; kind < kListCount; ++kind) {
+		_lists[kind] = lists;
+		lists += _header->listCounts[kind];
+	}
+	_strings = (const char*)lists;
+}
+
+StubCache::~StubCache()
+{
+	::munmap((void*)_mappedContent, _mappedSize);
+}
+
+const char* StubCache::string(uint32_t offset) const
+{
+	// export slots are not validated up front, so an out of range name just never matches
+	return (offset < _header->stringPoolSize) ? &_strings[offset] : "";
+}
+
+StubCache* StubCache::open(const char* cacheDir, const Key& key)
+{
+	if ( !trustedDirectory(cacheDir, false) )
+		return NULL;
+	std::string path = entryPath(cacheDir, key);
+	int fd = ::open(path.c_str(), O_RDONLY | O_NOFOLLOW, 0);
+	if ( fd == -1 )
+		return NULL;
+	struct stat statBuffer;
+	if ( (::fstat(fd, &statBuffer) != 0) || !S_ISREG(statBuffer.st_mode) || (statBuffer.st_uid != ::geteuid())
+		|| ((statBuffer.st_mode & (S_IWGRP|S_IWOTH)) != 0) || (statBuffer.st_size < (off_t)sizeof(Header)) ) {
+		::close(fd);
+		return NULL;
+	}
+	void* p = ::mmap(NULL, statBuffer.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if ( p == MAP_FAILED )
+		return NULL;
+
+	// an entry that does not check out is ignored and will be replaced by the next save()
+	const Header* header = (const Header*)p;
+	uint64_t expectedSize = sizeof(Header) + (uint64_t)header->exportSlotCount * sizeof(ExportSlot) + header->stringPoolSize;
+	for (unsigned kind=0; kind < kListCount; ++kind)
+		expectedSize += (uint64_t)header->listCounts[kind] * sizeof(uint32_t);
+	bool valid = (memcmp(header->magic, kCacheMagic, sizeof(kCacheMagic)) == 0)
+				&& (header->version == kCacheVersion)
+				&& (header->cpuType == (uint32_t)key.cpuType)
+				&& (header->cpuSubType == (uint32_t)key.cpuSubType)
+				&& (header->parsingFlags == key.parsingFlags)
+				&& (header->minOSVersion == key.minOSVersion)
+				&& (header->platform == key.platform)
+				&& (header->modTime == (int64_t)key.modTime)
+				&& (header->fileLength == key.fileLength)
+				&& (expectedSize == (uint64_t)statBuffer.st_size)
+				&& (header->exportSlotCount != 0)
+				&& ((header->exportSlotCount & (header->exportSlotCount-1)) == 0)
+				&& (header->stringPoolSize != 0);
+	StubCache* cache = valid ? new StubCache((const uint8_t*)p, statBuffer.st_size) : NULL;
+	if ( cache != NULL ) {
+		const uint32_t poolSize = header->stringPoolSize;
+		valid = (cache->_strings[poolSize-1] == '\0')
+				&& (header->pathOffset < poolSize) && (strcmp(&cache->_strings[header->pathOffset], key.path) == 0)
+				&& (header->installNameOffset < poolSize) && (header->parentFrameworkNameOffset < poolSize)
+				&& (header->toolVersionOffset < poolSize) && (strcmp(&cache->_strings[header->toolVersionOffset], key.toolVersion) == 0);
+		for (unsigned kind=kListAllowableClients; valid && (kind < kListMetaDataExports); ++kind) {
+			for (uint32_t i=0; valid && (i < header->listCounts[kind]); ++i)
+				valid = (cache->_lists[kind][i] < poolSize);
+		}
+		for (uint32_t i=0; valid && (i < header->listCounts[kListMetaDataExports]); ++i)
+			valid = (cache->_lists[kListMetaDataExports][i] < header->exportSlotCount);
+		if ( !valid ) {
+			delete cache;
+			cache = NULL;
+		}
+	}
+	else {
+		::munmap(p, statBuffer.st_size);
+	}
+	return cache;
+}
+
+void StubCache::getContents(StubContents& contents) const
+{
+	contents.installName				= string(_header->installNameOffset);
+	contents.parentFrameworkName		= (_header->parentFrameworkNameOffset != 0) ? string(_header->parentFrameworkNameOffset) : NULL;
+	contents.currentVersion				= _header->currentVersion;
+	contents.compatibilityVersion		= _header->compatibilityVersion;
+	contents.swiftVersion				= _header->swiftVersion;
+	contents.installNameVersionSpecific	= (_header->flags & kFlagVersionSpecific);
+	contents.applicationExtensionSafe	= (_header->flags & kFlagAppExtensionSafe);
+	contents.hasAllowableClients		= (_header->flags & kFlagHasAllowableClients);
+	contents.hasWeakDefinedExports		= (_header->flags & kFlagWeakDefinedExports);
+	contents.hasReexportedLibraries		= (_header->flags & kFlagReexportedLibraries);
+	contents.hasTwoLevelNamespace		= (_header->flags & kFlagTwoLevelNamespace);
+	contents.platforms.assign(list(kListPlatforms), list(kListPlatforms) + _header->listCounts[kListPlatforms]);
+	auto addStrings = [&](unsigned kind, std::vector<const char*>& strings) {
+		strings.reserve(_header->listCounts[kind]);
+		for (uint32_t i=0; i < _header->listCounts[kind]; ++i)
+			strings.push_back(string(list(kind)[i]));
+	};
+	addStrings(kListAllowableClients, contents.allowableClients);
+	addStrings(kListReexportedLibraries, contents.reexportedLibraries);
+	addStrings(kListIgnoreExports, contents.ignoreExports);
+	addStrings(kListUndefineds, contents.undefineds);
+	for (uint32_t i=0; i < _header->listCounts[kListMetaDataExports]; ++i) {
+		const ExportSlot& slot = _slots[list(kListMetaDataExports)[i]];
+		contents.exports.push_back({ string(slot.nameOffset), (slot.flags & kExportWeakDef) != 0, (slot.flags & kExportThreadLocal) != 0 });
+	}
+}
+
+bool StubCache::findExport(const char* name, bool& weakDef, bool& tlv) const
+{
+	const uint64_t hash = ld::NameInterner::hash(name);
+	const uint32_t mask = _header->exportSlotCount - 1;
+	for (uint32_t i=(hash & mask), probes=0; probes <= mask; i=((i+1) & mask), ++probes) {
+		const ExportSlot& slot = _slots[i];
+		if ( slot.nameOffset == 0 )
+			return false;
+		if ( (slot.hash == hash) && (strcmp(string(slot.nameOffset), name) == 0) ) {
+			weakDef = (slot.flags & kExportWeakDef);
+			tlv = (slot.flags & kExportThreadLocal);
+			return true;
+		}
+	}
+	return false;
+}
+
+void StubCache::forEachExport(void (^handler)(const char* name, bool weakDef, bool tlv)) const
+{
+	for (uint32_t i=0; i < _header->exportSlotCount; ++i) {
+		const ExportSlot& slot = _slots[i];
+		if ( slot.nameOffset != 0 )
+			handler(string(slot.nameOffset), (slot.flags & kExportWeakDef), (slot.flags & kExportThreadLocal));
+	}
+}
+
+void StubCache::save(const char* cacheDir, const Key& key, const StubContents& contents)
+{
+	// offset 0 of the string pool is the empty string
+	std::string strings(1, '\0');
+	auto addString = [&](const char* str) -> uint32_t {
+		if ( (str == NULL) || (str[0] == '\0') )
+			return 0;
+		uint32_t offset = (uint32_t)strings.size();
+		strings.append(str);
+		strings.push_back('\0');
+		return offset;
+	};
+
+	Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+	header.version						= kCacheVersion;
+	header.cpuType						= (uint32_t)key.cpuType;
+	header.cpuSubType					= (uint32_t)key.cpuSubType;
+	header.parsingFlags					= key.parsingFlags;
+	header.minOSVersion					= key.minOSVersion;
+	header.platform						= key.platform;
+	header.modTime						= key.modTime;
+	header.fileLength					= key.fileLength;
+	header.pathOffset					= addString(key.path);
+	header.toolVersionOffset			= addString(key.toolVersion);
+	header.installNameOffset			= addString(contents.installName);
+	header.parentFrameworkNameOffset	= addString(contents.parentFrameworkName);
+	header.currentVersion				= contents.currentVersion;
+	header.compatibilityVersion			= contents.compatibilityVersion;
+	header.swiftVersion					= contents.swiftVersion;
+	header.flags						= (contents.installNameVersionSpecific ? kFlagVersionSpecific : 0)
+										| (contents.applicationExtensionSafe ? kFlagAppExtensionSafe : 0)
+										| (contents.hasAllowableClients ? kFlagHasAllowableClients : 0)
+										| (contents.hasWeakDefinedExports ? kFlagWeakDefinedExports : 0)
+										| (contents.hasReexportedLibraries ? kFlagReexportedLibraries : 0)
+										| (contents.hasTwoLevelNamespace ? kFlagTwoLevelNamespace : 0);
+
+	std::vector<uint32_t> lists[kListCount];
+	lists[kListPlatforms] = contents.platforms;
+	auto addStrings = [&](unsigned kind, const std::vector<const char*>& strs) {
+		for (const char* str : strs)
+			lists[kind].push_back(addString(str));
+	};
+	addStrings(kListAllowableClients, contents.allowableClients);
+	addStrings(kListReexportedLibraries, contents.reexportedLibraries);
+	addStrings(kListIgnoreExports, contents.ignoreExports);
+	addStrings(kListUndefineds, contents.undefineds);
+
+	// keep the export table at most half full so probe sequences stay short
+	uint32_t slotCount = 2;
+	while ( slotCount < 2 * contents.exports.size() )
+		slotCount *= 2;
+	std::vector<ExportSlot> slots(slotCount, ExportSlot{ 0, 0, 0 });
+	for (const StubContents::Export& exp : contents.exports) {
+		if ( exp.name[0] == '\0' )
+			continue;
+		const uint64_t hash = ld::NameInterner::hash(exp.name, strlen(exp.name));
+		uint32_t i = hash & (slotCount-1);
+		while ( (slots[i].nameOffset != 0) && ((slots[i].hash != hash) || (strcmp(&strings[slots[i].nameOffset], exp.name) != 0)) )
+			i = (i+1) & (slotCount-1);
+		if ( slots[i].nameOffset != 0 )
+			continue;
+		slots[i].hash		= hash;
+		slots[i].nameOffset	= addString(exp.name);
+		slots[i].flags		= (exp.weakDef ? kExportWeakDef : 0) | (exp.tlv ? kExportThreadLocal : 0);
+		if ( strncmp(exp.name, "$ld$", 4) == 0 )
+			lists[kListMetaDataExports].push_back(i);
+	}
+	if ( strings.size() > UINT32_MAX )
+		return;
+	header.exportSlotCount = slotCount;
+	header.stringPoolSize = (uint32_t)strings.size();
+	for (unsigned kind=0; kind < kListCount; ++kind)
+		header.listCounts[kind] = (uint32_t)lists[kind].size();
+
+	std::vector<uint8_t> content;
+	auto append = [&](const void* bytes, size_t length) {
+		content.insert(content.end(), (const uint8_t*)bytes, (const uint8_t*)bytes + length);
+	};
+	append(&header, sizeof(header));
+	append(slots.data(), slots.size() * sizeof(ExportSlot));
+	for (unsigned kind=0; kind < kListCount; ++kind)
+		append(lists[kind].data(), lists[kind].size() * sizeof(uint32_t));
+	append(strings.data(), strings.size());
+
+	// write next to the entry and rename over it, so readers only ever see a complete entry
+	if ( !trustedDirectory(cacheDir, true) )
+		return;
+	std::string path = entryPath(cacheDir, key);
+	std::string tempTemplate = path + ".XXXXXX";
+	std::vector<char> tempPath(tempTemplate.begin(), tempTemplate.end());
+	tempPath.push_back('\0');
+	int fd = ::mkstemp(tempPath.data());
+	if ( fd == -1 )
+		return;
+	bool written = true;
+	for (size_t offset=0; written && (offset < content.size()); ) {
+		ssize_t amount = ::write(fd, &content[offset], content.size() - offset);
+		if ( amount <= 0 )
+			written = false;
+		else
+			offset += amount;
+	}
+	if ( (::close(fd) != 0) || !written || (::rename(tempPath.data(), path.c_str()) != 0) )
+		::unlink(tempPath.data());
+}
+
+} // namespace dylib
+} // namespace textstub
@@ -0,0 +1,141 @@
+//
+//  textstub_dylib_cache.hpp
+//  ld
+//
+
+#ifndef __TEXTSTUB_DYLIB_CACHE_H__
+#define __TEXTSTUB_DYLIB_CACHE_H__
+
+#include <stdint.h>
+#include <time.h>
+#include <mach/machine.h>
+
+#include <string>
+#include <vector>
+
+namespace textstub {
+namespace dylib {
+
+//
+// The parts of a text-based stub the linker uses, with TAPI's $ld$ rewrites for the deployment
+// target already applied.  Strings point into the tapi::LinkerInterfaceFile or into a mapped cache.
+//
+struct StubContents
+{
+	struct Export {
+		const char*		name;
+		bool			weakDef;
+		bool			tlv;
+	};
+
+	const char*					installName;
+	const char*					parentFrameworkName;		// NULL if none
+	uint32_t					currentVersion;
+	uint32_t					compatibilityVersion;
+	uint32_t					swiftVersion;
+	bool						installNameVersionSpecific;
+	bool						applicationExtensionSafe;
+	bool						hasAllowableClients;
+	bool						hasWeakDefinedExports;
+	bool						hasReexportedLibraries;
+	bool						hasTwoLevelNamespace;
+	std::vector<uint32_t>		platforms;
+	std::vector<const char*>	allowableClients;
+	std::vector<const char*>	reexportedLibraries;
+	std::vector<const char*>	ignoreExports;
+	std::vector<const char*>	undefineds;
+	// every export when read from TAPI, only the $ld$ ones when read from a cache,
+	// which answers lookups of all others from its own table
+	std::vector<Export>			exports;
+};
+
+
+//
+// StubCache keeps one file per parsed .tbd in a cache directory, so SDK stubs that do not change
+// between links are not parsed by TAPI every time.  Each file is named by a hash of everything
+// TAPI's result depends on, records the .tbd's path, mtime and size, and holds the exports in an
+// open addressed hash table that is queried in place from the mapped file.  Files are written to
+// a temporary name and renamed into place, so readers never see a partial entry.  Only a directory
+// and entries owned by the current user, and writable by no one else, are trusted.
+//
+class StubCache
+{
+public:
+	struct Key {
+		const char*		path;
+		time_t			modTime;
+		uint64_t		fileLength;
+		cpu_type_t		cpuType;
+		cpu_subtype_t	cpuSubType;
+		uint32_t		parsingFlags;
+		uint32_t		minOSVersion;
+		uint32_t		platform;
+		const char*		toolVersion;		// linker and libtapi versions, which decide how stubs are read
+	};
+
+	// maps the entry for key from cacheDir, NULL if there is none or it is stale or malformed
+	static StubCache*		open(const char* cacheDir, const Key& key);
+	// writes contents as the entry for key, any error just leaves the cache without it
+	static void				save(const char* cacheDir, const Key& key, const StubContents& contents);
+
+							~StubCache();
+
+	void					getContents(StubContents& contents) const;
+	bool					findExport(const char* name, bool& weakDef, bool& tlv) const;
+	void					forEachExport(void (^handler)(const char* name, bool weakDef, bool tlv)) const;
+
+private:
+	enum { kListPlatforms, kListAllowableClients, kListReexportedLibraries, kListIgnoreExports,
+		   kListUndefineds, kListMetaDataExports, kListCount };
+	enum { kFlagVersionSpecific=1, kFlagAppExtensionSafe=2, kFlagHasAllowableClients=4,
+		   kFlagWeakDefinedExports=8, kFlagReexportedLibraries=16, kFlagTwoLevelNamespace=32 };
+	enum { kExportWeakDef=1, kExportThreadLocal=2 };
+
+	struct Header {
+		char		magic[8];
+		uint32_t	version;
+		uint32_t	cpuType;
+		uint32_t	cpuSubType;
+		uint32_t	parsingFlags;
+		uint32_t	minOSVersion;
+		uint32_t	platform;
+		int64_t		modTime;
+		uint64_t	fileLength;
+		uint32_t	pathOffset;
+		uint32_t	installNameOffset;
+		uint32_t	parentFrameworkNameOffset;
+		uint32_t	currentVersion;
+		uint32_t	compatibilityVersion;
+		uint32_t	swiftVersion;
+		uint32_t	flags;
+		uint32_t	listCounts[kListCount];
+		uint32_t	exportSlotCount;			// power of two
+		uint32_t	stringPoolSize;
+		uint32_t	toolVersionOffset;
+	};
+
+	struct ExportSlot {
+		uint64_t	hash;
+		uint32_t	nameOffset;					// 0 for an empty slot
+		uint32_t	flags;
+	};
+
+							StubCache(const uint8_t* content, size_t size);
+
+	static std::string		entryPath(const char* cacheDir, const Key& key);
+	static bool				trustedDirectory(const char* cacheDir, bool create);
+	const char*				string(uint32_t offset) const;
+	const uint32_t*			list(unsigned kind) const		{ return _lists[kind]; }
+
+	const uint8_t*			_mappedContent;
+	size_t					_mappedSize;
+	const Header*			_header;
+	const ExportSlot*		_slots;
+	const uint32_t*			_lists[kListCount];
+	const char*				_strings;
+};
+
+} // namespace dylib
+} // namespace textstub
+
+#endif // __TEXTSTUB_DYLIB_CACHE_H__
@@ -33,12 +33,22 @@
 #include "MachOFileAbstraction.hpp"
 #include "MachOTrie.hpp"
 #include "generic_dylib_file.hpp"
+#include "textstub_dylib_cache.hpp"
 #include "textstub_dylib_file.hpp"
 
+extern const char ldVersionString[];
+
 
 namespace textstub {
 namespace dylib {
 
+// a different linker or libtapi may read the same stub differently, so cache entries are kept per version
+static const char* stubCacheToolVersion()
+{
+	static const std::string version = std::string(ldVersionString) + tapi::Version::getFullVersionAsString();
+	return version.c_str();
+}
+
 //
 // The reader for a dylib extracts all exported symbols names from the memory-mapped
 // dylib, builds a hash table, then unmaps the file.  This is an important memory
@@ -71,16 +81,21 @@ public:
 	// overrides of generic::dylib::File
 	virtual void	processIndirectLibraries(ld::dylib::File::DylibHandler*, bool addImplicitDylibs) override final;
 
+protected:
+	virtual bool	findLazyExport(const char* name, bool& weakDef, bool& tlv, uint64_t& address) const override;
+	virtual void	forEachLazyExport(void (^handler)(const char* name, bool weakDef, bool tlv, uint64_t address)) const override;
+
 private:
-	void				init(tapi::LinkerInterfaceFile* file, const Options *opts, bool buildingForSimulator,
+	void				init(const StubContents& contents, const Options *opts, bool buildingForSimulator,
 									 bool indirectDylib, bool linkingFlatNamespace, bool linkingMainExecutable,
 									 const char *path, const ld::VersionSet& platforms, const char *targetInstallPath,
 									 bool usingBitcode, bool internalSDK, bool fromSDK, bool platformMismatchesAreWarning);
-	void				buildExportHashTable(const tapi::LinkerInterfaceFile* file);
+	void				buildExportHashTable(const StubContents& contents);
 	static bool useSimulatorVariant();
 	
 	const Options* _opts;
 	tapi::LinkerInterfaceFile* _interface;
+	std::unique_ptr<StubCache> _cache;		// set if the stub was loaded from the tbd cache instead of TAPI
 };
 
 template <> bool File<x86>::useSimulatorVariant() { return true; }
@@ -138,6 +153,35 @@ static ld::VersionSet mapPlatform(tapi::Platform platform, bool useSimulatorVari
 	return platforms;
 }
 
+static void getContents(const tapi::LinkerInterfaceFile* file, StubContents& contents)
+{
+	contents.installName = file->getInstallName().c_str();
+	contents.parentFrameworkName = file->getParentFrameworkName().empty() ? nullptr : file->getParentFrameworkName().c_str();
+	contents.currentVersion = file->getCurrentVersion();
+	contents.compatibilityVersion = file->getCompatibilityVersion();
+	contents.swiftVersion = file->getSwiftVersion();
+	contents.installNameVersionSpecific = file->isInstallNameVersionSpecific();
+	contents.applicationExtensionSafe = file->isApplicationExtensionSafe();
+	contents.hasAllowableClients = file->hasAllowableClients();
+	contents.hasWeakDefinedExports = file->hasWeakDefinedExports();
+	contents.hasReexportedLibraries = file->hasReexportedLibraries();
+	contents.hasTwoLevelNamespace = file->hasTwoLevelNamespace();
+	for (const auto &platform : file->getPlatformSet())
+		contents.platforms.push_back((uint32_t)platform);
+	for (const auto &client : file->allowableClients())
+		contents.allowableClients.push_back(client.c_str());
+	for (const auto& reexport : file->reexportedLibraries())
+		contents.reexportedLibraries.push_back(reexport.c_str());
+	for (const auto& symbol : file->ignoreExports())
+		contents.ignoreExports.push_back(symbol.c_str());
+	contents.undefineds.reserve(file->undefineds().size());
+	for (const auto &sym : file->undefineds())
+		contents.undefineds.push_back(sym.getName().c_str());
+	contents.exports.reserve(file->exports().size());
+	for (const auto &sym : file->exports())
+		contents.exports.push_back({ sym.getName().c_str(), sym.isWeakDefined(), sym.isThreadLocalValue() });
+}
+
 template <typename A>
 File<A>::File(const char* path, const uint8_t* fileContent, uint64_t fileLength, const Options *opts,
 		  time_t mTime, ld::File::Ordinal ord, bool linkingFlatNamespace,
@@ -147,43 +191,63 @@ File<A>::File(const char* path, const uint8_t* fileContent, uint64_t fileLength,
 		  bool buildingForSimulator, bool logAllFiles, const char* targetInstallPath,
 		  bool indirectDylib, bool usingBitcode, bool internalSDK, bool fromSDK, bool platformMismatchesAreWarning)
 : Base(strdup(path), mTime, ord, platforms, allowWeakImports, linkingFlatNamespace,
-	   hoistImplicitPublicDylibs, allowSimToMacOSX, addVers)
+	   hoistImplicitPublicDylibs, allowSimToMacOSX, addVers), _interface(nullptr)
 {
-	std::unique_ptr<tapi::LinkerInterfaceFile> file;
 	std::string errorMessage;
 	__block uint32_t linkMinOSVersion = 0;
+	__block ld::Platform linkPlatform = ld::Platform::unknown;
 	//FIXME handle this correctly once we have multi-platfrom TAPI
 	platforms.forEach(^(ld::Platform platform, uint32_t minVersion, uint32_t sdkVersion, bool &stop) {
-		if (linkMinOSVersion == 0)
+		if (linkMinOSVersion == 0) {
 			linkMinOSVersion = minVersion;
-		if (platform == ld::Platform::macOS)
+			linkPlatform = platform;
+		}
+		if (platform == ld::Platform::macOS) {
 			linkMinOSVersion = minVersion;
+			linkPlatform = platform;
+		}
 	});
 
 // <rdar://problem/29038544> Support $ld$weak symbols in .tbd files
 #if ((TAPI_API_VERSION_MAJOR == 1 &&  TAPI_API_VERSION_MINOR >= 3) || (TAPI_API_VERSION_MAJOR > 1))
 	// Check if the library supports the new create API.
-	if (tapi::APIVersion::isAtLeast(1, 3)) {
-		tapi::ParsingFlags flags = tapi::ParsingFlags::None;
-		if (enforceDylibSubtypesMatch)
-			flags |= tapi::ParsingFlags::ExactCpuSubType;
-
-		if (!allowWeakImports)
-			flags |= tapi::ParsingFlags::DisallowWeakImports;
-
+	if (!tapi::APIVersion::isAtLeast(1, 3))
+		throwf("unsupported libtapi API version '%i.%i'", tapi::APIVersion::getMajor(), tapi::APIVersion::getMinor());
+	tapi::ParsingFlags flags = tapi::ParsingFlags::None;
+	if (enforceDylibSubtypesMatch)
+		flags |= tapi::ParsingFlags::ExactCpuSubType;
+
+	if (!allowWeakImports)
+		flags |= tapi::ParsingFlags::DisallowWeakImports;
+
+	// SDK stubs rarely change, so reuse what TAPI returned for the same stub and target last time
+	const char* cacheDir = opts->tbdCachePath();
+	const StubCache::Key cacheKey = { path, mTime, fileLength, cpuType, cpuSubType, (uint32_t)flags,
+									  linkMinOSVersion, (uint32_t)linkPlatform, stubCacheToolVersion() };
+	if ( cacheDir != NULL )
+		_cache.reset(StubCache::open(cacheDir, cacheKey));
+
+	StubContents contents;
+	if ( _cache ) {
+		// only the $ld$ exports are added up front, the rest are looked up in the cache when asked for
+		_cache->getContents(contents);
+		this->_lazyExports = true;
+	}
+	else {
 		_interface = tapi::LinkerInterfaceFile::create(
 			path, cpuType, cpuSubType, flags,
 			tapi::PackedVersion32(linkMinOSVersion), errorMessage);
-	} else {
-		throwf("unsupported libtapi API version '%i.%i'", tapi::APIVersion::getMajor(), tapi::APIVersion::getMinor());
+		if (!_interface)
+			throw strdup(errorMessage.c_str());
+		getContents(_interface, contents);
+		// stubs with inlined frameworks are handed to Options as live TAPI interfaces, so are not cached
+		if ( (cacheDir != NULL) && _interface->inlinedFrameworkNames().empty() )
+			StubCache::save(cacheDir, cacheKey, contents);
 	}
 #else
 	#error "unsupported libtapi API version"
 #endif
 
-	if (!_interface)
-		throw strdup(errorMessage.c_str());
-
 	// unmap file - it is no longer needed.
 	munmap((caddr_t)fileContent, fileLength);
 
@@ -191,7 +255,7 @@ File<A>::File(const char* path, const uint8_t* fileContent, uint64_t fileLength,
 	if ( logAllFiles )
 		printf("%s\n", path);
 
-	init(_interface, opts, buildingForSimulator, indirectDylib, linkingFlatNamespace,
+	init(contents, opts, buildingForSimulator, indirectDylib, linkingFlatNamespace,
 		 linkingMainExecutable, path, platforms, targetInstallPath, usingBitcode, internalSDK, fromSDK, platformMismatchesAreWarning);
 }
 
@@ -207,26 +271,28 @@ File<A>::File(const char* path, const uint8_t* fileContent, uint64_t fileLength,
 	: Base(strdup(path), mTime, ordinal, platforms, allowWeakImports, linkingFlatNamespace,
 		   hoistImplicitPublicDylibs, allowSimToMacOSX, addVers), _interface(file)
 {
-	init(_interface, opts, buildingForSimulator, indirectDylib, linkingFlatNamespace,
+	StubContents contents;
+	getContents(_interface, contents);
+	init(contents, opts, buildingForSimulator, indirectDylib, linkingFlatNamespace,
 		 linkingMainExecutable, path, platforms, installPath, usingBitcode, internalSDK, fromSDK, platformMismatchesAreWarning);
 }
 	
 template<typename A>
-void File<A>::init(tapi::LinkerInterfaceFile* file, const Options *opts, bool buildingForSimulator,
+void File<A>::init(const StubContents& contents, const Options *opts, bool buildingForSimulator,
 				   bool indirectDylib, bool linkingFlatNamespace, bool linkingMainExecutable,
 				   const char *path, const ld::VersionSet& cmdLinePlatforms, const char *targetInstallPath,
 				   bool usingBitcode, bool internalSDK, bool fromSDK, bool platformMismatchesAreWarning) {
 	_opts = opts;
 	this->_bitcode = std::unique_ptr<ld::Bitcode>(new ld::Bitcode(nullptr, 0));
-	this->_noRexports = !file->hasReexportedLibraries();
-	this->_hasWeakExports = file->hasWeakDefinedExports();
-	this->_dylibInstallPath = strdup(file->getInstallName().c_str());
-	this->_installPathOverride = file->isInstallNameVersionSpecific();
-	this->_dylibCurrentVersion = file->getCurrentVersion();
-	this->_dylibCompatibilityVersion = file->getCompatibilityVersion();
-	this->_swiftVersion = file->getSwiftVersion();
-	this->_parentUmbrella = file->getParentFrameworkName().empty() ? nullptr : strdup(file->getParentFrameworkName().c_str());
-	this->_appExtensionSafe = file->isApplicationExtensionSafe();
+	this->_noRexports = !contents.hasReexportedLibraries;
+	this->_hasWeakExports = contents.hasWeakDefinedExports;
+	this->_dylibInstallPath = strdup(contents.installName);
+	this->_installPathOverride = contents.installNameVersionSpecific;
+	this->_dylibCurrentVersion = contents.currentVersion;
+	this->_dylibCompatibilityVersion = contents.compatibilityVersion;
+	this->_swiftVersion = contents.swiftVersion;
+	this->_parentUmbrella = (contents.parentFrameworkName == nullptr) ? nullptr : strdup(contents.parentFrameworkName);
+	this->_appExtensionSafe = contents.applicationExtensionSafe;
 
 	// if framework, capture framework name
 	const char* lastSlash = strrchr(this->_dylibInstallPath, '/');
@@ -240,59 +306,71 @@ void File<A>::init(tapi::LinkerInterfaceFile* file, const Options *opts, bool bu
 			this->_frameworkName = leafName;
 	}
 	
-	for (auto &client : file->allowableClients())
-		this->_allowableClients.push_back(strdup(client.c_str()));
+	for (const char* client : contents.allowableClients)
+		this->_allowableClients.push_back(strdup(client));
 	
 	// <rdar://problem/20659505> [TAPI] Don't hoist "public" (in /usr/lib/) dylibs that should not be directly linked
-	this->_hasPublicInstallName = file->hasAllowableClients() ? false : this->isPublicLocation(file->getInstallName().c_str());
+	this->_hasPublicInstallName = contents.hasAllowableClients ? false : this->isPublicLocation(contents.installName);
 	
-	for (const auto &client : file->allowableClients())
-		this->_allowableClients.emplace_back(strdup(client.c_str()));
+	for (const char* client : contents.allowableClients)
+		this->_allowableClients.emplace_back(strdup(client));
 
 	ld::VersionSet lcPlatforms;
-	for (const auto &platform : file->getPlatformSet())
+	for (uint32_t platform : contents.platforms)
 		lcPlatforms.insert((ld::Platform)platform);
 
 	// check cross-linking
 	cmdLinePlatforms.checkDylibCrosslink(lcPlatforms, path, ".tbd", internalSDK, indirectDylib, usingBitcode, _isUnzipperedTwin, _dylibInstallPath, fromSDK, platformMismatchesAreWarning);
 
-	for (const auto& reexport : file->reexportedLibraries()) {
-		const char *path = strdup(reexport.c_str());
+	for (const char* reexport : contents.reexportedLibraries) {
+		const char *path = strdup(reexport);
 		if ( (targetInstallPath == nullptr) || (strcmp(targetInstallPath, path) != 0) )
 			this->_dependentDylibs.emplace_back(path, true);
 	}
 	
-	for (const auto& symbol : file->ignoreExports())
-		this->_ignoreExports.insert(strdup(symbol.c_str()));
+	for (const char* symbol : contents.ignoreExports)
+		this->_ignoreExports.insert(strdup(symbol));
 	
 	// if linking flat and this is a flat dylib, create one atom that references all imported symbols.
-	if ( linkingFlatNamespace && linkingMainExecutable && (file->hasTwoLevelNamespace() == false) ) {
-		std::vector<const char*> importNames;
-		importNames.reserve(file->undefineds().size());
-		// We do not need to strdup the name, because that will be done by the
-		// ImportAtom constructor.
-		for (const auto &sym : file->undefineds())
-			importNames.emplace_back(sym.getName().c_str());
+	if ( linkingFlatNamespace && linkingMainExecutable && (contents.hasTwoLevelNamespace == false) ) {
+		// We do not need to copy the names, because the ImportAtom constructor
+		// interns them.
+		std::vector<const char*> importNames(contents.undefineds);
 		this->_importAtom = new generic::dylib::ImportAtom(*this, importNames);
 	}
 	
 	// build hash table
-	buildExportHashTable(file);
+	buildExportHashTable(contents);
 }
 
 template <typename A>
-void File<A>::buildExportHashTable(const tapi::LinkerInterfaceFile* file) {
+void File<A>::buildExportHashTable(const StubContents& contents) {
 	if (this->_s_logHashtable )
 		fprintf(stderr, "ld: building hashtable from text-stub info in %s\n", this->path());
 
-	for (const auto &sym : file->exports()) {
-		const char* name = sym.getName().c_str();
-		bool weakDef = sym.isWeakDefined();
-		bool tlv = sym.isThreadLocalValue();
-		addExportedSymbol(name, weakDef, tlv, 0);
+	for (const StubContents::Export& exp : contents.exports) {
+		// names hidden with $ld$hide or $ld$weak must not be found, even through a re-exporting parent
+		if ( this->_ignoreExports.count(exp.name) == 0 )
+			addExportedSymbol(exp.name, exp.weakDef, exp.tlv, 0);
 	}
 }
 
+template <typename A>
+bool File<A>::findLazyExport(const char* name, bool& weakDef, bool& tlv, uint64_t& address) const {
+	address = 0;
+	return _cache->findExport(name, weakDef, tlv);
+}
+
+template <typename A>
+void File<A>::forEachLazyExport(void (^handler)(const char* name, bool weakDef, bool tlv, uint64_t address)) const {
+	if (this->_s_logHashtable )
+		fprintf(stderr, "ld: building hashtable from tbd cache for %s\n", this->path());
+
+	_cache->forEachExport(^(const char* name, bool weakDef, bool tlv) {
+		handler(name, weakDef, tlv, 0);
+	});
+}
+
 template <typename A>
 void File<A>::processIndirectLibraries(ld::dylib::File::DylibHandler* handler, bool addImplicitDylibs) {
 	if (_interface)
@@ -0,0 +1,824 @@
+//
+//  microbench.cpp
+//  ld
+//
+//  Times the linker's hot kernels in isolation, on generated symbol names at several sizes, so
+//  that a change to a hash, container or encoder can be judged on numbers before a whole link.
+//  Output follows Google Benchmark: time per iteration, iterations run and items per second.
+//
+//  usage: microbench [-filter substring] [-min_time seconds] [-list]
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ar.h>
+#include <mach/mach_time.h>
+#include <mach-o/ranlib.h>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_map.h"
+
+#include "ld.hpp"
+#include "ByteStream.h"
+#include "ExportTrie.h"
+#include "MachOTrie.hpp"
+#include "NameInterner.h"
+#include "Options.h"
+#include "OutputFile.h"
+#include "StringPool.h"
+#include "SymbolTable.h"
+#include "parsers/archive_file.h"
+
+const ld::VersionSet ld::File::_platforms;
+
+// Options prints this for -v, zld gets it from its version info
+extern "C" const char zldVersionString[] = "@(#)PROGRAM:microbench\n";
+
+
+// results are added here so the compiler cannot drop the work that made them
+static volatile uint64_t sSink;
+
+static const size_t sSizes[] = { 1 << 10, 1 << 14, 1 << 18 };
+
+// one kernel at one input size: prepare() builds the input, and the function it returns runs the
+// kernel once and returns how many items it processed
+struct Benchmark {
+	std::string									name;
+	size_t										size;
+	std::function<std::function<uint64_t()>()>	prepare;
+};
+
+static std::vector<Benchmark>& benchmarks()
+{
+	static std::vector<Benchmark> all;
+	return all;
+}
+
+static void addBenchmark(const std::string& name, std::function<std::function<uint64_t()>(size_t)> prepare)
+{
+	for (size_t size : sSizes)
+		benchmarks().push_back({ name, size, [=]() { return prepare(size); } });
+}
+
+
+//
+// Symbol names shaped like real ones: C, C++ and Swift mangled names and Objective-C metadata,
+// sharing module and class prefixes the way a large app's names do.  The same count always
+// gives the same names.
+//
+static const std::vector<std::string>& names(size_t count)
+{
+	static std::map<size_t, std::vector<std::string>> cache;
+	std::vector<std::string>& result = cache[count];
+	if ( !result.empty() )
+		return result;
+	std::mt19937_64 random(count);
+	static const char* const modules[] = { "Core", "Networking", "UserInterface", "Storage", "Analytics", "Media", "Messaging", "Payments" };
+	static const char* const words[] = { "Manager", "Controller", "View", "Request", "Response", "Cache", "Store", "Session", "Item", "Builder", "Delegate", "Handler" };
+	auto word = [&]() { return std::string(words[random() % 12]); };
+	result.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		const std::string module = modules[random() % 8];
+		const std::string type = module + word() + word();
+		const std::string method = "method" + std::to_string(random() % 64);
+		switch ( random() % 5 ) {
+			case 0:
+				result.push_back("_" + module + "_" + method + "_" + std::to_string(i));
+				break;
+			case 1:
+				result.push_back("__ZN" + std::to_string(module.size()) + module + std::to_string(type.size()) + type
+								 + std::to_string(method.size()) + method + "Ev" + std::to_string(i));
+				break;
+			case 2:
+				result.push_back("_$s" + std::to_string(module.size()) + module + std::to_string(type.size()) + type
+								 + "C" + std::to_string(method.size()) + method + std::to_string(i) + "yyF");
+				break;
+			case 3:
+				result.push_back("_OBJC_CLASS_$_" + type + std::to_string(i));
+				break;
+			default:
+				result.push_back("-[" + type + " " + method + ":" + std::to_string(i) + "]");
+				break;
+		}
+	}
+	return result;
+}
+
+// the same names interned, as parsers hand them to the symbol table
+static const std::vector<const char*>& internedNames(size_t count)
+{
+	static std::map<size_t, std::vector<const char*>> cache;
+	std::vector<const char*>& result = cache[count];
+	if ( result.empty() ) {
+		for (const std::string& name : names(count))
+			result.push_back(ld::NameInterner::intern(name.c_str(), name.size()));
+	}
+	return result;
+}
+
+// names of the given count that are not in names(count), for lookups that miss
+static const std::vector<const char*>& missingNames(size_t count)
+{
+	static std::map<size_t, std::vector<const char*>> cache;
+	std::vector<const char*>& result = cache[count];
+	if ( result.empty() ) {
+		for (const std::string& name : names(count))
+			result.push_back(ld::NameInterner::intern((name + "_missing").c_str()));
+	}
+	return result;
+}
+
+
+static void addHashBenchmarks()
+{
+	addBenchmark("CRCHash", [](size_t size) -> std::function<uint64_t()> {
+		const std::vector<std::string>& strings = names(size);
+		return [&strings]() {
+			uint64_t sum = 0;
+			for (const std::string& str : strings)
+				sum += ld::CRCHash(str.c_str(), str.size());
+			sSink = sum;
+			return (uint64_t)strings.size();
+		};
+	});
+	addBenchmark("LDStringCreate", [](size_t size) -> std::function<uint64_t()> {
+		const std::vector<std::string>& strings = names(size);
+		return [&strings]() {
+			uint64_t sum = 0;
+			for (const std::string& str : strings)
+				sum += ld::LDStringCreate(str.c_str()).hash;
+			sSink = sum;
+			return (uint64_t)strings.size();
+		};
+	});
+	addBenchmark("NameInterner::hash", [](size_t size) -> std::function<uint64_t()> {
+		const std::vector<std::string>& strings = names(size);
+		return [&strings]() {
+			uint64_t sum = 0;
+			for (const std::string& str : strings)
+				sum += ld::NameInterner::hash(str.c_str(), str.size());
+			sSink = sum;
+			return (uint64_t)strings.size();
+		};
+	});
+	addBenchmark("NameInterner::intern (existing)", [](size_t size) -> std::function<uint64_t()> {
+		const std::vector<std::string>& strings = names(size);
+		internedNames(size);
+		return [&strings]() {
+			uint64_t sum = 0;
+			for (const std::string& str : strings)
+				sum += (uintptr_t)ld::NameInterner::intern(str.c_str(), str.size());
+			sSink = sum;
+			return (uint64_t)strings.size();
+		};
+	});
+}
+
+
+//
+// The name tables of SymbolTable::add (NameToSlot) and archive::File::buildHashTable
+// (NameToOffsetMap) are LDMaps from interned names, which are absl containers unless REPRO
+// selects the std ones.  Both families are run here with the same hash and equality, so the
+// choice can be compared on one build.
+//
+template <typename NameMap>
+static void addNameMapBenchmarks(const std::string& family)
+{
+	// the loop of archive::File::buildHashTable: walk the table of contents backwards, overwriting
+	addBenchmark((family + " archive hash table"), [](size_t size) -> std::function<uint64_t()> {
+		const std::vector<const char*>& symbols = internedNames(size);
+		return [&symbols]() {
+			NameMap table;
+			for (size_t i = symbols.size(); i-- > 0; )
+				table[symbols[i]] = i;
+			sSink = table.size();
+			return (uint64_t)symbols.size();
+		};
+	});
+	// SymbolTable::addByName finds each name and adds the ones not seen yet, here one in four
+	// names is a duplicate definition or a reference to a name already added
+	addBenchmark((family + " symbol table add"), [](size_t size) -> std::function<uint64_t()> {
+		const std::vector<const char*>& symbols = internedNames(size);
+		return [&symbols]() {
+			NameMap table;
+			uint32_t nextSlot = 0;
+			uint64_t found = 0;
+			for (size_t i = 0; i < symbols.size(); ++i) {
+				const char* name = symbols[(i % 4 == 3) ? i / 2 : i];
+				auto pos = table.find(name);
+				if ( pos != table.end() )
+					found += pos->second;
+				else
+					table.insert(std::make_pair(name, nextSlot++));
+			}
+			sSink = found;
+			return (uint64_t)symbols.size();
+		};
+	});
+	// searchLibraries probes each archive for every undefined name, and most probes miss
+	addBenchmark((family + " archive probe"), [](size_t size) -> std::function<uint64_t()> {
+		const std::vector<const char*>& symbols = internedNames(size);
+		const std::vector<const char*>& missing = missingNames(size);
+		auto table = std::make_shared<NameMap>();
+		for (size_t i = 0; i < symbols.size(); ++i)
+			(*table)[symbols[i]] = i;
+		return [table, &symbols, &missing]() {
+			uint64_t found = 0;
+			for (size_t i = 0; i < symbols.size(); ++i) {
+				const char* name = (i % 4 == 0) ? symbols[i] : missing[i];
+				found += (table->find(name) != table->end());
+			}
+			sSink = found;
+			return (uint64_t)symbols.size();
+		};
+	});
+}
+
+// LDOrderedMap is keyed by pointers, such as archive members to their state
+template <typename OrderedMap>
+static void addOrderedMapBenchmarks(const std::string& family)
+{
+	addBenchmark((family + " ordered insert and walk"), [](size_t size) -> std::function<uint64_t()> {
+		const std::vector<const char*>& keys = internedNames(size);
+		return [&keys]() {
+			OrderedMap map;
+			for (size_t i = 0; i < keys.size(); ++i)
+				map[keys[i]] = (uint32_t)i;
+			uint64_t sum = 0;
+			for (const auto& entry : map)
+				sum += entry.second;
+			sSink = sum;
+			return (uint64_t)keys.size();
+		};
+	});
+}
+
+static void addContainerBenchmarks()
+{
+	addNameMapBenchmarks<absl::flat_hash_map<const char*, uint64_t, ld::CStringHash, ld::CStringEquals>>("absl");
+	addNameMapBenchmarks<std::unordered_map<const char*, uint64_t, ld::CStringHash, ld::CStringEquals>>("std");
+	addOrderedMapBenchmarks<absl::btree_map<const char*, uint32_t>>("absl");
+	addOrderedMapBenchmarks<std::map<const char*, uint32_t>>("std");
+}
+
+
+// exported symbols sorted by name, as the export info atom gets them
+static std::shared_ptr<std::vector<mach_o::trie::Entry>> trieEntries(size_t size)
+{
+	auto entries = std::make_shared<std::vector<mach_o::trie::Entry>>();
+	const std::vector<const char*>& symbols = internedNames(size);
+	std::vector<const char*> sorted(symbols);
+	std::sort(sorted.begin(), sorted.end(), [](const char* a, const char* b) { return strcmp(a, b) < 0; });
+	uint64_t address = 0x4000;
+	for (const char* name : sorted) {
+		mach_o::trie::Entry entry;
+		entry.name = name;
+		entry.address = address;
+		entry.flags = 0;
+		entry.other = 0;
+		entry.importName = NULL;
+		entries->push_back(entry);
+		address += 16 + (address % 7) * 8;
+	}
+	return entries;
+}
+
+static void addTrieBenchmarks()
+{
+	addBenchmark("mach_o::trie::makeTrie", [](size_t size) -> std::function<uint64_t()> {
+		auto entries = trieEntries(size);
+		return [entries]() {
+			std::vector<uint8_t> bytes;
+			mach_o::trie::makeTrie(*entries, bytes);
+			sSink = bytes.size();
+			return (uint64_t)entries->size();
+		};
+	});
+	addBenchmark("ld::makeExportTrie", [](size_t size) -> std::function<uint64_t()> {
+		auto entries = trieEntries(size);
+		return [entries]() {
+			std::vector<uint8_t> bytes;
+			ld::makeExportTrie(*entries, bytes);
+			sSink = bytes.size();
+			return (uint64_t)entries->size();
+		};
+	});
+	addBenchmark("mach_o::trie::parseTrie", [](size_t size) -> std::function<uint64_t()> {
+		auto entries = trieEntries(size);
+		auto bytes = std::make_shared<std::vector<uint8_t>>();
+		ld::makeExportTrie(*entries, *bytes);
+		return [bytes]() {
+			std::vector<mach_o::trie::Entry> parsed;
+			mach_o::trie::parseTrie(bytes->data(), bytes->data() + bytes->size(), parsed);
+			sSink = parsed.size();
+			return (uint64_t)parsed.size();
+		};
+	});
+}
+
+
+//
+// LEB128 values like those in dyld info: mostly small deltas between fixups, some segment
+// offsets and addends, and a few large values.
+//
+static std::shared_ptr<std::vector<uint64_t>> lebValues(size_t size)
+{
+	auto values = std::make_shared<std::vector<uint64_t>>();
+	std::mt19937_64 random(size);
+	for (size_t i = 0; i < size; ++i) {
+		switch ( random() % 8 ) {
+			case 0:
+				values->push_back(random() % 0x100000000ULL);
+				break;
+			case 1:
+			case 2:
+				values->push_back(random() % 0x4000);
+				break;
+			default:
+				values->push_back(8 * (1 + random() % 15));
+				break;
+		}
+	}
+	return values;
+}
+
+static void addEncoderBenchmarks()
+{
+	addBenchmark("ByteStream::append_uleb128", [](size_t size) -> std::function<uint64_t()> {
+		auto values = lebValues(size);
+		return [values]() {
+			ld::tool::ByteStream stream;
+			for (uint64_t value : *values)
+				stream.append_uleb128(value);
+			sSink = stream.size();
+			return (uint64_t)values->size();
+		};
+	});
+	addBenchmark("ByteStream::append_sleb128", [](size_t size) -> std::function<uint64_t()> {
+		auto values = lebValues(size);
+		return [values]() {
+			ld::tool::ByteStream stream;
+			int64_t sign = 1;
+			for (uint64_t value : *values) {
+				stream.append_sleb128(sign * (int64_t)value);
+				sign = -sign;
+			}
+			sSink = stream.size();
+			return (uint64_t)values->size();
+		};
+	});
+	addBenchmark("ByteStream::append_delta_encoded_uleb128_run", [](size_t size) -> std::function<uint64_t()> {
+		auto values = lebValues(size);
+		auto addresses = std::make_shared<std::vector<uint64_t>>();
+		uint64_t address = 0x100000000ULL;
+		for (uint64_t value : *values) {
+			address += 1 + value;
+			addresses->push_back(address);
+		}
+		return [addresses]() {
+			ld::tool::ByteStream stream;
+			stream.append_delta_encoded_uleb128_run(0x100000000ULL, *addresses);
+			sSink = stream.size();
+			return (uint64_t)addresses->size();
+		};
+	});
+	addBenchmark("ByteStream::uleb128_size", [](size_t size) -> std::function<uint64_t()> {
+		auto values = lebValues(size);
+		return [values]() {
+			uint64_t sum = 0;
+			for (uint64_t value : *values)
+				sum += ld::tool::ByteStream::uleb128_size(value);
+			sSink = sum;
+			return (uint64_t)values->size();
+		};
+	});
+}
+
+
+// the names as the string_views the symbol table atom hands to the string pool
+static const std::vector<std::string_view>& nameViews(size_t count)
+{
+	static std::map<size_t, std::vector<std::string_view>> cache;
+	std::vector<std::string_view>& result = cache[count];
+	if ( result.empty() ) {
+		for (const std::string& name : names(count))
+			result.push_back(name);
+	}
+	return result;
+}
+
+// the names with one in four repeating an earlier one, as symbols from several files share names
+static const std::vector<std::string_view>& repeatedNameViews(size_t count)
+{
+	static std::map<size_t, std::vector<std::string_view>> cache;
+	std::vector<std::string_view>& result = cache[count];
+	if ( result.empty() ) {
+		const std::vector<std::string_view>& views = nameViews(count);
+		for (size_t i = 0; i < views.size(); ++i)
+			result.push_back(views[(i % 4 == 3) ? i / 2 : i]);
+	}
+	return result;
+}
+
+static void addStringPoolBenchmarks()
+{
+	addBenchmark("StringPool::add", [](size_t size) -> std::function<uint64_t()> {
+		const std::vector<std::string_view>& strings = nameViews(size);
+		return [&strings]() {
+			ld::tool::StringPool pool;
+			for (std::string_view str : strings)
+				pool.add(str);
+			sSink = pool.currentOffset();
+			return (uint64_t)strings.size();
+		};
+	});
+	addBenchmark("StringPool::addUnique", [](size_t size) -> std::function<uint64_t()> {
+		const std::vector<std::string_view>& strings = repeatedNameViews(size);
+		return [&strings]() {
+			ld::tool::StringPool pool;
+			for (std::string_view str : strings)
+				pool.addUnique(str);
+			sSink = pool.currentOffset();
+			return (uint64_t)strings.size();
+		};
+	});
+	addBenchmark("StringPool::addInParallel", [](size_t size) -> std::function<uint64_t()> {
+		const std::vector<std::string_view>& strings = nameViews(size);
+		return [&strings]() {
+			ld::tool::StringPool pool;
+			std::vector<int32_t> offsets;
+			pool.addInParallel(strings, false, offsets);
+			sSink = pool.currentOffset();
+			return (uint64_t)strings.size();
+		};
+	});
+	addBenchmark("StringPool::addInParallel (unique)", [](size_t size) -> std::function<uint64_t()> {
+		const std::vector<std::string_view>& strings = repeatedNameViews(size);
+		return [&strings]() {
+			ld::tool::StringPool pool;
+			std::vector<int32_t> offsets;
+			pool.addInParallel(strings, true, offsets);
+			sSink = pool.currentOffset();
+			return (uint64_t)strings.size();
+		};
+	});
+	addBenchmark("StringPool::addTailMerged", [](size_t size) -> std::function<uint64_t()> {
+		const std::vector<std::string_view>& strings = repeatedNameViews(size);
+		return [&strings]() {
+			ld::tool::StringPool pool;
+			std::vector<int32_t> offsets;
+			pool.addTailMerged(strings, offsets);
+			sSink = pool.currentOffset();
+			return (uint64_t)strings.size();
+		};
+	});
+}
+
+
+//
+// An archive with only a table of contents, each name at its own member offset, as ranlib writes
+// it for x86_64.  Parsing it builds the archive's hash table and nothing else, as there are no
+// members to look at.
+//
+static std::shared_ptr<std::vector<uint8_t>> archiveWithTableOfContents(size_t size)
+{
+	const std::vector<std::string>& symbols = names(size);
+	std::vector<struct ranlib> tableOfContents(symbols.size());
+	std::string strings;
+	for (size_t i = 0; i < symbols.size(); ++i) {
+		tableOfContents[i].ran_un.ran_strx = strings.size();
+		tableOfContents[i].ran_off = 8 + sizeof(ar_hdr) + (i % 1024);
+		strings += symbols[i];
+		strings += '\0';
+	}
+	while ( (strings.size() % 4) != 0 )
+		strings += '\0';
+	static const char memberName[20] = SYMDEF_SORTED;
+	const uint32_t tableSize = tableOfContents.size() * sizeof(struct ranlib);
+	const uint32_t stringsSize = strings.size();
+	const size_t memberSize = sizeof(memberName) + 4 + tableSize + 4 + stringsSize;
+
+	auto archive = std::make_shared<std::vector<uint8_t>>();
+	auto append = [&](const void* bytes, size_t count) {
+		archive->insert(archive->end(), (const uint8_t*)bytes, (const uint8_t*)bytes + count);
+	};
+	append(ARMAG, SARMAG);
+	char header[sizeof(ar_hdr)+1];
+	snprintf(header, sizeof(header), "%-16s%-12u%-6u%-6u%-8o%-10zu%s", AR_EFMT1 "20", 0, 0, 0, 0644, memberSize, ARFMAG);
+	append(header, sizeof(ar_hdr));
+	append(memberName, sizeof(memberName));
+	append(&tableSize, 4);
+	append(tableOfContents.data(), tableSize);
+	append(&stringsSize, 4);
+	append(strings.data(), stringsSize);
+	return archive;
+}
+
+static void addArchiveBenchmarks()
+{
+	addBenchmark("archive::File::buildHashTable", [](size_t size) -> std::function<uint64_t()> {
+		auto archive = archiveWithTableOfContents(size);
+		archive::ParserOptions options = {};
+		options.objOpts.architecture = CPU_TYPE_X86_64;
+		return [archive, options, size]() {
+			ld::archive::File* file = archive::parse(archive->data(), archive->size(), "/tmp/libbench.a", 0,
+													 ld::File::Ordinal::NullOrdinal(), options);
+			if ( file == NULL )
+				throw "archive with only a table of contents not parsed";
+			sSink = (uintptr_t)file;
+			delete file;
+			return (uint64_t)size;
+		};
+	});
+}
+
+
+//
+// The symbol table and the fixup writer take the options of a link: an x86_64 executable whose
+// one input is an empty file that is never read.
+//
+static const Options& linkOptions()
+{
+	static Options* options = NULL;
+	if ( options == NULL ) {
+		static char inputPath[] = "/tmp/microbench-XXXXXX.o";
+		int fd = ::mkstemps(inputPath, 2);
+		if ( fd == -1 )
+			throwf("can't create %s", inputPath);
+		::close(fd);
+		const char* argv[] = { "ld", "-arch", "x86_64", "-platform_version", "macos", "10.15", "10.15",
+							   "-o", "/dev/null", inputPath, NULL };
+		try {
+			options = new Options(10, argv);
+		}
+		catch (...) {
+			::unlink(inputPath);
+			throw;
+		}
+		::unlink(inputPath);
+	}
+	return *options;
+}
+
+static ld::Section sTextSection("__TEXT", "__text", ld::Section::typeCode);
+static ld::Section sDataSection("__DATA", "__data", ld::Section::typeUnclassified);
+
+// a global definition with its own fixups, like the atoms the mach-o parser makes
+class BenchAtom : public ld::Atom
+{
+public:
+											BenchAtom(const ld::Section& sect, const char* name, uint64_t size)
+												: ld::Atom(sect, ld::Atom::definitionRegular, ld::Atom::combineNever,
+															ld::Atom::scopeGlobal, ld::Atom::typeUnclassified,
+															ld::Atom::symbolTableIn, false, false, false, ld::Atom::Alignment(0)),
+												  _name(name), _size(size) { }
+
+	virtual const ld::File*					file() const						{ return NULL; }
+	virtual const char*						name() const						{ return _name; }
+	virtual uint64_t						objectAddress() const				{ return 0; }
+	virtual uint64_t						size() const						{ return _size; }
+	virtual void							copyRawContent(uint8_t buffer[]) const	{ bzero(buffer, _size); }
+	virtual ld::Fixup::iterator				fixupsBegin() const					{ return (ld::Fixup*)fixups.data(); }
+	virtual ld::Fixup::iterator				fixupsEnd() const					{ return (ld::Fixup*)fixups.data() + fixups.size(); }
+
+	std::vector<ld::Fixup>					fixups;
+
+private:
+	const char*								_name;
+	uint64_t								_size;
+};
+
+// the link state applyFixUps() is given, which has no final sections as they are only read to
+// report a fixup out of range
+class BenchState : public ld::Internal
+{
+public:
+	virtual uint64_t						assignFileOffsets()							{ return 0; }
+	virtual void							setSectionSizesAndAlignments()				{ }
+	virtual ld::Internal::FinalSection*		addAtom(const ld::Atom&)					{ throw "microbench does not add atoms"; }
+	virtual ld::Internal::FinalSection*		getFinalSection(const ld::Section&)			{ throw "microbench has no final sections"; }
+};
+
+// one 16 byte function per name, laid out from 0x100001000
+static std::shared_ptr<std::vector<std::unique_ptr<BenchAtom>>> functionAtoms(size_t size)
+{
+	auto atoms = std::make_shared<std::vector<std::unique_ptr<BenchAtom>>>();
+	uint64_t offset = 0;
+	for (const char* name : internedNames(size)) {
+		atoms->emplace_back(new BenchAtom(sTextSection, name, 16));
+		atoms->back()->setSectionOffset(offset);
+		atoms->back()->setSectionStartAddress(0x100001000ULL);
+		offset += 16;
+	}
+	return atoms;
+}
+
+static std::vector<const ld::Atom*> atomPointers(const std::vector<std::unique_ptr<BenchAtom>>& atoms)
+{
+	std::vector<const ld::Atom*> result;
+	for (const std::unique_ptr<BenchAtom>& atom : atoms)
+		result.push_back(atom.get());
+	return result;
+}
+
+static void addSymbolTableBenchmarks()
+{
+	addBenchmark("SymbolTable::add", [](size_t size) -> std::function<uint64_t()> {
+		auto atoms = functionAtoms(size);
+		const Options& options = linkOptions();
+		return [atoms, &options]() {
+			std::vector<const ld::Atom*> indirectBindingTable;
+			ld::tool::SymbolTable symbolTable(options, indirectBindingTable);
+			for (const std::unique_ptr<BenchAtom>& atom : *atoms)
+				symbolTable.add(*atom, Options::kError);
+			sSink = symbolTable.updateCount();
+			return (uint64_t)atoms->size();
+		};
+	});
+	addBenchmark("SymbolTable::addAtoms", [](size_t size) -> std::function<uint64_t()> {
+		auto atoms = functionAtoms(size);
+		auto pointers = std::make_shared<std::vector<const ld::Atom*>>(atomPointers(*atoms));
+		const Options& options = linkOptions();
+		return [atoms, pointers, &options]() {
+			std::vector<const ld::Atom*> indirectBindingTable;
+			ld::tool::SymbolTable symbolTable(options, indirectBindingTable);
+			symbolTable.addAtoms(*pointers, Options::kError);
+			sSink = symbolTable.updateCount();
+			return (uint64_t)pointers->size();
+		};
+	});
+}
+
+// applyFixUps() is private to OutputFile.  The names in an explicit instantiation are not access
+// checked, so this one hands out a pointer to it without the linker opening it up for the benchmark.
+typedef void (ld::tool::OutputFile::*ApplyFixUps)(ld::Internal&, uint64_t, const ld::Atom*, uint8_t*);
+ApplyFixUps applyFixUpsMember();
+template <ApplyFixUps member>
+struct ApplyFixUpsAccess {
+	friend ApplyFixUps applyFixUpsMember() { return member; }
+};
+template struct ApplyFixUpsAccess<&ld::tool::OutputFile::applyFixUps>;
+
+//
+// Every function calls the one before it, and a pointer to each function is stored in __data,
+// the two fixups x86_64 code has most of.
+//
+static void addFixUpBenchmarks()
+{
+	addBenchmark("OutputFile::applyFixUps", [](size_t size) -> std::function<uint64_t()> {
+		auto functions = functionAtoms(size);
+		auto pointers = std::make_shared<std::vector<std::unique_ptr<BenchAtom>>>();
+		uint64_t offset = 0;
+		for (size_t i = 0; i < functions->size(); ++i) {
+			BenchAtom* function = (*functions)[i].get();
+			const ld::Atom* callee = (*functions)[(i == 0) ? 0 : i-1].get();
+			function->fixups.emplace_back(1, ld::Fixup::k1of1, ld::Fixup::kindStoreTargetAddressX86BranchPCRel32, callee);
+			pointers->emplace_back(new BenchAtom(sDataSection, "_pointer", 8));
+			pointers->back()->fixups.emplace_back(0, ld::Fixup::k1of1, ld::Fixup::kindStoreTargetAddressLittleEndian64, function);
+			pointers->back()->setSectionOffset(offset);
+			pointers->back()->setSectionStartAddress(0x200000000ULL);
+			offset += 8;
+		}
+		auto state = std::make_shared<BenchState>();
+		auto writer = std::make_shared<ld::tool::OutputFile>(linkOptions(), *state);
+		auto buffer = std::make_shared<std::vector<uint8_t>>(16 * functions->size() + offset);
+		return [functions, pointers, state, writer, buffer]() {
+			const ApplyFixUps applyFixUps = applyFixUpsMember();
+			uint8_t* content = buffer->data();
+			for (const std::unique_ptr<BenchAtom>& function : *functions) {
+				(writer.get()->*applyFixUps)(*state, 0x100000000ULL, function.get(), content);
+				content += 16;
+			}
+			for (const std::unique_ptr<BenchAtom>& pointer : *pointers) {
+				(writer.get()->*applyFixUps)(*state, 0x100000000ULL, pointer.get(), content);
+				content += 8;
+			}
+			sSink = (*buffer)[buffer->size()-1];
+			return (uint64_t)(functions->size() + pointers->size());
+		};
+	});
+}
+
+
+static double nanoseconds(uint64_t machTime)
+{
+	static mach_timebase_info_data_t timebase;
+	if ( timebase.denom == 0 )
+		mach_timebase_info(&timebase);
+	return (double)machTime * timebase.numer / timebase.denom;
+}
+
+// runs the kernel with more iterations each time until they take at least minTime, like
+// Google Benchmark, and prints the time per iteration and the items per second
+static void run(const Benchmark& benchmark, double minTime)
+{
+	std::function<uint64_t()> kernel = benchmark.prepare();
+	// the first run warms caches and lazily built tables
+	kernel();
+	uint64_t iterations = 1;
+	double elapsed = 0;
+	uint64_t items = 0;
+	while ( true ) {
+		items = 0;
+		uint64_t start = mach_absolute_time();
+		for (uint64_t i = 0; i < iterations; ++i)
+			items += kernel();
+		elapsed = nanoseconds(mach_absolute_time() - start);
+		if ( (elapsed >= minTime * 1e9) || (iterations >= (1ULL << 30)) )
+			break;
+		// aim a little past minTime instead of doubling blindly
+		double scale = (elapsed > 0) ? (minTime * 1e9 * 1.4 / elapsed) : 10.0;
+		iterations = std::max(iterations + 1, (uint64_t)(iterations * std::min(scale, 10.0)));
+	}
+	const std::string name = benchmark.name + "/" + std::to_string(benchmark.size);
+	double itemsPerSecond = items / (elapsed / 1e9);
+	const char* unit = "";
+	if ( itemsPerSecond >= 1e9 ) {
+		itemsPerSecond /= 1e9;
+		unit = "G";
+	}
+	else if ( itemsPerSecond >= 1e6 ) {
+		itemsPerSecond /= 1e6;
+		unit = "M";
+	}
+	else if ( itemsPerSecond >= 1e3 ) {
+		itemsPerSecond /= 1e3;
+		unit = "k";
+	}
+	printf("%-56s %14.0f ns %12llu %10.2f%s items/s\n", name.c_str(), elapsed / iterations, iterations, itemsPerSecond, unit);
+	fflush(stdout);
+}
+
+static void usage()
+{
+	fprintf(stderr, "usage: microbench [-filter substring] [-min_time seconds] [-list]\n");
+}
+
+int main(int argc, const char* argv[])
+{
+	const char* filter = NULL;
+	double minTime = 0.5;
+	bool list = false;
+	try {
+		for (int i=1; i < argc; ++i) {
+			const char* arg = argv[i];
+			if ( strcmp(arg, "-filter") == 0 ) {
+				filter = argv[++i];
+				if ( filter == NULL )
+					throw "-filter missing substring";
+			}
+			else if ( strcmp(arg, "-min_time") == 0 ) {
+				const char* seconds = argv[++i];
+				if ( seconds == NULL )
+					throw "-min_time missing seconds";
+				minTime = atof(seconds);
+			}
+			else if ( strcmp(arg, "-list") == 0 ) {
+				list = true;
+			}
+			else {
+				usage();
+				throwf("unknown option: %s", arg);
+			}
+		}
+
+		addHashBenchmarks();
+		addContainerBenchmarks();
+		addArchiveBenchmarks();
+		addTrieBenchmarks();
+		addEncoderBenchmarks();
+		addStringPoolBenchmarks();
+		addSymbolTableBenchmarks();
+		addFixUpBenchmarks();
+
+		if ( !list )
+			printf("%-56s %17s %12s %18s\n", "Benchmark", "Time", "Iterations", "Throughput");
+		for (const Benchmark& benchmark : benchmarks()) {
+			const std::string name = benchmark.name + "/" + std::to_string(benchmark.size);
+			if ( (filter != NULL) && (strstr(name.c_str(), filter) == NULL) )
+				continue;
+			if ( list )
+				printf("%s\n", name.c_str());
+			else
+				run(benchmark, minTime);
+		}
+	}
+	catch (const char* msg) {
+		fprintf(stderr, "microbench failed: %s\n", msg);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,195 @@
+// Checks that ld::makeExportTrie() builds the same bytes as mach_o::trie::makeTrie(), and
+// that mach_o::trie::findTrieEntry() finds every entry in the trie.
+//
+//   check-trie            builds both tries from generated entries in several orders
+//   check-trie <image>    rebuilds the export trie of a linked image with makeTrie() from its
+//                         entries in address order, as the linker sorts them, and compares
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <mach-o/loader.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ExportTrie.h"
+
+using mach_o::trie::Entry;
+
+static bool sameTrie(const char* what, const std::vector<Entry>& entries)
+{
+	std::vector<uint8_t> expected;
+	std::vector<uint8_t> actual;
+	mach_o::trie::makeTrie(entries, expected);
+	ld::makeExportTrie(entries, actual);
+	if ( actual == expected )
+		return true;
+	size_t offset = std::mismatch(actual.begin(), actual.end(), expected.begin(), expected.end()).first - actual.begin();
+	fprintf(stderr, "%s: trie of %zu entries is %zu bytes instead of %zu, first difference at offset %zu\n",
+			what, entries.size(), actual.size(), expected.size(), offset);
+	return false;
+}
+
+static bool findsEveryEntry(const char* what, const std::vector<Entry>& entries)
+{
+	// names that are prefixes of names added before them end up behind empty edges
+	std::vector<uint8_t> trie;
+	mach_o::trie::makeTrie(entries, trie);
+	for (const Entry& expected : entries) {
+		Entry found;
+		if ( !mach_o::trie::findTrieEntry(trie.data(), trie.data() + trie.size(), expected.name, found)
+			|| (found.flags != expected.flags) || (found.address != expected.address) ) {
+			fprintf(stderr, "%s: findTrieEntry() did not find %s\n", what, expected.name);
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool checkGeneratedEntries()
+{
+	// every combination of these parts, so names share prefixes and are prefixes of each other
+	static const char* const parts[] = { "_", "f", "fo", "foo", "o", "bar", "b", "Z", "_long_shared_prefix_" };
+	std::vector<std::string> names;
+	names.push_back("_");
+	for (size_t n = 0; n < names.size() && names.size() < 20000; ++n) {
+		if ( names[n].size() > 40 )
+			continue;
+		for (const char* part : parts)
+			names.push_back(names[n] + part);
+	}
+	std::sort(names.begin(), names.end());
+	names.erase(std::unique(names.begin(), names.end()), names.end());
+
+	std::vector<Entry> entries;
+	uint64_t address = 0x1000;
+	for (size_t i = 0; i < names.size(); ++i) {
+		Entry entry = { names[i].c_str(), address, EXPORT_SYMBOL_FLAGS_KIND_REGULAR, 0, NULL };
+		switch ( i % 7 ) {
+			case 1:
+				entry.flags |= EXPORT_SYMBOL_FLAGS_WEAK_DEFINITION;
+				break;
+			case 2:
+				// re-export under the same name
+				entry.flags = EXPORT_SYMBOL_FLAGS_REEXPORT;
+				entry.address = 0;
+				entry.other = 1 + (i % 300);
+				entry.importName = "";
+				break;
+			case 3:
+				// re-export that renames
+				entry.flags = EXPORT_SYMBOL_FLAGS_REEXPORT;
+				entry.address = 0;
+				entry.other = 2;
+				entry.importName = names[(i * 31) % names.size()].c_str();
+				break;
+			case 4:
+				entry.flags |= EXPORT_SYMBOL_FLAGS_STUB_AND_RESOLVER;
+				entry.other = address + 0x100000000ULL;
+				break;
+			case 5:
+				entry.flags = EXPORT_SYMBOL_FLAGS_KIND_THREAD_LOCAL;
+				break;
+			case 6:
+				entry.flags = EXPORT_SYMBOL_FLAGS_KIND_ABSOLUTE;
+				entry.address = i * 0x123456789ULL;
+				break;
+		}
+		entries.push_back(entry);
+		address += 16 + (i % 5) * 0x1000;
+	}
+
+	bool good = true;
+	good &= sameTrie("no entries", std::vector<Entry>());
+	good &= sameTrie("one entry", std::vector<Entry>(entries.begin(), entries.begin()+1));
+	good &= sameTrie("name order", entries);
+	std::vector<Entry> reversed(entries.rbegin(), entries.rend());
+	good &= sameTrie("reverse name order", reversed);
+	good &= findsEveryEntry("reverse name order", reversed);
+	std::mt19937 random(20);
+	for (int i = 0; i < 4; ++i) {
+		std::vector<Entry> shuffled = entries;
+		std::shuffle(shuffled.begin(), shuffled.end(), random);
+		good &= sameTrie("shuffled", shuffled);
+		good &= findsEveryEntry("shuffled", shuffled);
+		// few entries, so nodes have few edges
+		shuffled.resize(50);
+		good &= sameTrie("shuffled subset", shuffled);
+	}
+	return good;
+}
+
+static bool checkImage(const char* path)
+{
+	int fd = ::open(path, O_RDONLY, 0);
+	struct stat statBuffer;
+	if ( (fd == -1) || (::fstat(fd, &statBuffer) != 0) ) {
+		fprintf(stderr, "can't open %s\n", path);
+		return false;
+	}
+	const uint8_t* content = (uint8_t*)::mmap(NULL, statBuffer.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	const mach_header_64* mh = (mach_header_64*)content;
+	if ( (content == MAP_FAILED) || (mh->magic != MH_MAGIC_64) ) {
+		fprintf(stderr, "%s is not a 64-bit mach-o image\n", path);
+		return false;
+	}
+
+	uint32_t trieOffset = 0;
+	uint32_t trieSize = 0;
+	const load_command* cmd = (load_command*)(content + sizeof(mach_header_64));
+	for (uint32_t i = 0; i < mh->ncmds; ++i) {
+		if ( (cmd->cmd == LC_DYLD_INFO) || (cmd->cmd == LC_DYLD_INFO_ONLY) ) {
+			trieOffset = ((dyld_info_command*)cmd)->export_off;
+			trieSize = ((dyld_info_command*)cmd)->export_size;
+		}
+		else if ( cmd->cmd == LC_DYLD_EXPORTS_TRIE ) {
+			trieOffset = ((linkedit_data_command*)cmd)->dataoff;
+			trieSize = ((linkedit_data_command*)cmd)->datasize;
+		}
+		cmd = (load_command*)((uint8_t*)cmd + cmd->cmdsize);
+	}
+	if ( trieSize == 0 ) {
+		fprintf(stderr, "%s has no export trie\n", path);
+		return false;
+	}
+
+	const uint8_t* trieStart = content + trieOffset;
+	std::vector<Entry> entries;
+	mach_o::trie::parseTrie(trieStart, trieStart + trieSize, entries);
+	// stable, so entries at the same address keep the order they are in the trie
+	std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+		return a.address < b.address;
+	});
+	std::vector<uint8_t> expected;
+	mach_o::trie::makeTrie(entries, expected);
+
+	// the trie in the image is padded with zeros to pointer alignment
+	bool good = (expected.size() <= trieSize) && (memcmp(trieStart, expected.data(), expected.size()) == 0);
+	for (uint32_t offset = expected.size(); good && (offset < trieSize); ++offset)
+		good = (trieStart[offset] == 0);
+	if ( !good )
+		fprintf(stderr, "%s: export trie of %zu entries (%u bytes) is not the %zu bytes makeTrie() builds\n",
+				path, entries.size(), trieSize, expected.size());
+	good &= sameTrie(path, entries);
+	return good;
+}
+
+int main(int argc, const char* argv[])
+{
+	try {
+		bool good = (argc > 1) ? checkImage(argv[1]) : checkGeneratedEntries();
+		return good ? 0 : 1;
+	}
+	catch (const char* msg) {
+		fprintf(stderr, "%s\n", msg);
+		return 1;
+	}
+}
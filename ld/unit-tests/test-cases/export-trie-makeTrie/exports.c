@@ -0,0 +1,20 @@
+// hundreds of exports whose names share prefixes and are prefixes of each other
+
+#define FUNC(name)		int name(void) { return __COUNTER__; }
+#define FUNCS(p)		FUNC(p) FUNC(p##_) FUNC(p##_a) FUNC(p##_ab) FUNC(p##_abc) FUNC(p##_b) FUNC(p##_ba) FUNC(p##x)
+#define GROUP(p)		FUNCS(p) FUNCS(p##a) FUNCS(p##ab) FUNCS(p##b) FUNCS(p##Z) FUNCS(p##_long_shared_prefix_)
+
+GROUP(f)
+GROUP(fo)
+GROUP(foo)
+GROUP(foobar)
+GROUP(bar)
+GROUP(ba)
+GROUP(baz)
+GROUP(OBJC_CLASS_)
+GROUP(OBJC_METACLASS_)
+
+__attribute__((weak)) int weak_foo(void) { return 1; }
+__attribute__((weak)) int weak_fo(void) { return 2; }
+int data_foo = 3;
+int data_fo[] = { 4, 5 };
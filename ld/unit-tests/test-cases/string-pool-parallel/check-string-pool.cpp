@@ -0,0 +1,339 @@
+// Checks the string pool the linker builds on every core against the one it would build a string
+// at a time.
+//
+//   check-string-pool -pool                 compares StringPool::addInParallel() with add() and
+//                                           addUnique() on each string, and checks that every
+//                                           offset addTailMerged() returns is its string
+//   check-string-pool <image>               rebuilds the string pool of a linked image a symbol at
+//                                           a time, the way -r links still make it, and compares
+//                                           it and every n_strx with the image
+//   check-string-pool <image> <merged>      checks that <merged>, linked from the same inputs with
+//                                           -zld_tail_merge_strings, has the same symbols with the
+//                                           same names, and that its stabs strings are still last
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <mach-o/loader.h>
+#include <mach-o/nlist.h>
+#include <mach-o/stab.h>
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "StringPool.h"
+
+using ld::tool::StringPool;
+
+static std::vector<uint8_t> poolBytes(const StringPool& pool)
+{
+	std::vector<uint8_t> bytes(pool.currentOffset());
+	pool.copyTo(bytes.data());
+	return bytes;
+}
+
+static bool sameOffsets(const char* what, const std::vector<int32_t>& actual, const std::vector<int32_t>& expected)
+{
+	for (size_t i = 0; i < expected.size(); ++i) {
+		if ( actual[i] != expected[i] ) {
+			fprintf(stderr, "%s: string %zu is at offset %d instead of %d\n", what, i, actual[i], expected[i]);
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool checkPool()
+{
+	// enough names to fill more than one of the pool's 16MB buffers, with names that repeat
+	// within a batch and names that are already in the pool from an earlier batch
+	std::vector<std::string> names;
+	for (int i = 0; i < 400000; ++i)
+		names.push_back("_name_" + std::to_string(i % 150000) + std::string(i % 97, 'x'));
+	for (int i = 0; i < 20000; ++i)
+		names.push_back("_long_" + std::to_string(i) + std::string(900, 'a' + (i % 26)));
+	auto batch = [&](size_t start, size_t count, size_t stride) {
+		std::vector<std::string_view> strings;
+		for (size_t i = 0; i < count; ++i)
+			strings.push_back(names[(start + i*stride) % names.size()]);
+		return strings;
+	};
+	const std::vector<std::string_view> globals = batch(0, 200000, 1);
+	const std::vector<std::string_view> imports = batch(150000, 50000, 3);
+	const std::vector<std::string_view> locals = batch(100000, 300000, 1);
+	const std::vector<std::string_view> moreLocals = batch(7, 100000, 5);
+
+	StringPool serial;
+	StringPool parallel;
+	std::vector<int32_t> expected;
+	std::vector<int32_t> actual;
+	bool good = true;
+	for (const std::vector<std::string_view>* strings : { &globals, &imports }) {
+		expected.clear();
+		for (std::string_view str : *strings)
+			expected.push_back(serial.add(str));
+		parallel.addInParallel(*strings, false, actual);
+		good &= sameOffsets("addInParallel()", actual, expected);
+	}
+	for (const std::vector<std::string_view>* strings : { &locals, &moreLocals }) {
+		expected.clear();
+		for (std::string_view str : *strings)
+			expected.push_back(serial.addUnique(str));
+		parallel.addInParallel(*strings, true, actual);
+		good &= sameOffsets("addInParallel(unique)", actual, expected);
+	}
+	// as stabs strings are added after the symbols' names
+	for (std::string_view str : { locals[0], locals[12345], moreLocals[99999], std::string_view("/tmp/main.c") }) {
+		if ( parallel.addUnique(str) != serial.addUnique(str) ) {
+			fprintf(stderr, "addUnique() after addInParallel(unique) disagrees on %.*s\n", (int)str.size(), str.data());
+			good = false;
+		}
+	}
+	if ( poolBytes(parallel) != poolBytes(serial) ) {
+		fprintf(stderr, "pool of %u bytes made in parallel is not the pool of %u bytes made a string at a time\n",
+				parallel.currentOffset(), serial.currentOffset());
+		good = false;
+	}
+
+	std::vector<std::string_view> all(globals);
+	all.insert(all.end(), imports.begin(), imports.end());
+	all.insert(all.end(), locals.begin(), locals.end());
+	all.push_back("x");
+	all.push_back("");
+	StringPool merged;
+	merged.addTailMerged(all, actual);
+	const std::vector<uint8_t> bytes = poolBytes(merged);
+	for (size_t i = 0; i < all.size(); ++i) {
+		const int32_t offset = actual[i];
+		if ( (offset < 2) || (offset + all[i].size() >= bytes.size()) || (memcmp(&bytes[offset], all[i].data(), all[i].size()) != 0)
+			|| (bytes[offset + all[i].size()] != '\0') ) {
+			fprintf(stderr, "addTailMerged() put string %zu at offset %d, which is not that string\n", i, offset);
+			good = false;
+			break;
+		}
+	}
+	return good;
+}
+
+
+struct Image
+{
+	const char*				path;
+	const nlist_64*			symbols;
+	uint32_t				symbolCount;
+	const char*				strings;
+	uint32_t				stringsSize;
+	const dysymtab_command*	dysymtab;
+
+	const char*		name(uint32_t strx) const	{ return (strx < stringsSize) ? &strings[strx] : NULL; }
+	bool			isStab(uint32_t i) const	{ return (symbols[i].n_type & N_STAB) != 0; }
+};
+
+static bool loadImage(const char* path, Image& image)
+{
+	int fd = ::open(path, O_RDONLY, 0);
+	struct stat statBuffer;
+	if ( (fd == -1) || (::fstat(fd, &statBuffer) != 0) ) {
+		fprintf(stderr, "can't open %s\n", path);
+		return false;
+	}
+	const uint8_t* content = (uint8_t*)::mmap(NULL, statBuffer.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	const mach_header_64* mh = (mach_header_64*)content;
+	if ( (content == MAP_FAILED) || (mh->magic != MH_MAGIC_64) ) {
+		fprintf(stderr, "%s is not a 64-bit mach-o image\n", path);
+		return false;
+	}
+	const symtab_command* symtab = NULL;
+	image.path = path;
+	image.dysymtab = NULL;
+	const load_command* cmd = (load_command*)(content + sizeof(mach_header_64));
+	for (uint32_t i = 0; i < mh->ncmds; ++i) {
+		if ( cmd->cmd == LC_SYMTAB )
+			symtab = (symtab_command*)cmd;
+		else if ( cmd->cmd == LC_DYSYMTAB )
+			image.dysymtab = (dysymtab_command*)cmd;
+		cmd = (load_command*)((uint8_t*)cmd + cmd->cmdsize);
+	}
+	if ( (symtab == NULL) || (image.dysymtab == NULL) ) {
+		fprintf(stderr, "%s has no symbol table\n", path);
+		return false;
+	}
+	image.symbols = (nlist_64*)(content + symtab->symoff);
+	image.symbolCount = symtab->nsyms;
+	image.strings = (char*)(content + symtab->stroff);
+	image.stringsSize = symtab->strsize;
+	return true;
+}
+
+// the offset SymbolTableAtom::stringOffsetForStab() gives the string of a stab
+static int32_t addStabString(StringPool& pool, uint8_t type, const char* string)
+{
+	switch ( type ) {
+		case N_SO:
+			if ( (string == NULL) || (string[0] == '\0') )
+				return pool.emptyString();
+			// fall into uniquing case
+		case N_SOL:
+		case N_BINCL:
+		case N_EXCL:
+			return pool.addUnique(string);
+		default:
+			if ( string == NULL )
+				return 0;
+			else if ( string[0] == '\0' )
+				return pool.emptyString();
+			else
+				return pool.add(string);
+	}
+}
+
+static bool checkImage(const char* path)
+{
+	Image image;
+	if ( !loadImage(path, image) )
+		return false;
+	const dysymtab_command& dysymtab = *image.dysymtab;
+
+	// SymbolTableAtom::addSymbolsInOrder() adds the names of globals, then of imports, then of
+	// locals, and encode() adds the stabs strings after all of them
+	StringPool pool;
+	std::vector<int32_t> offsets(image.symbolCount, 0);
+	std::vector<int32_t> indirectOffsets(image.symbolCount, 0);
+	auto addSymbol = [&](uint32_t i, bool unique) {
+		const nlist_64& symbol = image.symbols[i];
+		offsets[i] = unique ? pool.addUnique(image.name(symbol.n_un.n_strx)) : pool.add(image.name(symbol.n_un.n_strx));
+		if ( ((symbol.n_type & N_TYPE) == N_INDR) && (symbol.n_value != symbol.n_un.n_strx) )
+			indirectOffsets[i] = pool.add(image.name(symbol.n_value));
+	};
+	for (uint32_t i = dysymtab.iextdefsym; i < dysymtab.iextdefsym + dysymtab.nextdefsym; ++i)
+		addSymbol(i, false);
+	for (uint32_t i = dysymtab.iundefsym; i < dysymtab.iundefsym + dysymtab.nundefsym; ++i)
+		addSymbol(i, false);
+	for (uint32_t i = dysymtab.ilocalsym; i < dysymtab.ilocalsym + dysymtab.nlocalsym; ++i) {
+		if ( !image.isStab(i) )
+			addSymbol(i, true);
+	}
+	uint32_t stabCount = 0;
+	for (uint32_t i = dysymtab.ilocalsym; i < dysymtab.ilocalsym + dysymtab.nlocalsym; ++i) {
+		if ( image.isStab(i) ) {
+			const uint32_t strx = image.symbols[i].n_un.n_strx;
+			offsets[i] = addStabString(pool, image.symbols[i].n_type, (strx == 0) ? NULL : image.name(strx));
+			++stabCount;
+		}
+	}
+	if ( stabCount == 0 ) {
+		fprintf(stderr, "%s has no stabs\n", path);
+		return false;
+	}
+
+	for (uint32_t i = 0; i < image.symbolCount; ++i) {
+		const nlist_64& symbol = image.symbols[i];
+		if ( ((uint32_t)offsets[i] != symbol.n_un.n_strx) || (indirectOffsets[i] && ((uint32_t)indirectOffsets[i] != symbol.n_value)) ) {
+			fprintf(stderr, "%s: n_strx of symbol %u (%s) is %u instead of %d\n", path, i, image.name(symbol.n_un.n_strx),
+					symbol.n_un.n_strx, offsets[i]);
+			return false;
+		}
+	}
+	// the string pool is padded with zeros to pointer alignment
+	const std::vector<uint8_t> expected = poolBytes(pool);
+	bool good = (expected.size() <= image.stringsSize) && (memcmp(image.strings, expected.data(), expected.size()) == 0);
+	for (uint32_t offset = expected.size(); good && (offset < image.stringsSize); ++offset)
+		good = (image.strings[offset] == '\0');
+	if ( !good )
+		fprintf(stderr, "%s: string pool of %u bytes is not the %zu bytes made a symbol at a time\n", path,
+				image.stringsSize, expected.size());
+	return good;
+}
+
+static bool checkTailMerged(const char* path, const char* mergedPath)
+{
+	Image image;
+	Image merged;
+	if ( !loadImage(path, image) || !loadImage(mergedPath, merged) )
+		return false;
+	if ( merged.symbolCount != image.symbolCount ) {
+		fprintf(stderr, "%s has %u symbols instead of %u\n", mergedPath, merged.symbolCount, image.symbolCount);
+		return false;
+	}
+
+	// every name, and the name an indirect symbol stands for, is a whole string in the pool
+	auto validString = [&](uint32_t strx) {
+		return (strx < merged.stringsSize) && (memchr(&merged.strings[strx], '\0', merged.stringsSize - strx) != NULL);
+	};
+	uint32_t symbolStringsEnd = 0;
+	for (uint32_t i = 0; i < merged.symbolCount; ++i) {
+		const nlist_64& symbol = image.symbols[i];
+		const nlist_64& mergedSymbol = merged.symbols[i];
+		const bool indirect = ((mergedSymbol.n_type & N_TYPE) == N_INDR) && !merged.isStab(i);
+		if ( !validString(mergedSymbol.n_un.n_strx) || (indirect && !validString(mergedSymbol.n_value)) ) {
+			fprintf(stderr, "%s: n_strx of symbol %u is %u, past the end of its %u byte string pool\n", mergedPath, i,
+					mergedSymbol.n_un.n_strx, merged.stringsSize);
+			return false;
+		}
+		if ( (strcmp(image.name(symbol.n_un.n_strx), merged.name(mergedSymbol.n_un.n_strx)) != 0)
+			|| (indirect && (strcmp(image.name(symbol.n_value), merged.name(mergedSymbol.n_value)) != 0)) ) {
+			fprintf(stderr, "%s: symbol %u is named %s instead of %s\n", mergedPath, i,
+					merged.name(mergedSymbol.n_un.n_strx), image.name(symbol.n_un.n_strx));
+			return false;
+		}
+		if ( (mergedSymbol.n_type != symbol.n_type) || (mergedSymbol.n_sect != symbol.n_sect) || (mergedSymbol.n_desc != symbol.n_desc)
+			|| (!indirect && !merged.isStab(i) && (mergedSymbol.n_value != symbol.n_value)) ) {
+			fprintf(stderr, "%s: symbol %u (%s) differs from the one linked without tail merging\n", mergedPath, i,
+					merged.name(mergedSymbol.n_un.n_strx));
+			return false;
+		}
+		if ( !merged.isStab(i) ) {
+			symbolStringsEnd = std::max<uint32_t>(symbolStringsEnd, mergedSymbol.n_un.n_strx + strlen(merged.name(mergedSymbol.n_un.n_strx)) + 1);
+			if ( indirect )
+				symbolStringsEnd = std::max<uint32_t>(symbolStringsEnd, mergedSymbol.n_value + strlen(merged.name(mergedSymbol.n_value)) + 1);
+		}
+	}
+
+	// stabs strings are not part of the UUID, so they must all come after the symbols' names
+	// (offsets 0 and 1 are the burned byte and the empty string every pool starts with)
+	uint32_t stabCount = 0;
+	for (uint32_t i = 0; i < merged.symbolCount; ++i) {
+		if ( !merged.isStab(i) )
+			continue;
+		++stabCount;
+		const uint32_t strx = merged.symbols[i].n_un.n_strx;
+		if ( (strx > 1) && (strx < symbolStringsEnd) ) {
+			fprintf(stderr, "%s: string of stab %u (%s) is at offset %u, before the end of the symbols' names at %u\n",
+					mergedPath, i, merged.name(strx), strx, symbolStringsEnd);
+			return false;
+		}
+	}
+	if ( stabCount == 0 ) {
+		fprintf(stderr, "%s has no stabs\n", mergedPath);
+		return false;
+	}
+	if ( merged.stringsSize >= image.stringsSize ) {
+		fprintf(stderr, "%s: string pool of %u bytes is no smaller than the %u bytes without tail merging\n", mergedPath,
+				merged.stringsSize, image.stringsSize);
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, const char* argv[])
+{
+	bool good;
+	if ( (argc == 2) && (strcmp(argv[1], "-pool") == 0) )
+		good = checkPool();
+	else if ( argc == 2 )
+		good = checkImage(argv[1]);
+	else if ( argc == 3 )
+		good = checkTailMerged(argv[1], argv[2]);
+	else {
+		fprintf(stderr, "usage: check-string-pool -pool | <image> [<tail merged image>]\n");
+		return 1;
+	}
+	return good ? 0 : 1;
+}
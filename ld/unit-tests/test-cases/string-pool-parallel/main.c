@@ -0,0 +1,25 @@
+#include <stdio.h>
+#include <string.h>
+
+extern int value;
+extern int other(const char*);
+
+int max_value = 10;
+int min_value = 1;
+
+// same name as a static in other.c, so the local symbols repeat
+static int helper(int x)
+{
+	return x + max_value;
+}
+
+static const char* name(void)
+{
+	return "main";
+}
+
+int main(int argc, const char* argv[])
+{
+	printf("%d\n", helper(value) + other(name()));
+	return (int)strlen(argv[0]) - min_value;
+}
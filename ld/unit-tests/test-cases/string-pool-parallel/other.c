@@ -0,0 +1,17 @@
+#include <stdio.h>
+
+int value = 5;
+int other_value = 6;
+
+static int helper(int x)
+{
+	return x * value;
+}
+
+static int counter;
+
+int other(const char* name)
+{
+	puts(name);
+	return helper(++counter) + other_value;
+}
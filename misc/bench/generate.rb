@@ -0,0 +1,153 @@
+#!/usr/bin/env ruby
+
+# Generates a synthetic link workload: relocatable objects and static archives built from random
+# C (or Objective-C) sources, plus a manifest that run.rb uses to link them. Nothing proprietary
+# is needed, only the Xcode toolchain, so the same workload can be rebuilt anywhere.
+
+require 'etc'
+require 'fileutils'
+require 'json'
+require 'optparse'
+
+knobs = {
+  out: '/tmp/zld-bench',
+  objects: 1000,          # relocatable objects in total
+  symbols: 40,            # global functions per object
+  fixups: 6,              # calls per function, and pointers per function in each object's table
+  cstrings: 20,           # C strings per object
+  cstring_dup: 0.5,       # fraction of those strings shared with other objects
+  objc_classes: 0,        # Objective-C classes per object, each with one method per 8 symbols
+  archives: 4,            # static archives to spread objects over
+  archived: 0.5,          # fraction of objects that go in the archives instead of on the command line
+  debug_info: false,      # compile with -g, so the link makes debug notes
+  arch: `uname -m`.strip,
+  seed: 1,
+  jobs: Etc.nprocessors,
+}
+
+OptionParser.new do |opts|
+  opts.banner = "usage: #{File.basename($0)} [options]"
+  opts.on('--out DIR', 'directory for the workload') { |v| knobs[:out] = v }
+  opts.on('--objects N', Integer, 'number of objects') { |v| knobs[:objects] = v }
+  opts.on('--symbols N', Integer, 'global functions per object') { |v| knobs[:symbols] = v }
+  opts.on('--fixups N', Integer, 'calls and data pointers per function') { |v| knobs[:fixups] = v }
+  opts.on('--cstrings N', Integer, 'C strings per object') { |v| knobs[:cstrings] = v }
+  opts.on('--cstring-dup F', Float, 'fraction of C strings shared between objects') { |v| knobs[:cstring_dup] = v }
+  opts.on('--objc-classes N', Integer, 'Objective-C classes per object') { |v| knobs[:objc_classes] = v }
+  opts.on('--archives N', Integer, 'number of static archives') { |v| knobs[:archives] = v }
+  opts.on('--archived F', Float, 'fraction of objects put in archives') { |v| knobs[:archived] = v }
+  opts.on('--[no-]debug-info', 'compile with -g') { |v| knobs[:debug_info] = v }
+  opts.on('--arch ARCH', 'architecture to compile for') { |v| knobs[:arch] = v }
+  opts.on('--seed N', Integer, 'random seed') { |v| knobs[:seed] = v }
+  opts.on('--jobs N', Integer, 'compiles to run at once') { |v| knobs[:jobs] = v }
+end.parse!
+
+raise "--objects must be at least 1" if knobs[:objects] < 1
+raise "--symbols must be at least 1" if knobs[:symbols] < 1
+raise "--archived must be between 0 and 1" unless (0.0..1.0).include?(knobs[:archived])
+raise "--cstring-dup must be between 0 and 1" unless (0.0..1.0).include?(knobs[:cstring_dup])
+
+rng = Random.new(knobs[:seed])
+objc = knobs[:objc_classes] > 0
+count = knobs[:objects]
+symbols = knobs[:symbols]
+shared_strings = Array.new([count * knobs[:cstrings] / 8, 1].max) { |i| "shared string #{i} #{'x' * rng.rand(40)}" }
+
+src_dir = File.join(knobs[:out], 'src')
+obj_dir = File.join(knobs[:out], 'obj')
+FileUtils.rm_rf(knobs[:out])
+FileUtils.mkdir_p([src_dir, obj_dir])
+
+function = ->(i, k) { "bench_f#{i}_#{k}" }
+
+sources = (0...count).map do |i|
+  callees = Array.new(symbols) { Array.new(knobs[:fixups]) { [rng.rand(count), rng.rand(symbols)] } }
+  pointees = Array.new(symbols * knobs[:fixups]) { [rng.rand(count), rng.rand(symbols)] }
+  strings = Array.new(knobs[:cstrings]) do |s|
+    rng.rand < knobs[:cstring_dup] ? shared_strings[rng.rand(shared_strings.size)] : "object #{i} string #{s}"
+  end
+  externs = (callees.flatten(1) + pointees).select { |c, _| c != i }.uniq
+
+  src = +''
+  src << "#import <objc/NSObject.h>\n" if objc
+  src << "extern void bench_sink(const void*);\n"
+  externs.each { |c, k| src << "extern void #{function[c, k]}(void);\n" }
+  symbols.times { |k| src << "void #{function[i, k]}(void);\n" }
+  src << "static const char* const strings[] = {\n"
+  strings.each { |s| src << "\t#{s.inspect},\n" }
+  src << "\t0\n};\n"
+  symbols.times do |k|
+    src << "void #{function[i, k]}(void) {\n"
+    callees[k].each { |c, j| src << "\t#{function[c, j]}();\n" }
+    src << "\tbench_sink(strings[#{k % (strings.size + 1)}]);\n"
+    src << "}\n"
+  end
+  src << "void (* const bench_table#{i}[])(void) = {\n"
+  pointees.each { |c, k| src << "\t#{function[c, k]},\n" }
+  src << "\t0\n};\n"
+  knobs[:objc_classes].times do |c|
+    name = "BenchClass#{i}_#{c}"
+    methods = [symbols / 8, 1].max
+    src << "@interface #{name} : NSObject\n@end\n@implementation #{name}\n"
+    methods.times { |m| src << "- (void)method#{m} { #{function[i, (c + m) % symbols]}(); }\n" }
+    src << "@end\n"
+  end
+  if i == 0
+    src << "void bench_sink(const void* p) { (void)p; }\n"
+    # the program is only linked, never run, so main() only has to reference the functions
+    src << "int main(int argc, const char* argv[]) {\n"
+    src << "\tif ( argc < 0 ) {\n"
+    (1...[count, 64].min).each { |c| src << "\t\t#{function[c, 0]}();\n" }
+    src << "\t}\n\treturn 0;\n}\n"
+  end
+
+  path = File.join(src_dir, "bench#{i}.#{objc ? 'm' : 'c'}")
+  File.write(path, src)
+  path
+end
+
+# compile in parallel
+queue = Queue.new
+sources.each_with_index { |src, i| queue << [src, File.join(obj_dir, "bench#{i}.o")] }
+flags = ['-c', '-arch', knobs[:arch], '-O0', '-w']
+flags << '-g' if knobs[:debug_info]
+workers = Array.new([knobs[:jobs], 1].max) do
+  Thread.new do
+    while (job = (queue.pop(true) rescue nil))
+      src, obj = job
+      raise "failed to compile #{src}" unless system('xcrun', 'clang', *flags, '-o', obj, src)
+    end
+  end
+end
+workers.each(&:join)
+objects = (0...count).map { |i| File.join(obj_dir, "bench#{i}.o") }
+
+# object 0 has main() and always goes on the command line, the archived ones are dealt out in turn
+archived = (objects.size - 1) * knobs[:archived]
+archived = archived.round
+direct = objects[0...(objects.size - archived)]
+archives = []
+if archived > 0 && knobs[:archives] > 0
+  members = objects[(objects.size - archived)..]
+  groups = members.each_with_index.group_by { |_, i| i % knobs[:archives] }.values.map { |g| g.map(&:first) }
+  groups.each_with_index do |group, n|
+    archive = File.join(knobs[:out], "libbench#{n}.a")
+    raise "failed to make #{archive}" unless system('xcrun', 'libtool', '-static', '-no_warning_for_no_symbols', '-o', archive, *group)
+    archives << archive
+  end
+else
+  direct = objects
+end
+
+filelist = File.join(knobs[:out], 'objects.txt')
+File.write(filelist, direct.join("\n") + "\n")
+manifest = {
+  knobs: knobs,
+  arch: knobs[:arch],
+  objc: objc,
+  filelist: filelist,
+  archives: archives,
+  input_bytes: (direct + archives).sum { |f| File.size(f) },
+}
+File.write(File.join(knobs[:out], 'manifest.json'), JSON.pretty_generate(manifest))
+puts "#{direct.size} objects and #{archives.size} archives (#{manifest[:input_bytes] / 1024} KB) in #{knobs[:out]}"
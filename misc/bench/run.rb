@@ -0,0 +1,122 @@
+#!/usr/bin/env ruby
+
+# Links a workload from generate.rb several times and reports the median time of each phase of
+# the link (from -zld_trace_events), the wall time, peak RSS and input throughput.  Results can be
+# saved and later compared against, failing when a phase got slower than the tolerance allows.
+#
+#   misc/bench/generate.rb --objects 2000
+#   misc/bench/run.rb --linker build/Build/Products/Release/zld --save before.json
+#   ... change zld and rebuild ...
+#   misc/bench/run.rb --linker build/Build/Products/Release/zld --compare before.json
+
+require 'json'
+require 'open3'
+require 'optparse'
+require 'tmpdir'
+
+options = {
+  workload: '/tmp/zld-bench',
+  linker: 'build/Build/Products/Release/zld',
+  baseline: nil,
+  runs: 5,
+  warmup: 1,
+  threads: nil,
+  save: nil,
+  compare: nil,
+  tolerance: 0.10,
+}
+
+OptionParser.new do |opts|
+  opts.banner = "usage: #{File.basename($0)} [options] [-- extra linker arguments]"
+  opts.on('--workload DIR', 'directory made by generate.rb') { |v| options[:workload] = v }
+  opts.on('--linker PATH', 'zld to measure') { |v| options[:linker] = v }
+  opts.on('--baseline PATH', 'another linker, such as ld, to time on the same workload') { |v| options[:baseline] = v }
+  opts.on('--runs N', Integer, 'measured links per linker') { |v| options[:runs] = v }
+  opts.on('--warmup N', Integer, 'unmeasured links first, to warm the file cache') { |v| options[:warmup] = v }
+  opts.on('--threads N', Integer, 'pass -threads N to zld') { |v| options[:threads] = v }
+  opts.on('--save FILE', 'write the results as JSON') { |v| options[:save] = v }
+  opts.on('--compare FILE', 'compare with results saved by --save') { |v| options[:compare] = v }
+  opts.on('--tolerance F', Float, 'slowdown allowed by --compare (0.10 is 10%)') { |v| options[:tolerance] = v }
+end.parse!
+
+manifest = JSON.parse(File.read(File.join(options[:workload], 'manifest.json')))
+sdk = `xcrun --show-sdk-path`.strip
+sdk_version = `xcrun --show-sdk-version`.strip
+link_args = ['-arch', manifest['arch'], '-platform_version', 'macos', '11.0', sdk_version, '-syslibroot', sdk,
+             '-filelist', manifest['filelist'], *manifest['archives'], '-lSystem']
+link_args += ['-lobjc', '-framework', 'Foundation'] if manifest['objc']
+link_args += ARGV
+
+def median(values)
+  sorted = values.sort
+  mid = sorted.size / 2
+  sorted.size.odd? ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2.0
+end
+
+# milliseconds from the first start to the last end of the spans, which may overlap on several threads
+def extent(spans)
+  return 0.0 if spans.empty?
+  (spans.map { |s| s['ts'] + s['dur'] }.max - spans.map { |s| s['ts'] }.min) / 1000.0
+end
+
+def phases(trace)
+  spans = JSON.parse(File.read(trace))['traceEvents'].select { |e| e['ph'] == 'X' }
+  result = {}
+  spans.select { |s| s['cat'] == 'ld' }.each { |s| result[s['name']] = s['dur'] / 1000.0 }
+  rounds = spans.select { |s| s['name'] == 'resolver round' }
+  result['resolver rounds'] = rounds.sum { |s| s['dur'] } / 1000.0
+  result['passes (sum)'] = spans.select { |s| s['cat'] == 'pass' }.sum { |s| s['dur'] } / 1000.0
+  result['write atoms'] = extent(spans.select { |s| s['name'] == 'write atoms' })
+  result['linkedit'] = extent(spans.select { |s| ['symbol table', 'dyld info', 'chained fixups'].include?(s['name']) || s['cat'] == 'linkedit' })
+  result
+end
+
+# links once and returns wall time, peak RSS and, for zld, the phase times
+def link(linker, args, trace)
+  Dir.mktmpdir('zld-bench') do |dir|
+    command = ['/usr/bin/time', '-l', linker, *args, '-o', File.join(dir, 'a.out')]
+    command += ['-zld_trace_events', File.join(dir, 'trace.json')] if trace
+    start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+    _, err, status = Open3.capture3(*command)
+    wall = (Process.clock_gettime(Process::CLOCK_MONOTONIC) - start) * 1000.0
+    raise "link failed: #{command.join(' ')}\n#{err}" unless status.success?
+    rss = err[/(\d+)\s+maximum resident set size/, 1].to_i
+    result = { 'wall' => wall, 'peak RSS (MB)' => rss / (1024.0 * 1024.0) }
+    result.merge!(phases(File.join(dir, 'trace.json'))) if trace
+    result
+  end
+end
+
+def measure(name, linker, args, trace, options, input_bytes)
+  options[:warmup].times { link(linker, args, trace) }
+  runs = Array.new(options[:runs]) { link(linker, args, trace) }
+  result = {}
+  runs.first.each_key { |metric| result[metric] = median(runs.map { |r| r[metric] }) }
+  result['throughput (MB/s)'] = input_bytes / (1024.0 * 1024.0) / (result['wall'] / 1000.0)
+  puts "#{name}: #{linker}"
+  result.each { |metric, value| puts format('  %-20s %10.1f%s', metric, value, metric.include?('(') ? '' : ' ms') }
+  result
+end
+
+zld_args = link_args.dup
+zld_args += ['-threads', options[:threads].to_s] if options[:threads]
+puts "#{manifest['filelist']} + #{manifest['archives'].size} archives, #{manifest['input_bytes'] / 1024} KB, median of #{options[:runs]} links"
+results = { 'zld' => measure('zld', options[:linker], zld_args, true, options, manifest['input_bytes']) }
+results['baseline'] = measure('baseline', options[:baseline], link_args, false, options, manifest['input_bytes']) if options[:baseline]
+
+File.write(options[:save], JSON.pretty_generate(results)) if options[:save]
+
+if options[:compare]
+  before = JSON.parse(File.read(options[:compare]))['zld']
+  regressions = []
+  results['zld'].each do |metric, value|
+    old = before[metric]
+    next if old.nil? || metric.start_with?('throughput')
+    change = old > 0 ? (value - old) / old : 0.0
+    # phases that take under a millisecond are mostly noise
+    regressed = change > options[:tolerance] && value - old >= 1.0
+    regressions << metric if regressed
+    puts format('  %-20s %10.1f -> %10.1f  %+6.1f%%%s', metric, old, value, change * 100, regressed ? '  REGRESSION' : '')
+  end
+  abort "slower than #{options[:compare]}: #{regressions.join(', ')}" unless regressions.empty?
+end